@@ -0,0 +1,36 @@
+#ifndef ADFRAMES
+#define ADFRAMES
+// ADFrames.h
+// Timer triggered sampling of the microphone input (PE0) on ADC1, with
+// uDMA filling two frame buffers in turn
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ES_Configure.h"
+
+// samples in a frame
+#define ADC_FRAME_LEN 64
+// the fastest sample rate that ADC_FrameStart will take
+#define ADC_FRAME_MAX_RATE 100000
+
+// set up ADC1, Timer 3 and the uDMA, to post ADC_FRAME_READY events to
+// WhichService, with the frame (0 or 1) as the EventParam
+void ADC_FrameInit(uint8_t WhichService);
+
+//------------ADC_FrameStart------------
+// starts sampling at SampleRate per second, into frame 0 and then frame 1
+// and round again. The event for a frame comes when it is full, and the
+// frame is good to read until the other one is full too
+// Input: the sample rate, 1 to ADC_FRAME_MAX_RATE
+// Output: false if the rate is out of range
+bool ADC_FrameStart(uint32_t SampleRate);
+
+// stops sampling, dropping the frame that was being filled
+void ADC_FrameStop(void);
+
+// the 12 bit samples of a frame, oldest in [0]
+const uint16_t *ADC_FrameData(uint8_t Which);
+
+// the number of frames filled since ADC_FrameInit
+uint32_t ADC_FrameCount(void);
+#endif
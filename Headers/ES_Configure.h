@@ -23,228 +23,256 @@
 
 /****************************************************************************/
 // The maximum number of services sets an upper bound on the number of 
-// services that the framework will handle. Reasonable values are 8 and 16
-// corresponding to an 8-bit(uint8_t) and 16-bit(uint16_t) Ready variable size
+// services that the framework will handle. Reasonable values are 8, 16, 32 
+// and 64. The Ready variable and the timer active flags share one word that is
+// sized to hold the larger of MAX_NUM_SERVICES and MAX_NUM_TIMERS bits
 #define MAX_NUM_SERVICES 16
 
 /****************************************************************************/
-// This macro determines that nuber of services that are *actually* used in
-// a particular application. It will vary in value from 1 to MAX_NUM_SERVICES
-#define NUM_SERVICES 7
+// The maximum number of timers in the ES_Timers module. Reasonable values are
+// 8, 16, 32 and 64. Timers beyond 15 need TIMERn_RESP_FUNC definitions below
+#define MAX_NUM_TIMERS 16
 
 /****************************************************************************/
-// These are the definitions for Service 0, the lowest priority service.
-// Every Events and Services application must have a Service 0. Further 
-// services are added in numeric sequence (1,2,3,...) with increasing 
-// priorities
-// the header file with the publmic function prototypes
-#define SERV_0_HEADER "KeyboardService.h"
-// the name of the Init function
-#define SERV_0_INIT InitKeyboardService
-// the name of the run function
-#define SERV_0_RUN RunKeyboardService
-// How big should this services Queue be?
-#define SERV_0_QUEUE_SIZE 3
+// Define this to run the timers on the hierarchical timer wheel in
+// ES_TimerWheel.c rather than decrementing every active timer on every tick,
+// so that a tick costs the same however many timers are running.
+// ES_WHEEL_TIMERS is the number of timers that the wheel can hold, at least
+// MAX_NUM_TIMERS, which are the ES_Timers timers, plus ES_NUM_TIMER_HANDLES
+#define ES_USE_TIMER_WHEEL
+
+// Define ES_NUM_TIMER_HANDLES to the number of timers that services can
+// create at run time with ES_TimerCreate & ES_TimerCreateCallback, rather
+// than taking a numbered timer below. Needs ES_USE_TIMER_WHEEL, so it goes
+// with it. Without it KnobService falls back on KNOB_VIBRATION_TIMER
+#ifdef ES_USE_TIMER_WHEEL
+#define ES_NUM_TIMER_HANDLES 8
+#endif
+
+#ifndef ES_WHEEL_TIMERS
+#ifdef ES_NUM_TIMER_HANDLES
+#define ES_WHEEL_TIMERS (MAX_NUM_TIMERS + ES_NUM_TIMER_HANDLES)
+#else
+#define ES_WHEEL_TIMERS MAX_NUM_TIMERS
+#endif
+#endif
 
 /****************************************************************************/
-// The following sections are used to define the parameters for each of the
-// services. You only need to fill out as many as the number of services 
-// defined by NUM_SERVICES
+// Define this to stop the tick interrupt while ES_Run is idle. _HW_Idle
+// stretches the tick out to the next timer that is due, or to
+// ES_TICKLESS_MAX_TICKS, whichever is sooner, and sleeps with WFI until then
+// or until another interrupt. The ticks that went by are then run together.
+// The event checkers are only polled when it wakes, so ES_TICKLESS_MAX_TICKS
+// bounds how long a polled input can go unseen. Needs ES_USE_TIMER_WHEEL
+//#define ES_USE_TICKLESS
+#define ES_TICKLESS_MAX_TICKS 20
+
 /****************************************************************************/
-// These are the definitions for Service 1
-#if NUM_SERVICES > 1
-// the header file with the public function prototypes
-#define SERV_1_HEADER "MicrophoneService.h"
-// the name of the Init function
-#define SERV_1_INIT InitMicrophoneService
-// the name of the run function
-#define SERV_1_RUN RunMicrophoneService
-// How big should this services Queue be?
-#define SERV_1_QUEUE_SIZE 3
-#endif
+// The number of short timers (ES_ShortTimer.c) that services can make with
+// ES_ShortTimerCreate. They time to the uS and each posts to its own
+// service, but all run off the one Timer 5 match. No more than 5 with
+// ES_USE_RECORD, which logs the timeouts as a 5 bit mask
+#define ES_NUM_SHORT_TIMERS 4
 
 /****************************************************************************/
-// These are the definitions for Service 2
-#if NUM_SERVICES > 2
-// the header file with the public function prototypes
-#define SERV_2_HEADER "KnobService.h"
-// the name of the Init function
-#define SERV_2_INIT InitKnobService
-// the name of the run function
-#define SERV_2_RUN RunKnobService
-// How big should this services Queue be?
-#define SERV_2_QUEUE_SIZE 3
-#endif
+// Define this to find the highest priority ready service (and the next active
+// timer) with a count-leading-zeros instruction rather than walking the flags
+// a nybble at a time through Nybble2MSBitNum. This makes the search constant
+// time no matter how wide the flag word is. Requires a compiler that provides
+// a CLZ intrinsic (see ES_CLZ32 in ES_Port.h)
+//#define ES_USE_CLZ_DISPATCH
 
 /****************************************************************************/
-// These are the definitions for Service 3
-#if NUM_SERVICES > 3
-// the header file with the public function prototypes
-#define SERV_3_HEADER "WatertubeService.h"
-// the name of the Init function
-#define SERV_3_INIT InitWatertubeService
-// the name of the run function
-#define SERV_3_RUN RunWatertubeService
-// How big should this services Queue be?
-#define SERV_3_QUEUE_SIZE 8
-#endif
+// The service table. This one list is the only place that a service needs to
+// be named: the framework generates the service descriptors, the event queues,
+// the prototypes for the Init, Run & Post functions, the priority numbers and
+// masks, and NUM_SERVICES from it (see ES_ServiceHeaders.h).
+// Each entry is SERVICE( Init function, Run function, Post function, 
+// Queue size ). The first entry is Service 0, the lowest priority service, 
+// and every Events and Services application must have one. Further services
+// are added in sequence with increasing priorities. The number of entries is
+// bounded only by MAX_NUM_SERVICES, the width of the Ready variable.
+#define SERVICE_LIST(SERVICE) \
+  SERVICE( InitKeyboardService,        RunKeyboardService,                   \
+           PostKeyboardService,        3 )                                   \
+  SERVICE( InitMicrophoneService,      RunMicrophoneService,                 \
+           PostMicrophoneService,      3 )                                   \
+  SERVICE( InitKnobService,            RunKnobService,                       \
+           PostKnobService,            3 )                                   \
+  SERVICE( InitWatertubeService,       RunWatertubeService,                  \
+           PostWatertubeService,       8 )                                   \
+  SERVICE( InitLEDService,             RunLEDService,                        \
+           PostLEDService,             3 )                                   \
+  SERVICE( InitializeResetService,     RunResetService,                      \
+           PostResetService,           3 )                                   \
+  SERVICE( InitResistiveStripService,  RunResistiveStripService,             \
+           PostResistiveStripService,  3 )
 
 /****************************************************************************/
-// These are the definitions for Service 4
-#if NUM_SERVICES > 4
-// the header file with the public function prototypes
-#define SERV_4_HEADER "LEDService.h"
-// the name of the Init function
-#define SERV_4_INIT InitLEDService
-// the name of the run function
-#define SERV_4_RUN RunLEDService
-// How big should this services Queue be?
-#define SERV_4_QUEUE_SIZE 3
-#endif
+// Define this to put an upper limit (in bytes) on the RAM used by all of the
+// service queues together. The build will fail if the table above needs more.
+// The actual total is reported in the constant ES_QueueRAMBytes, which shows
+// up in the link map.
+//#define ES_MAX_QUEUE_RAM 256
 
 /****************************************************************************/
-// These are the definitions for Service 5
-#if NUM_SERVICES > 5
-// the header file with the public function prototypes
-#define SERV_5_HEADER "ResetService.h"
-// the name of the Init function
-#define SERV_5_INIT InitializeResetService
-// the name of the run function
-#define SERV_5_RUN RunResetService
-// How big should this services Queue be?
-#define SERV_5_QUEUE_SIZE 3
-#endif
+// What a post does when it finds a service's queue full. Each entry is
+// POLICY( Run function, policy ), and services that are not listed get
+// ES_QUEUE_REJECT:
+//   ES_QUEUE_REJECT            the post fails and the new event is lost
+//   ES_QUEUE_DROP_OLDEST       the oldest waiting event is thrown away
+//   ES_QUEUE_OVERWRITE_NEWEST  the newest waiting event is replaced
+//   ES_QUEUE_COALESCE          the post fails, but events of the types in
+//                              ES_EVENT_IS_LATEST replace a waiting event of
+//                              the same type, full or not
+// ES_PostAll, ES_Publish and ES_PostToServiceLIFO always reject. Each queue
+// counts its losses (ES_GetQueueStats) and can call a function to tell a
+// producer that it is falling behind (ES_SetQueueAlert)
+#define QUEUE_POLICY_LIST(POLICY) \
+  POLICY( RunKnobService,       ES_QUEUE_COALESCE )                         \
+  POLICY( RunWatertubeService,  ES_QUEUE_COALESCE )                         \
+  POLICY( RunMicrophoneService, ES_QUEUE_COALESCE )
 
 /****************************************************************************/
-// These are the definitions for Service 6
-#if NUM_SERVICES > 6
-// the header file with the public function prototypes
-#define SERV_6_HEADER "ResistiveStripService.h"
-// the name of the Init function
-#define SERV_6_INIT InitResistiveStripService
-// the name of the run function
-#define SERV_6_RUN RunResistiveStripService
-// How big should this services Queue be?
-#define SERV_6_QUEUE_SIZE 3
+// Define this to have ES_Run drain up to ES_DISPATCH_BATCH events from a
+// service each time it is picked, rather than rescanning Ready after every
+// event. The batch is taken from the queue with one ES_DeQueueBatch and ends
+// early if a higher priority service becomes ready.
+// ES_STARVATION_TICKS (in framework timer ticks) bounds how long a ready
+// service, or the ES_CheckUserEvents pass, can be held off by higher priority
+// traffic before it is forced to run. Wait times are kept for each priority
+// and can be read with ES_GetWaitStats
+//#define ES_USE_BATCH_DISPATCH
+#define ES_DISPATCH_BATCH 4
+#define ES_STARVATION_TICKS 10
+
+// Define this to keep the same wait times with the one event at a time
+// dispatcher, to compare it against ES_USE_BATCH_DISPATCH. Not for use with
+// ES_USE_PREEMPTION
+//#define ES_USE_WAIT_STATS
+#if defined(ES_USE_BATCH_DISPATCH) && !defined(ES_USE_WAIT_STATS)
+#define ES_USE_WAIT_STATS
 #endif
 
 /****************************************************************************/
-// These are the definitions for Service 7
-#if NUM_SERVICES > 7
-// the header file with the public function prototypes
-#define SERV_7_HEADER "TestHarnessService7.h"
-// the name of the Init function
-#define SERV_7_INIT InitTestHarnessService7
-// the name of the run function
-#define SERV_7_RUN RunTestHarnessService7
-// How big should this services Queue be?
-#define SERV_7_QUEUE_SIZE 3
-#endif
+// Define this to build in the dispatch profiler. For every service it keeps
+// the number of events dispatched, the total and maximum cycles spent in the
+// run function, the queue high-water mark, the number of failed posts and
+// the post-to-dispatch latency. ES_DumpProfile prints the table to the
+// console. With this left undefined none of the profiling code is compiled
+// and ES_Event stays at its normal size
+//#define ES_USE_PROFILER
 
 /****************************************************************************/
-// These are the definitions for Service 8
-#if NUM_SERVICES > 8
-// the header file with the public function prototypes
-#define SERV_8_HEADER "TestHarnessService8.h"
-// the name of the Init function
-#define SERV_8_INIT InitTestHarnessService8
-// the name of the run function
-#define SERV_8_RUN RunTestHarnessService8
-// How big should this services Queue be?
-#define SERV_8_QUEUE_SIZE 3
-#endif
+// Define this to build in the code section profiler (see ES_Section.c). Each
+// entry in SECTION_LIST is SECTION( name ), and the code between
+// ES_SECTION_BEGIN(name) and ES_SECTION_END(name) is timed with ES_Cycles,
+// keeping the number of passes and the least, most and total cycles.
+// ES_DumpSections prints the table to the console. With this left undefined
+// the markers are only the braces of the block that they make
+//#define ES_USE_SECTIONS
+#define SECTION_LIST(SECTION)       \
+  SECTION( PerformFFT )             \
+  SECTION( PushAverageBuffer )      \
+  SECTION( lightLED )               \
+  SECTION( ADC_MultiRead )          \
+  SECTION( PWM_TIVA_SetPulseWidth )
 
 /****************************************************************************/
-// These are the definitions for Service 9
-#if NUM_SERVICES > 9
-// the header file with the public function prototypes
-#define SERV_9_HEADER "TestHarnessService9.h"
-// the name of the Init function
-#define SERV_9_INIT InitTestHarnessService9
-// the name of the run function
-#define SERV_9_RUN RunTestHarnessService9
-// How big should this services Queue be?
-#define SERV_9_QUEUE_SIZE 3
-#endif
+// Define this to build in the binary event trace (see ES_Trace.c). Every
+// post, dispatch and timer expiration is written as an 8 byte record to a
+// RAM ring buffer of ES_TRACE_SIZE records (a power of 2), which
+// ES_TraceDump sends to the console for Tools/es_trace_decode.py to read
+//#define ES_USE_TRACE
+#define ES_TRACE_SIZE 128
 
 /****************************************************************************/
-// These are the definitions for Service 10
-#if NUM_SERVICES > 10
-// the header file with the public function prototypes
-#define SERV_10_HEADER "TestHarnessService10.h"
-// the name of the Init function
-#define SERV_10_INIT InitTestHarnessService10
-// the name of the run function
-#define SERV_10_RUN RunTestHarnessService10
-// How big should this services Queue be?
-#define SERV_10_QUEUE_SIZE 3
+// Define this to capture every external input (ticks, short timer timeouts,
+// keys, the reset button and ADC reads) to a RAM buffer of ES_RECORD_SIZE
+// bytes, which ES_RecordDump sends to the console. A host build with the
+// same configuration replays the dump exactly (see ES_Record.c). In this
+// build the short timer timeouts are posted from _HW_Process_Pending_Ints
+// rather than from the interrupt response
+//#define ES_USE_RECORD
+#ifndef ES_RECORD_SIZE
+#define ES_RECORD_SIZE 8192
 #endif
 
 /****************************************************************************/
-// These are the definitions for Service 11
-#if NUM_SERVICES > 11
-// the header file with the public function prototypes
-#define SERV_11_HEADER "TestHarnessService11.h"
-// the name of the Init function
-#define SERV_11_INIT InitTestHarnessService11
-// the name of the run function
-#define SERV_11_RUN RunTestHarnessService11
-// How big should this services Queue be?
-#define SERV_11_QUEUE_SIZE 3
-#endif
+// Define this to give events a pPayload pointing to a block from a static
+// pool of ES_POOL_NUM_BLOCKS reference counted blocks of ES_POOL_BLOCK_SIZE
+// bytes (see ES_Pool.c). The framework only looks at pPayload for the event
+// types listed in ES_EVENT_HAS_PAYLOAD, so other events need not set it
+//#define ES_USE_EVENT_POOL
+#define ES_POOL_NUM_BLOCKS 8
+#define ES_POOL_BLOCK_SIZE 32
+#define ES_EVENT_HAS_PAYLOAD(_type_) ((_type_) == WATER_HEIGHTS)
 
 /****************************************************************************/
-// These are the definitions for Service 12
-#if NUM_SERVICES > 12
-// the header file with the public function prototypes
-#define SERV_12_HEADER "TestHarnessService12.h"
-// the name of the Init function
-#define SERV_12_INIT InitTestHarnessService12
-// the name of the run function
-#define SERV_12_RUN RunTestHarnessService12
-// How big should this services Queue be?
-#define SERV_12_QUEUE_SIZE 3
-#endif
+// Events of the types listed in ES_EVENT_IS_LATEST carry a value where only
+// the newest one matters. ES_PostToServiceLatest, or any post to a queue with
+// the ES_QUEUE_COALESCE policy, overwrites an event of the same type that is
+// still waiting in the queue rather than adding another, so a service can
+// not fall behind a fast stream of them. Other types are queued as usual.
+// An ADC_FRAME_READY frame is only good until the next one fills, so only
+// the newest one may wait to be read
+#define ES_EVENT_IS_LATEST(_type_) \
+  ( (((_type_) >= CHANGE_WATER_1) && ((_type_) <= WATER_HEIGHTS)) || \
+    ((_type_) == CHANGE_KNOB_VIBRATION) || ((_type_) == ADC_FRAME_READY) )
 
 /****************************************************************************/
-// These are the definitions for Service 13
-#if NUM_SERVICES > 13
-// the header file with the public function prototypes
-#define SERV_13_HEADER "TestHarnessService13.h"
-// the name of the Init function
-#define SERV_13_INIT InitTestHarnessService13
-// the name of the run function
-#define SERV_13_RUN RunTestHarnessService13
-// How big should this services Queue be?
-#define SERV_13_QUEUE_SIZE 3
-#endif
+// Define this to have interrupt responses post through lock-free single
+// producer, single consumer channels (see ES_IsrChannel.c) that are drained
+// into the service queues by _HW_Process_Pending_Ints, so that interrupts
+// are never turned off to write a queue. Each entry in ISR_CHANNEL_LIST is
+// CHANNEL( name, size ), one per interrupt source that posts events, and
+// the size must be a power of 2 no larger than 128
+#define ES_USE_ISR_CHANNELS
+#define ISR_CHANNEL_LIST(CHANNEL) \
+  CHANNEL( ShortTimer, 8 )        \
+  CHANNEL( ADCFrames, 2 )
 
 /****************************************************************************/
-// These are the definitions for Service 14
-#if NUM_SERVICES > 14
-// the header file with the public function prototypes
-#define SERV_14_HEADER "TestHarnessService14.h"
-// the name of the Init function
-#define SERV_14_INIT InitTestHarnessService14
-// the name of the run function
-#define SERV_14_RUN RunTestHarnessService14
-// How big should this services Queue be?
-#define SERV_14_QUEUE_SIZE 3
-#endif
+// Define this to make the framework a preemptive, single stack, run to
+// completion kernel. A post that readies a higher priority service than the
+// one running runs it at once, nested inside the lower one; a post from an
+// interrupt response does the same through PendSV as soon as the interrupt
+// responses are done. The host build preempts at its yield points instead
+// (see Host/ES_HostPort.c). Services that share data with a higher priority
+// service must protect it with EnterCritical/ExitCritical or
+// ES_SchedLock/ES_SchedUnlock. Can not be used with ES_USE_BATCH_DISPATCH
+//#define ES_USE_PREEMPTION
 
 /****************************************************************************/
-// These are the definitions for Service 15
-#if NUM_SERVICES > 15
-// the header file with the public function prototypes
-#define SERV_15_HEADER "TestHarnessService15.h"
-// the name of the Init function
-#define SERV_15_INIT InitTestHarnessService15
-// the name of the run function
-#define SERV_15_RUN RunTestHarnessService15
-// How big should this services Queue be?
-#define SERV_15_QUEUE_SIZE 3
-#endif
+// Define this to build the event queues as lock-free single producer,
+// single consumer rings (ES_SpscQueue.c) in place of ES_Queue.c. Each queue
+// is rounded up to a power of 2 entries and indexed by masking, FIFO posts
+// and dequeues never turn interrupts off, and a queue may hold more than
+// 255 events. Every post must come from thread level, so this needs
+// ES_USE_ISR_CHANNELS and can not be used with ES_USE_PREEMPTION
+//#define ES_USE_SPSC_QUEUE
+
+/****************************************************************************/
+// Define this to have EnterCritical/ExitCritical mask interrupts with
+// BASEPRI rather than PRIMASK. Every interrupt is set to ES_CRITICAL_PRIORITY
+// at start up, and a critical region holds off only those at that priority
+// or below, so an interrupt raised above it is never held up by a queue
+// operation. ADFrames.c raises the sampling interrupt to ES_SAMPLING_PRIORITY.
+// An interrupt above ES_CRITICAL_PRIORITY must not use a critical region or
+// post straight to a queue, so this needs ES_USE_ISR_CHANNELS. Priorities are
+// as for IntPrioritySet, in the top 3 bits, 0x00 the highest
+//#define ES_USE_BASEPRI
+#define ES_CRITICAL_PRIORITY 0x20
+#define ES_SAMPLING_PRIORITY 0x00
 
+/****************************************************************************/
+// Define this to have the MicrophoneService sample through ADFrames.c, where
+// a timer triggers ADC1 at MIC_SAMPLE_RATE and uDMA fills frames of
+// ADC_FRAME_LEN samples with one ADC_FRAME_READY event a frame, rather than
+// a short timeout and an ADC_MultiRead for every sample. The frames are not
+// recorded, so it can not be used with ES_USE_RECORD
+//#define MIC_USE_ADC_FRAMES
+#define MIC_SAMPLE_RATE 8000
 
 /****************************************************************************/
 // Name/define the events of interest
@@ -278,6 +306,7 @@ typedef enum {  ES_NO_EVENT = 0,
 								CHANGE_WATER_6,
 								CHANGE_WATER_7,
 								CHANGE_WATER_8,
+								WATER_HEIGHTS, // all tubes at once, in a payload
 								WATERTUBE_SLEEP,
 								
 								// Knob Service events
@@ -291,6 +320,7 @@ typedef enum {  ES_NO_EVENT = 0,
 								MICROPHONE_FOURIER_COMPLETED,
 								MICROPHONE_START,
 								MICROPHONE_STOP,
+								ADC_FRAME_READY, // a frame of samples from ADFrames.c
 								
 								// Lifecycle Hardware Initilization
 								LIFECYCLE_HARDWARE_INITALIZED,
@@ -305,14 +335,32 @@ typedef enum {  ES_NO_EVENT = 0,
 								ES_WAKE,   // Posted to make services wake
 								ES_INTERACTION, 
 								ES_RESET_BUTTON, 
-								ES_WELCOME_COMPLETE
+								ES_WELCOME_COMPLETE,
+								
+								ES_NUM_EVENT_TYPES // must stay last, sizes the subscriber table
 } ES_EventTyp_t;
 
+/****************************************************************************/
+// The publish/subscribe table used by ES_Publish. Each entry is
+// SUBSCRIBE( Event type, Subscribers ), where Subscribers is an OR of
+// ES_PRIORITY_MASK(Run function) for each service that should receive that
+// event type. List each event type only once. Event types that are not
+// listed have no subscribers until a service calls ES_Subscribe.
+#define SUBSCRIPTION_LIST(SUBSCRIBE) \
+  SUBSCRIBE( ES_SLEEP,  ES_PRIORITY_MASK(RunMicrophoneService) |            \
+                        ES_PRIORITY_MASK(RunWatertubeService) |             \
+                        ES_PRIORITY_MASK(RunLEDService) )                   \
+  SUBSCRIBE( ES_WAKE,   ES_PRIORITY_MASK(RunMicrophoneService) |            \
+                        ES_PRIORITY_MASK(RunWatertubeService) |             \
+                        ES_PRIORITY_MASK(RunLEDService) )
+
 /****************************************************************************/
 // These are the definitions for the Distribution lists. Each definition
 // should be a comma separated list of post functions to indicate which
 // services are on that distribution list.
-#define NUM_DIST_LISTS 1
+// New code should use ES_Publish and SUBSCRIPTION_LIST above instead, which
+// delivers to all of the subscribers inside a single critical region.
+#define NUM_DIST_LISTS 0
 #if NUM_DIST_LISTS > 0 
 #define DIST_LIST0 PostMicrophoneService,
 #endif
@@ -350,8 +398,8 @@ typedef enum {  ES_NO_EVENT = 0,
 
 /****************************************************************************/
 // These are the definitions for the post functions to be executed when the
-// corresponding timer expires. All 16 must be defined. If you are not using
-// a timer, then you should use TIMER_UNUSED
+// corresponding timer expires. All MAX_NUM_TIMERS must be defined. If you are
+// not using a timer, then you should use TIMER_UNUSED
 // Unlike services, any combination of timers may be used and there is no
 // priority in servicing them
 #define TIMER_UNUSED ((pPostFunc)0)
@@ -361,8 +409,12 @@ typedef enum {  ES_NO_EVENT = 0,
 #define TIMER3_RESP_FUNC PostResetService
 #define TIMER4_RESP_FUNC PostLEDService
 #define TIMER5_RESP_FUNC PostResistiveStripService
+#ifdef ES_NUM_TIMER_HANDLES
+#define TIMER6_RESP_FUNC TIMER_UNUSED
+#else
 #define TIMER6_RESP_FUNC PostKnobService
-#define TIMER7_RESP_FUNC TIMER_UNUSED
+#endif
+#define TIMER7_RESP_FUNC PostResetService
 #define TIMER8_RESP_FUNC TIMER_UNUSED
 #define TIMER9_RESP_FUNC TIMER_UNUSED
 #define TIMER10_RESP_FUNC TIMER_UNUSED
@@ -371,6 +423,58 @@ typedef enum {  ES_NO_EVENT = 0,
 #define TIMER13_RESP_FUNC TIMER_UNUSED
 #define TIMER14_RESP_FUNC TIMER_UNUSED
 #define TIMER15_RESP_FUNC TIMER_UNUSED
+#if MAX_NUM_TIMERS > 16
+#define TIMER16_RESP_FUNC TIMER_UNUSED
+#define TIMER17_RESP_FUNC TIMER_UNUSED
+#define TIMER18_RESP_FUNC TIMER_UNUSED
+#define TIMER19_RESP_FUNC TIMER_UNUSED
+#define TIMER20_RESP_FUNC TIMER_UNUSED
+#define TIMER21_RESP_FUNC TIMER_UNUSED
+#define TIMER22_RESP_FUNC TIMER_UNUSED
+#define TIMER23_RESP_FUNC TIMER_UNUSED
+#define TIMER24_RESP_FUNC TIMER_UNUSED
+#define TIMER25_RESP_FUNC TIMER_UNUSED
+#define TIMER26_RESP_FUNC TIMER_UNUSED
+#define TIMER27_RESP_FUNC TIMER_UNUSED
+#define TIMER28_RESP_FUNC TIMER_UNUSED
+#define TIMER29_RESP_FUNC TIMER_UNUSED
+#define TIMER30_RESP_FUNC TIMER_UNUSED
+#define TIMER31_RESP_FUNC TIMER_UNUSED
+#endif
+#if MAX_NUM_TIMERS > 32
+#define TIMER32_RESP_FUNC TIMER_UNUSED
+#define TIMER33_RESP_FUNC TIMER_UNUSED
+#define TIMER34_RESP_FUNC TIMER_UNUSED
+#define TIMER35_RESP_FUNC TIMER_UNUSED
+#define TIMER36_RESP_FUNC TIMER_UNUSED
+#define TIMER37_RESP_FUNC TIMER_UNUSED
+#define TIMER38_RESP_FUNC TIMER_UNUSED
+#define TIMER39_RESP_FUNC TIMER_UNUSED
+#define TIMER40_RESP_FUNC TIMER_UNUSED
+#define TIMER41_RESP_FUNC TIMER_UNUSED
+#define TIMER42_RESP_FUNC TIMER_UNUSED
+#define TIMER43_RESP_FUNC TIMER_UNUSED
+#define TIMER44_RESP_FUNC TIMER_UNUSED
+#define TIMER45_RESP_FUNC TIMER_UNUSED
+#define TIMER46_RESP_FUNC TIMER_UNUSED
+#define TIMER47_RESP_FUNC TIMER_UNUSED
+#define TIMER48_RESP_FUNC TIMER_UNUSED
+#define TIMER49_RESP_FUNC TIMER_UNUSED
+#define TIMER50_RESP_FUNC TIMER_UNUSED
+#define TIMER51_RESP_FUNC TIMER_UNUSED
+#define TIMER52_RESP_FUNC TIMER_UNUSED
+#define TIMER53_RESP_FUNC TIMER_UNUSED
+#define TIMER54_RESP_FUNC TIMER_UNUSED
+#define TIMER55_RESP_FUNC TIMER_UNUSED
+#define TIMER56_RESP_FUNC TIMER_UNUSED
+#define TIMER57_RESP_FUNC TIMER_UNUSED
+#define TIMER58_RESP_FUNC TIMER_UNUSED
+#define TIMER59_RESP_FUNC TIMER_UNUSED
+#define TIMER60_RESP_FUNC TIMER_UNUSED
+#define TIMER61_RESP_FUNC TIMER_UNUSED
+#define TIMER62_RESP_FUNC TIMER_UNUSED
+#define TIMER63_RESP_FUNC TIMER_UNUSED
+#endif
 
 /****************************************************************************/
 // Give the timer numbers symbolic names to make it easier to move them
@@ -383,6 +487,9 @@ typedef enum {  ES_NO_EVENT = 0,
 #define INACTIVITY_TIMER 3
 #define WELCOME_LED_TIMER 4
 #define RESISTIVE_STRIP_TIMER 5
+#ifndef ES_NUM_TIMER_HANDLES
 #define KNOB_VIBRATION_TIMER 6
+#endif
+#define PERFORMANCE_TIMER 7
 
 #endif /* CONFIGURE_H */
@@ -36,7 +36,12 @@
  Description
    if it will fit, adds Event2Add to the Queue
  ***************************************************************************/
+#ifndef ES_USE_EVENT_POOL
 #define ES_DeferEvent( a,b ) ES_EnQueueLIFO( a, b )
+#else
+// the deferred copy needs a reference to any payload, so this is a function
+bool ES_DeferEvent( ES_Event * pBlock, ES_Event Event2Add );
+#endif
 
 /****************************************************************************
  Function
@@ -19,10 +19,18 @@
 #define ES_Events_H
 
 #include "ES_Types.h"
+#include "ES_Configure.h"
 
 typedef struct ES_Event_t {
     ES_EventTyp_t EventType;    // what kind of event?
     uint16_t   EventParam;      // parameter value for use w/ this event
+#ifdef ES_USE_PROFILER
+    uint32_t   PostTime;        // cycle count when posted, set by the framework
+#endif
+#ifdef ES_USE_EVENT_POOL
+    void      *pPayload;        // block from ES_PoolAlloc, only looked at if
+                                // ES_EVENT_HAS_PAYLOAD(EventType)
+#endif
 }ES_Event;
 
 
@@ -16,13 +16,20 @@
 #ifndef ES_Framework_H
 #define ES_Framework_H
 
+#include "ES_Configure.h"
 #include "ES_Port.h"
 #include "ES_Types.h"
 #include "ES_General.h"
 #include "ES_CheckEvents.h"
 #include "ES_PostList.h"
 #include "ES_Events.h"
+#include "ES_Queue.h"
 #include "ES_Timers.h"
+#include "ES_Trace.h"
+#include "ES_Record.h"
+#include "ES_Pool.h"
+#include "ES_IsrChannel.h"
+#include "ES_Section.h"
 
 typedef enum {
               Success = 0,
@@ -33,10 +40,78 @@ typedef enum {
               FailedInit
 } ES_Return_t;
 
+// overflow counters for one service queue, kept whatever the options
+typedef struct {
+  uint16_t NumDropped;      // events lost to a full queue
+  uint16_t NumCoalesced;    // events replaced by a newer one of the same type
+  ES_QueueIndex_t PeakDepth; // most entries ever seen in the queue
+  ES_QueueIndex_t Capacity;  // the most entries the queue can hold
+} ES_QueueStats_t;
+
+// called with Congested true when a post fills a service's queue or loses
+// an event to it, and with Congested false once the service has emptied it
+typedef void ES_QueueAlertFunc_t( uint8_t WhichService, bool Congested );
+
+#ifdef ES_USE_PROFILER
+// dispatch profile for one service. Cycle counts come from _HW_GetCycleCount
+typedef struct {
+  uint32_t NumDispatched;   // events handed to the run function
+  uint64_t TotalCycles;     // cycles spent in the run function
+  uint32_t MaxCycles;       // longest single run function call
+  uint64_t TotalLatency;    // cycles from post to start of dispatch
+  uint32_t MaxLatency;      // longest post to dispatch latency
+  uint16_t NumFailedPosts;  // posts that found the queue full
+  ES_QueueIndex_t QueueHighWater; // most entries ever seen in the queue
+} ES_ServiceProfile_t;
+#endif
+
+#ifdef ES_USE_WAIT_STATS
+// wait time statistics for one priority level, all times in timer ticks.
+// a wait is the time from a service becoming ready to the start of its batch,
+// or of its next event without ES_USE_BATCH_DISPATCH
+typedef struct {
+  ES_Time_t MaxWait;      // longest wait seen
+  uint32_t TotalWait;     // sum of all waits, divide by NumBatches for mean
+  uint32_t NumBatches;    // number of batches (or single events) dispatched
+  uint16_t NumForced;     // batches forced by the starvation guard
+} ES_WaitStats_t;
+
+// pass this to ES_GetWaitStats to get the stats for ES_CheckUserEvents
+#define ES_WAIT_STATS_CHECKERS 0xFF
+#endif
+
 ES_Return_t ES_Initialize( TimerRate_t NewRate  );
 ES_Return_t ES_Run( void );
 bool ES_PostAll( ES_Event ThisEvent );
+bool ES_Publish( ES_Event ThisEvent );
+bool ES_Subscribe( uint8_t WhichService, ES_EventTyp_t EventType );
+bool ES_Unsubscribe( uint8_t WhichService, ES_EventTyp_t EventType );
 bool ES_PostToService( uint8_t WhichService, ES_Event ThisEvent);
 bool ES_PostToServiceLIFO( uint8_t WhichService, ES_Event TheEvent);
+bool ES_PostToServiceLatest( uint8_t WhichService, ES_Event TheEvent);
+bool ES_PostToServiceBatch( uint8_t WhichService, ES_Event *pEvents,
+                            ES_QueueIndex_t NumEvents );
+bool ES_SetQueueAlert( uint8_t WhichService, ES_QueueAlertFunc_t *pAlert );
+bool ES_GetQueueStats( uint8_t WhichService, ES_QueueStats_t *pStats );
+void ES_ClearQueueStats( void );
+#ifdef ES_USE_ISR_CHANNELS
+bool ES_PostFromChannel( uint8_t WhichService, ES_Event TheEvent);
+#endif
+#ifdef ES_USE_PREEMPTION
+void ES_Preempt( void );
+void ES_PreemptActivate( void );
+void ES_SchedLock( void );
+void ES_SchedUnlock( void );
+#endif
+#ifdef ES_USE_PROFILER
+bool ES_GetServiceProfile( uint8_t WhichService, ES_ServiceProfile_t *pProfile );
+void ES_ClearProfile( void );
+void ES_DumpProfile( void );
+#endif
+#ifdef ES_USE_WAIT_STATS
+bool ES_GetWaitStats( uint8_t WhichPriority, ES_WaitStats_t *pStats );
+void ES_ClearWaitStats( void );
+void ES_DumpWaitStats( void );
+#endif
 
 #endif   // ES_Framework_H
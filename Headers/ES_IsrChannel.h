@@ -0,0 +1,38 @@
+/****************************************************************************
+ Module
+     ES_IsrChannel.h
+ Description
+     header file for the lock-free channels that carry events from interrupt
+     responses to the framework
+ Notes
+     Only available when ES_USE_ISR_CHANNELS is defined in ES_Configure.h.
+     The channels themselves are named in ISR_CHANNEL_LIST, and each one is
+     referred to as ES_CHANNEL_<name>, for example ES_CHANNEL_ShortTimer
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+*****************************************************************************/
+#ifndef ES_IsrChannel_H
+#define ES_IsrChannel_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+#ifdef ES_USE_ISR_CHANNELS
+
+#define ES_CHANNEL_ID(_name_, _size_) ES_CHANNEL_##_name_,
+
+typedef enum { ISR_CHANNEL_LIST(ES_CHANNEL_ID)
+               ES_NUM_CHANNELS
+} ES_ChannelId_t;
+
+bool ES_ChannelPost( ES_ChannelId_t WhichChannel, uint8_t WhichService,
+                     ES_Event ThisEvent );
+void ES_ChannelDrain( void );
+bool ES_ChannelsPending( void );
+uint16_t ES_ChannelOverruns( ES_ChannelId_t WhichChannel );
+
+#endif /* ES_USE_ISR_CHANNELS */
+
+#endif /* ES_IsrChannel_H */
@@ -3,8 +3,8 @@
      ES_LookupTables.h
  Description
      Extern declarations for a set of constant lookup tables that are used in
-     multiple places in the framework and beyond. 
-     
+     multiple places in the framework and beyond.
+
  Notes
      As a rule, I don't approve of global variables for a host of reasons.
      In this case I decided to make them global in the interests of
@@ -23,7 +23,30 @@
  08/05/13 15:45 jec      added #include for ES_Types.h since we depend on it
  01/15/12 13:03 jec      started coding
 *****************************************************************************/
+#ifndef ES_LookupTables_H
+#define ES_LookupTables_H
+
 #include "ES_Types.h"
+#include "ES_Configure.h"
+
+/*
+  The Ready variable and the timer active flags are both held in an
+  ES_BitFlags_t. It is sized to hold the larger of MAX_NUM_SERVICES and
+  MAX_NUM_TIMERS bits. ES_FLAG_BITS is the number of bits in that word.
+*/
+#if (MAX_NUM_SERVICES > 64) || (MAX_NUM_TIMERS > 64)
+#error "MAX_NUM_SERVICES and MAX_NUM_TIMERS can be no larger than 64"
+#elif (MAX_NUM_SERVICES > 32) || (MAX_NUM_TIMERS > 32)
+typedef uint64_t ES_BitFlags_t;
+#define ES_FLAG_BITS 64
+#elif (MAX_NUM_SERVICES > 16) || (MAX_NUM_TIMERS > 16)
+typedef uint32_t ES_BitFlags_t;
+#define ES_FLAG_BITS 32
+#else
+typedef uint16_t ES_BitFlags_t;
+#define ES_FLAG_BITS 16
+#endif
+
 /*
   Since we moved up to 16 timers & services, this table got too big to justify
   having a separate table for the clear and set masks, so just #define the
@@ -32,16 +55,16 @@
 #define BitNum2ClrMask ~BitNum2SetMask
 
 /*
-  this table is used to go from a bit number (0-7) to the mask used to set
-  that bit in a byte.
+  this table is used to go from a bit number (0 to ES_FLAG_BITS-1) to the mask
+  used to set that bit in a flag word.
 */
-extern uint16_t const BitNum2SetMask[];
+extern ES_BitFlags_t const BitNum2SetMask[];
 
 /*
   this table is used to go from an unsigned 4bit value to the most significant
   bit that is set in that nybble. It is used in the determination of priorities
-  from the Ready variable and in determining active timers in 
-  the timer interrupt response. Index into the array with (ByteVal-1) to get 
+  from the Ready variable and in determining active timers in
+  the timer interrupt response. Index into the array with (ByteVal-1) to get
   the correct MS Bit num.
 */
 extern uint8_t const Nybble2MSBitNum[15];
@@ -50,14 +73,17 @@ extern uint8_t const Nybble2MSBitNum[15];
  Function
    ES_GetMSBSet
  Parameters
-   uint16_t  Val2Check The number to find the MSB in
+   ES_BitFlags_t  Val2Check The number to find the MSB in
  Returns
    bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
  Description
    find the MSB that is set in Val2Check and returns that bit number
  Notes
-   
+   uses a count-leading-zeros instruction if ES_USE_CLZ_DISPATCH is defined
+   and the Nybble2MSBitNum table if not
  Author
    J. Edward Carryer, 10/20/13, 17:03
 ****************************************************************************/
-uint8_t ES_GetMSBitSet( uint16_t Val2Check);
+uint8_t ES_GetMSBitSet( ES_BitFlags_t Val2Check);
+
+#endif /* ES_LookupTables_H */
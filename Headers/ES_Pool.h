@@ -0,0 +1,31 @@
+/****************************************************************************
+ Module
+     ES_Pool.h
+ Description
+     header file for the pool of reference counted event payload blocks
+ Notes
+     Only available when ES_USE_EVENT_POOL is defined in ES_Configure.h.
+     An event carries a payload when ES_EVENT_HAS_PAYLOAD(EventType) is true;
+     the framework then takes a reference for each queue the event is posted
+     to and drops it after the run function that received it returns.
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+*****************************************************************************/
+#ifndef ES_Pool_H
+#define ES_Pool_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+
+#ifdef ES_USE_EVENT_POOL
+
+void *ES_PoolAlloc( void );
+void ES_PoolAddRef( void *pBlock );
+void ES_PoolRelease( void *pBlock );
+uint8_t ES_PoolNumFree( void );
+uint8_t ES_PoolMinFree( void );
+
+#endif /* ES_USE_EVENT_POOL */
+
+#endif /* ES_Pool_H */
@@ -26,9 +26,10 @@
 #include <stdio.h>
 #include <stdint.h>
 #include "termio.h"
-#include "bitdefs.h"       /* generic bit defs (BIT0HI, BIT0LO,...) */
+#include "BITDEFS.H"       /* generic bit defs (BIT0HI, BIT0LO,...) */
 #include "Bin_Const.h"     /* macros to specify binary constants in C */
 #include "ES_Types.h"
+#include "ES_Record.h"
 
 // macro to control the use of C99 data types (or simulations in case you don't
 // have a C99 compiler).
@@ -50,20 +51,71 @@
 
 // these macros provide the wrappers for critical regions, where ints will be off
 // but the state of the interrupt enable prior to entry will be restored.
-// allocation of temp var for saving interrupt enable status should be defined
-// in ES_Port.c
+// The regions nest. Only the outermost EnterCritical saves the mask, in
+// _CriticalSave, and only the ExitCritical that matches it puts the mask
+// back. Both it and _CriticalDepth are only written with the mask up, so an
+// interrupt response with a region of its own can only come between
+// regions, and leaves them as it found them. They are defined in ES_Queue.c
 
 // Cortex M-series processors 
+// (the host build, ES_HOST, simulates PRIMASK and BASEPRI in
+// Host/ES_HostPort.c)
 // The Interrupt Program Status Register (IPSR) contains the exception type number
 // of the current interrupt service routine (ISR)
 // Using TivaWare, CPUcpsid() - IntMasterDisable() calls this. Equivalent to __diable_irq()?
-extern uint32_t _PRIMASK_temp;
+extern uint32_t _CriticalSave;
+extern uint8_t _CriticalDepth;
 uint32_t CPUgetPRIMASK_cpsid(void);
 void CPUsetPRIMASK(uint32_t newPRIMASK);
 
+// with ES_USE_BASEPRI the mask is BASEPRI, raised to ES_CRITICAL_PRIORITY,
+// and the interrupts above that are left on
+#ifdef ES_USE_BASEPRI
+#if ES_CRITICAL_PRIORITY == 0
+#error "ES_CRITICAL_PRIORITY must not be 0x00, a BASEPRI of 0 masks nothing"
+#endif
+// the sampling interrupt must be above the critical regions to get past them,
+// and a higher priority has a lower number
+#if ES_SAMPLING_PRIORITY >= ES_CRITICAL_PRIORITY
+#error "ES_SAMPLING_PRIORITY must be a lower number than ES_CRITICAL_PRIORITY"
+#endif
+uint32_t CPUgetBASEPRI_raise(uint32_t newBASEPRI);
+void CPUsetBASEPRI(uint32_t newBASEPRI);
+#define _CRITICAL_MASK_RAISE()      CPUgetBASEPRI_raise(ES_CRITICAL_PRIORITY)
+#define _CRITICAL_MASK_SET(_mask_)  CPUsetBASEPRI(_mask_)
+#else
+#define _CRITICAL_MASK_RAISE()      CPUgetPRIMASK_cpsid()
+#define _CRITICAL_MASK_SET(_mask_)  CPUsetPRIMASK(_mask_)
+#endif
 
-#define EnterCritical()	{ _PRIMASK_temp = CPUgetPRIMASK_cpsid(); }
-#define ExitCritical() { CPUsetPRIMASK(_PRIMASK_temp); }
+#define EnterCritical()	{ uint32_t _Mask = _CRITICAL_MASK_RAISE(); \
+                          if ( _CriticalDepth++ == 0 ) _CriticalSave = _Mask; }
+#define ExitCritical() { if ( --_CriticalDepth == 0 ) \
+                           _CRITICAL_MASK_SET(_CriticalSave); }
+
+// count the leading zeros in a 32 bit word. This maps onto the single cycle
+// CLZ instruction on the Cortex M4 and is used by ES_GetMSBitSet when
+// ES_USE_CLZ_DISPATCH is defined. The result is undefined for a value of 0,
+// so test for 0 before using it.
+#if defined(__GNUC__)
+#define ES_CLZ32(_val_)  ((uint8_t)__builtin_clz((uint32_t)(_val_)))
+#elif defined(rvmdk) || defined(__ARMCC_VERSION)
+#define ES_CLZ32(_val_)  ((uint8_t)__clz((uint32_t)(_val_)))
+#endif
+
+// a memory barrier, so that the entries in the lock-free rings (ES_IsrChannel.c
+// and ES_SpscQueue.c) are seen to be written before the index that publishes
+// them, and read before the index that gives them back. Also stops the
+// compiler from moving memory accesses across it. On the host it need not
+// order a store before a later load, which single producer, single consumer
+// rings never rely on, and so costs nothing on x86
+#if defined(ES_HOST)
+#define ES_MEMORY_BARRIER()  __atomic_thread_fence(__ATOMIC_ACQ_REL)
+#elif defined(__GNUC__)
+#define ES_MEMORY_BARRIER()  __asm volatile ("dmb" : : : "memory")
+#elif defined(rvmdk) || defined(__ARMCC_VERSION)
+#define ES_MEMORY_BARRIER()  __dmb(0xF)
+#endif
 
 
 /* Rate constants for programming the SysTick Period to generate tick interrupts.
@@ -91,15 +143,44 @@ typedef enum {	ES_Timer_RATE_OFF  	=   (0),
 // map the generic functions for testing the serial port to actual functions 
 // for this platform. If the C compiler does not provide functions to test
 // and retrieve serial characters, you should write them in ES_Port.c
-#define IsNewKeyReady()  ( kbhit() != 0 )
-#define GetNewKey()      getchar()
+// The keys pass through the input recorder (ES_Record.h)
+#ifndef ES_HOST
+#define IsNewKeyReady()  ES_INPUT_KEY_READY( kbhit() != 0 )
+#define GetNewKey()      ES_INPUT_KEY( getchar() )
+#else
+// on the host, kbhit reads ahead (or takes keys from a script) so the key
+// must be collected through TERMIO_GetChar rather than straight from stdio
+#define IsNewKeyReady()  ES_INPUT_KEY_READY( kbhit() != 0 )
+#define GetNewKey()      ES_INPUT_KEY( TERMIO_GetChar() )
+#endif
 
 // prototypes for the hardware specific routines
 void _HW_Timer_Init(TimerRate_t Rate);
 bool _HW_Process_Pending_Ints( void );
-uint16_t _HW_GetTickCount(void);
+void _HW_Idle( void );
+ES_Time_t _HW_GetTickCount(void);
+void _HW_CycleCounterInit(void);
+uint32_t _HW_GetCycleCount(void);
+
+// ES_Cycles() is the free running count of CPU cycles, for timing stretches
+// of code to the cycle. On the target it reads the DWT CYCCNT register in
+// place, with no call. On the host it is _HW_GetCycleCount, real time from
+// clock_gettime scaled to the same clock. The count wraps every 107
+// seconds, so only take differences, as uint32_t
+#define ES_CYCLES_PER_uS 40
+#ifndef ES_HOST
+#define ES_Cycles()  (*(volatile uint32_t *)0xE0001004UL)
+#else
+#define ES_Cycles()  _HW_GetCycleCount()
+#endif
+#ifdef ES_USE_PREEMPTION
+// true when called from an interrupt response, and the request to run
+// ES_PreemptActivate once the interrupt responses are done
+bool _HW_InInterrupt(void);
+void _HW_PendPreempt(void);
+#endif
 void ConsoleInit(void);
 // and the one Framework function that we define here
-uint16_t ES_Timer_GetTime(void);
+ES_Time_t ES_Timer_GetTime(void);
 
 #endif
@@ -17,17 +17,59 @@
 #ifndef ES_Queue_H
 #define ES_Queue_H
 
+#include "ES_Configure.h"
 #include "ES_Types.h"
 #include "ES_Events.h"
 
+// Queue sizes and counts. With ES_USE_SPSC_QUEUE (ES_SpscQueue.c) the queue
+// header takes ES_QUEUE_HEADER_SLOTS entries at the start of the block and
+// the queue is a power of 2 entries long, otherwise (ES_Queue.c) the header
+// takes one entry and a queue holds at most 255 events. Declare a block of
+// ES_QUEUE_BLOCK_SIZE(n) entries to get a queue that holds at least n
+#ifdef ES_USE_SPSC_QUEUE
+typedef uint16_t ES_QueueIndex_t;
+#define ES_QUEUE_HEADER_SLOTS ((6 + sizeof(ES_Event) - 1) / sizeof(ES_Event))
+#define ES_QUEUE_BLOCK_SIZE(_n_) \
+  (ES_QUEUE_HEADER_SLOTS + ES_POW2_AT_LEAST(_n_))
+#else
+typedef uint8_t ES_QueueIndex_t;
+#define ES_QUEUE_BLOCK_SIZE(_n_) ((_n_) + 1)
+#endif
+
+// the smallest power of 2 that is at least _n_, for up to 32768
+#define ES_POW2_AT_LEAST(_n_) \
+  ( ((_n_) <= 1) ? 1 : ((_n_) <= 2) ? 2 : ((_n_) <= 4) ? 4 :                 \
+    ((_n_) <= 8) ? 8 : ((_n_) <= 16) ? 16 : ((_n_) <= 32) ? 32 :             \
+    ((_n_) <= 64) ? 64 : ((_n_) <= 128) ? 128 : ((_n_) <= 256) ? 256 :       \
+    ((_n_) <= 512) ? 512 : ((_n_) <= 1024) ? 1024 :                          \
+    ((_n_) <= 2048) ? 2048 : ((_n_) <= 4096) ? 4096 :                        \
+    ((_n_) <= 8192) ? 8192 : ((_n_) <= 16384) ? 16384 : 32768 )
+
+// what ES_EnQueuePolicy does when the queue is full (see ES_Queue.c)
+typedef enum {  ES_QUEUE_REJECT = 0,
+                ES_QUEUE_DROP_OLDEST,
+                ES_QUEUE_OVERWRITE_NEWEST,
+                ES_QUEUE_COALESCE
+} ES_QueuePolicy_t;
+
 /* prototypes for public functions */
 
-uint8_t ES_InitQueue( ES_Event * pBlock, uint8_t BlockSize );
+ES_QueueIndex_t ES_InitQueue( ES_Event * pBlock, ES_QueueIndex_t BlockSize );
 bool ES_EnQueueFIFO( ES_Event * pBlock, ES_Event Event2Add );
+bool ES_EnQueueFIFOInCritical( ES_Event * pBlock, ES_Event Event2Add );
 bool ES_EnQueueLIFO( ES_Event * pBlock, ES_Event Event2Add );
-uint8_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent );
+bool ES_EnQueuePolicy( ES_Event * pBlock, ES_Event Event2Add,
+                       ES_QueuePolicy_t Policy, ES_Event * pLost );
+bool ES_EnQueueBatch( ES_Event * pBlock, const ES_Event * pEvents,
+                      ES_QueueIndex_t NumEvents );
+bool ES_EnQueueBatchLIFO( ES_Event * pBlock, const ES_Event * pEvents,
+                          ES_QueueIndex_t NumEvents );
+ES_QueueIndex_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent );
+ES_QueueIndex_t ES_DeQueueBatch( ES_Event * pBlock, ES_Event * pEvents,
+                                 ES_QueueIndex_t MaxEvents );
 //void EF_FlushQueue( unsigned char * pBlock );
 bool ES_IsQueueEmpty( ES_Event * pBlock );
+ES_QueueIndex_t ES_QueueDepth( ES_Event * pBlock );
 
 #endif /*ES_Queue_H */
 
@@ -0,0 +1,65 @@
+/****************************************************************************
+ Module
+     ES_Record.h
+ Description
+     header file for the input recorder of the Events & Services framework,
+     which captures every external input the framework sees so that a run
+     can be replayed exactly in the host build
+ Notes
+     The input hooks are macros that pass the live value straight through
+     unless ES_USE_RECORD is defined in ES_Configure.h
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+*****************************************************************************/
+#ifndef ES_Record_H
+#define ES_Record_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+
+#ifdef ES_USE_RECORD
+
+typedef enum {  ES_RECORD_OFF,      // inputs pass straight through
+                ES_RECORD_CAPTURE,  // inputs are passed through and logged
+                ES_RECORD_REPLAY    // inputs are taken from a stream
+} ES_RecordMode_t;
+
+void ES_RecordInit( void );
+bool ES_RecordStartReplay( const uint8_t *pStream, uint32_t Length );
+ES_RecordMode_t ES_RecordGetMode( void );
+bool ES_RecordReplayEnded( void );
+void ES_RecordDump( void );
+void ES_RecordDumpTo( void (*pPutByte)(unsigned char) );
+
+// the input hooks, each takes the live input and returns the one to use
+uint16_t ES_RecordTicks( uint16_t LiveTicks );
+uint8_t ES_RecordShortTimeouts( uint8_t LiveMask );
+bool ES_RecordKeyReady( bool LiveReady );
+char ES_RecordKey( char LiveKey );
+bool ES_RecordButton( bool LiveState );
+void ES_RecordADC( uint32_t Data[], uint8_t NumChannels );
+
+#define ES_INPUT_TICKS(_live_)          ES_RecordTicks(_live_)
+#define ES_INPUT_SHORT_TIMEOUTS(_live_) ES_RecordShortTimeouts(_live_)
+#define ES_INPUT_KEY_READY(_live_)      ES_RecordKeyReady(_live_)
+// the live key is only fetched when it is not being replayed, as fetching
+// it blocks until one arrives
+#define ES_INPUT_KEY(_live_) \
+  ( (ES_RecordGetMode() == ES_RECORD_REPLAY) ? ES_RecordKey(0) : \
+                                               ES_RecordKey(_live_) )
+#define ES_INPUT_BUTTON(_live_)         ES_RecordButton(_live_)
+#define ES_INPUT_ADC(_data_, _num_)     ES_RecordADC((_data_), (_num_))
+
+#else
+
+#define ES_INPUT_TICKS(_live_)          (_live_)
+#define ES_INPUT_SHORT_TIMEOUTS(_live_) (_live_)
+#define ES_INPUT_KEY_READY(_live_)      (_live_)
+#define ES_INPUT_KEY(_live_)            (_live_)
+#define ES_INPUT_BUTTON(_live_)         (_live_)
+#define ES_INPUT_ADC(_data_, _num_)
+
+#endif /* ES_USE_RECORD */
+
+#endif /* ES_Record_H */
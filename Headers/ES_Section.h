@@ -0,0 +1,57 @@
+/****************************************************************************
+ Module
+     ES_Section.h
+ Description
+     header file for the code section profiler, which times named stretches
+     of code in CPU cycles
+ Notes
+     The sections are named in SECTION_LIST in ES_Configure.h, and each one
+     is referred to as ES_SECTION_<name>. ES_SECTION_BEGIN and ES_SECTION_END
+     open and close a block, so they must pair up in the same function, and
+     a return from between them skips the timing. With ES_USE_SECTIONS left
+     undefined they are only the braces
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+*****************************************************************************/
+#ifndef ES_Section_H
+#define ES_Section_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Port.h"
+
+#ifdef ES_USE_SECTIONS
+
+#define ES_SECTION_ID(_name_) ES_SECTION_##_name_,
+
+typedef enum { SECTION_LIST(ES_SECTION_ID)
+               ES_NUM_SECTIONS
+} ES_SectionId_t;
+
+// the timing of one section, in cycles of the CPU clock
+typedef struct {
+  uint32_t NumPasses;     // times the section was run
+  uint32_t MinCycles;     // shortest pass
+  uint32_t MaxCycles;     // longest pass
+  uint64_t TotalCycles;   // all of the passes, divide by NumPasses for mean
+} ES_SectionStats_t;
+
+void ES_SectionAdd( ES_SectionId_t WhichSection, uint32_t Cycles );
+bool ES_GetSectionStats( ES_SectionId_t WhichSection,
+                         ES_SectionStats_t *pStats );
+void ES_ClearSections( void );
+void ES_DumpSections( void );
+
+#define ES_SECTION_BEGIN(_name_) { uint32_t _SectionStart = ES_Cycles();
+#define ES_SECTION_END(_name_) \
+  ES_SectionAdd( ES_SECTION_##_name_, ES_Cycles() - _SectionStart ); }
+
+#else
+
+#define ES_SECTION_BEGIN(_name_) {
+#define ES_SECTION_END(_name_) }
+
+#endif /* ES_USE_SECTIONS */
+
+#endif /* ES_Section_H */
@@ -4,72 +4,51 @@
  Description
      This file serves to keep the clutter down in ES_Framework.h
  Notes
+     Everything here is generated from SERVICE_LIST in ES_Configure.h, so
+     nothing in this file needs to be edited to add or remove a service.
  History
  When           Who     What/Why
  -------------- ---     --------
  01/15/12 10:35 jec      started coding
 *****************************************************************************/
+#ifndef ES_ServiceHeaders_H
+#define ES_ServiceHeaders_H
 
 #include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+#include "ES_LookupTables.h"
 
-#include SERV_0_HEADER
+// The public functions of each service. These match the prototypes in the
+// service's own header, so a mismatch between the table and the service
+// shows up as a compile error.
+#define ES_SERVICE_PROTOTYPES(_init_, _run_, _post_, _qsize_) \
+  bool _init_( uint8_t Priority );                              \
+  ES_Event _run_( ES_Event ThisEvent );                         \
+  bool _post_( ES_Event ThisEvent );
 
-#if NUM_SERVICES > 1
-#include SERV_1_HEADER
-#endif
-
-#if NUM_SERVICES > 2
-#include SERV_2_HEADER
-#endif
-
-#if NUM_SERVICES > 3
-#include SERV_3_HEADER
-#endif
-
-#if NUM_SERVICES > 4
-#include SERV_4_HEADER
-#endif
-
-#if NUM_SERVICES > 5
-#include SERV_5_HEADER
-#endif
-
-#if NUM_SERVICES > 6
-#include SERV_6_HEADER
-#endif
+SERVICE_LIST(ES_SERVICE_PROTOTYPES)
 
-#if NUM_SERVICES > 7
-#include SERV_7_HEADER
-#endif
-
-#if NUM_SERVICES > 8
-#include SERV_8_HEADER
-#endif
+// The priority of each service is its position in SERVICE_LIST.
+// ES_PRIORITY(RunFunc) names it at compile time, for example
+// ES_PRIORITY(RunLEDService), and ES_PRIORITY_MASK(RunFunc) is the
+// corresponding bit in the Ready variable.
+#define ES_SERVICE_PRIORITY(_init_, _run_, _post_, _qsize_) ES_PRIO_##_run_,
 
-#if NUM_SERVICES > 9
-#include SERV_9_HEADER
-#endif
+typedef enum { SERVICE_LIST(ES_SERVICE_PRIORITY)
+               ES_NUM_SERVICE_PRIORITIES
+} ES_ServicePriority_t;
 
-#if NUM_SERVICES > 10
-#include SERV_10_HEADER
-#endif
+#define ES_PRIORITY(_run_)       (ES_PRIO_##_run_)
+#define ES_PRIORITY_MASK(_run_)  ((ES_BitFlags_t)1 << ES_PRIO_##_run_)
 
-#if NUM_SERVICES > 11
-#include SERV_11_HEADER
-#endif
+// The number of services that are *actually* used in this application. This
+// expands to (0 +1 +1 ...) so it can still be tested with #if
+#define ES_SERVICE_COUNT(_init_, _run_, _post_, _qsize_) +1
+#define NUM_SERVICES (0 SERVICE_LIST(ES_SERVICE_COUNT))
 
-#if NUM_SERVICES > 12
-#include SERV_12_HEADER
+#if NUM_SERVICES > MAX_NUM_SERVICES
+#error "SERVICE_LIST has more entries than MAX_NUM_SERVICES allows"
 #endif
 
-#if NUM_SERVICES > 13
-#include SERV_13_HEADER
-#endif
-
-#if NUM_SERVICES > 14
-#include SERV_14_HEADER
-#endif
-
-#if NUM_SERVICES > 15
-#include SERV_15_HEADER
-#endif
+#endif /* ES_ServiceHeaders_H */
@@ -3,12 +3,20 @@
 #ifndef ES_ShortTimer_H
 #define ES_ShortTimer_H
 #include <stdint.h>
-#include "driverlib/timer.h"
+#include <stdbool.h>
 #include "ES_Configure.h"
 
-#define SHORT_TIMER_UNUSED MAX_NUM_SERVICES
+// a short timer from ES_ShortTimerCreate, which is also the EventParam of
+// the ES_SHORT_TIMEOUT events that it posts
+typedef uint8_t ES_ShortTimer_t;
+#define ES_SHORT_TIMER_NONE 0xFF
 
-void ES_ShortTimerInit(uint8_t TimeAPrio, uint8_t TimeBPrio);
-void ES_ShortTimerStart( uint32_t Which, uint16_t TimeoutValue);
+ES_ShortTimer_t ES_ShortTimerCreate(uint8_t WhichService);
+bool ES_ShortTimerStart(ES_ShortTimer_t Which, uint32_t Micros);
+bool ES_ShortTimerStop(ES_ShortTimer_t Which);
+bool ES_ShortTimerIsRunning(ES_ShortTimer_t Which);
+#ifdef ES_USE_RECORD
+void ES_ShortTimerPostPending(void);
+#endif
 
 #endif //ES_ShortTimer_H
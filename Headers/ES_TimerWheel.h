@@ -0,0 +1,34 @@
+/****************************************************************************
+ Module
+     ES_TimerWheel.h
+ Description
+     header file for the hierarchical timer wheel that runs the ES_Timers
+     timers when ES_USE_TIMER_WHEEL is defined
+ Notes
+     Timers are numbered from 0 to ES_WHEEL_TIMERS-1. The ES_Timers timers
+     are numbers 0 to MAX_NUM_TIMERS-1.
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+*****************************************************************************/
+#ifndef ES_TimerWheel_H
+#define ES_TimerWheel_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+
+typedef uint16_t ES_WheelIndex_t;
+
+// called by ES_WheelTick for each timer that expires, once it has stopped
+typedef void ES_WheelExpiryFunc_t( ES_WheelIndex_t Which );
+
+void ES_WheelInit( ES_WheelExpiryFunc_t *pExpired );
+bool ES_WheelStart( ES_WheelIndex_t Which, uint32_t Ticks );
+bool ES_WheelStop( ES_WheelIndex_t Which );
+bool ES_WheelIsRunning( ES_WheelIndex_t Which );
+uint32_t ES_WheelRemaining( ES_WheelIndex_t Which );
+uint32_t ES_WheelIdleTicks( uint32_t Max );
+uint32_t ES_WheelSkip( uint32_t Max );
+void ES_WheelTick( void );
+
+#endif /* ES_TimerWheel_H */
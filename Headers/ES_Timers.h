@@ -31,6 +31,7 @@
 #ifndef ES_Timers_H
 #define ES_Timers_H
 
+#include "ES_Configure.h"
 #include "ES_Port.h"
 #include "ES_Types.h"
 
@@ -41,13 +42,75 @@ typedef enum { ES_Timer_ERR           = -1,
                ES_Timer_NOT_ACTIVE    =  0
 } ES_TimerReturn_t;
 
+// the lateness of a periodic timer: the ticks between each time that it
+// came due and its timeout being posted, from ES_Timer_GetJitter
+typedef struct {
+  uint32_t NumExpiries;   // timeouts posted since the stats were cleared
+  uint32_t TotalLate;     // sum of the lateness, divide by NumExpiries for mean
+  ES_Time_t MaxLate;      // the latest that a timeout has been posted
+  uint16_t NumOverruns;   // timeouts posted a whole period or more late
+} ES_TimerJitter_t;
+
+// how far the timers have had to catch up with ticks that built up while
+// the run functions held them off, from ES_Timer_GetCatchUp. With
+// ES_USE_TICKLESS the ticks slept through are caught up too, but as no
+// timer comes due in them they do not make anything late
+typedef struct {
+  uint32_t NumPasses;     // catch-ups taking more than one tick
+  uint16_t MaxDepth;      // the most ticks taken in one catch-up
+  uint32_t NumLate;       // timeouts posted a tick or more after they were due
+  ES_Time_t MaxLate;      // the latest that a timeout has been posted
+} ES_TimerCatchUp_t;
+
+#ifdef ES_NUM_TIMER_HANDLES
+// a timer created at run time. The handles follow on from the numbered
+// timers, and a timer that posts to a service does so with the handle as the
+// EventParam of its ES_TIMEOUT, just as the numbered timers post their number
+typedef uint16_t ES_TimerHandle_t;
+#define ES_TIMER_NO_HANDLE 0xFFFF
+
+// the function that a callback timer calls from the tick response
+typedef void ES_TimerCallback_t( ES_TimerHandle_t Timer );
+#endif
+
+// wrap-safe comparisons of ES_Time_t values, such as those from
+// ES_Timer_GetTime. They are right as long as the two times are less than
+// 2^31 ticks apart
+#define ES_TIME_AFTER(_a_, _b_) \
+  ((int32_t)((ES_Time_t)(_b_) - (ES_Time_t)(_a_)) < 0)
+#define ES_TIME_BEFORE(_a_, _b_)    ES_TIME_AFTER((_b_), (_a_))
+#define ES_TIME_AFTER_EQ(_a_, _b_) \
+  ((int32_t)((ES_Time_t)(_a_) - (ES_Time_t)(_b_)) >= 0)
+#define ES_TIME_BEFORE_EQ(_a_, _b_) ES_TIME_AFTER_EQ((_b_), (_a_))
+// the number of ticks since _since_, a time from ES_Timer_GetTime
+#define ES_TIME_SINCE(_since_) \
+  ((ES_Time_t)(ES_Timer_GetTime() - (ES_Time_t)(_since_)))
+
 void             ES_Timer_Init(TimerRate_t Rate);
 void             ES_Timer_Tick_Resp(void);
-ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime);
-ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime);
+void             ES_Timer_CatchUp(uint16_t NumTicks);
+ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint32_t NewTime);
+ES_TimerReturn_t ES_Timer_InitPeriodic(uint8_t Num, uint32_t Period);
+ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint32_t NewTime);
 ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num);
 ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num);
-uint16_t         ES_Timer_GetTime(void);
+ES_Time_t        ES_Timer_GetTime(void);
+#ifdef ES_USE_TICKLESS
+uint32_t         ES_Timer_IdleTicks(uint32_t Max);
+#endif
+bool             ES_Timer_GetJitter(uint8_t Num, ES_TimerJitter_t *pStats);
+void             ES_Timer_ClearJitter(void);
+void             ES_Timer_GetCatchUp(ES_TimerCatchUp_t *pStats);
+void             ES_Timer_ClearCatchUp(void);
+#ifdef ES_NUM_TIMER_HANDLES
+ES_TimerHandle_t ES_TimerCreate(uint8_t WhichService);
+ES_TimerHandle_t ES_TimerCreateCallback(ES_TimerCallback_t *pCallback);
+ES_TimerReturn_t ES_TimerDelete(ES_TimerHandle_t Timer);
+ES_TimerReturn_t ES_TimerStart(ES_TimerHandle_t Timer, uint32_t Ticks);
+ES_TimerReturn_t ES_TimerStartPeriodic(ES_TimerHandle_t Timer, uint32_t Period);
+ES_TimerReturn_t ES_TimerStop(ES_TimerHandle_t Timer);
+bool             ES_TimerIsRunning(ES_TimerHandle_t Timer);
+#endif
 
 #endif   /* ES_Timers_H */
 /*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,69 @@
+/****************************************************************************
+ Module
+     ES_Trace.h
+ Description
+     header file for the binary event trace recorder of the Events & Services
+     framework
+ Notes
+     All of the hooks are macros that compile to nothing unless ES_USE_TRACE
+     is defined in ES_Configure.h
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+*****************************************************************************/
+#ifndef ES_Trace_H
+#define ES_Trace_H
+
+#include "ES_Configure.h"
+#include "ES_Types.h"
+#include "ES_Events.h"
+
+// the kinds of trace record. Keep these in step with Tools/es_trace_decode.py
+typedef enum {  ES_TRACE_POST = 1,      // ES_PostToService/LIFO succeeded
+                ES_TRACE_POST_FAIL,     // a post found the queue full
+                ES_TRACE_POST_ALL,      // ES_PostAll, Service is 0xFF
+                ES_TRACE_DISPATCH,      // ES_Run handed the event to Service
+                ES_TRACE_TIMEOUT,       // framework timer expired, Service is
+                                        // the timer number
+                ES_TRACE_USER,          // application record, see ES_TRACE_USER
+                ES_TRACE_COALESCE       // a post replaced an event of the same
+                                        // type still waiting in the queue
+} ES_TraceKind_t;
+
+// use for the Service field when a record is not tied to a single service
+#define ES_TRACE_NO_SERVICE 0xFF
+
+#ifdef ES_USE_TRACE
+
+// one trace record, 8 bytes, written to the console in this byte order
+// (little endian) by ES_TraceDump
+typedef struct {
+  uint16_t Tick;        // low 16 bits of ES_Timer_GetTime() when recorded
+  uint8_t  Seq;         // rolling sequence number, shows lost records
+  uint8_t  Kind;        // one of ES_TraceKind_t
+  uint8_t  Service;     // service priority, timer number or 0xFF
+  uint8_t  EventType;   // ES_EventTyp_t, truncated to 8 bits
+  uint16_t Param;       // EventParam
+} ES_TraceRec_t;
+
+void ES_TraceRecord( uint8_t Kind, uint8_t Service, uint8_t EventType,
+                     uint16_t Param );
+void ES_TraceDump( void );
+void ES_TraceClear( void );
+
+#define ES_TRACE(_kind_, _serv_, _event_) \
+  ES_TraceRecord( (_kind_), (_serv_), (uint8_t)(_event_).EventType, \
+                  (_event_).EventParam )
+
+// lets a service drop its own marker into the trace in place of a printf
+#define ES_TRACE_USER_REC(_serv_, _param_) \
+  ES_TraceRecord( ES_TRACE_USER, (_serv_), 0, (_param_) )
+
+#else
+
+#define ES_TRACE(_kind_, _serv_, _event_)
+#define ES_TRACE_USER_REC(_serv_, _param_)
+
+#endif /* ES_USE_TRACE */
+
+#endif /* ES_Trace_H */
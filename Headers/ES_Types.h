@@ -34,5 +34,10 @@
 #include "stdbool.h"
 #endif
 
+/* the free running tick count of the framework (ES_Timer_GetTime). At a 1mS
+   tick it wraps after 49.7 days, so compare times with the ES_TIME_ macros
+   in ES_Timers.h, which allow for the wrap */
+typedef uint32_t ES_Time_t;
+
 
 #endif /* ES_TYPES_H */
@@ -17,6 +17,15 @@ bool InitWatertubeService ( uint8_t Priority );
 bool PostWatertubeService( ES_Event ThisEvent );
 ES_Event RunWatertubeService( ES_Event ThisEvent );
 
+#define NUM_WATER_TUBES 7
+
+// the payload of a WATER_HEIGHTS event (with ES_USE_EVENT_POOL), which sets
+// tubes 1 to NumTubes at once
+typedef struct {
+  uint8_t NumTubes;
+  float   Height[NUM_WATER_TUBES];
+} WaterHeights_t;
+
 typedef enum { WaterInitState,
 	             WaterDisplayState,
                WaterSleepingState
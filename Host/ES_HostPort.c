@@ -0,0 +1,876 @@
+/****************************************************************************
+ Module
+   ES_HostPort.c
+
+ Revision
+   1.0.1
+
+ Description
+   The host (Linux) simulation port of the Events & Services Framework. It
+   replaces Source/ES_Port.c, providing the same hardware specific
+   functions, and adds a virtual clock, a simulated NVIC & SysTick and a
+   simulated register file behind HWREG so that the framework, the timers
+   and the services can run, be tested and be benchmarked off the board.
+
+ Notes
+   Virtual time is counted in cycles of a simulated 40MHz CPU. It only moves
+   forward in _HW_Process_Pending_Ints and _HW_Idle, the two places that
+   ES_Run polls for interrupts, so simulated interrupt handlers run between
+   run functions, never in the middle of one. With a time scale of 0, code
+   takes no virtual time at all and _HW_Idle jumps straight to the next
+   interrupt, so minutes of a performance run in seconds.
+
+   With ES_USE_PREEMPTION, Host_YieldPoint is a third place. It is called
+   for every character written to the console, which is where the slow run
+   functions spend their time on the target, and at a time scale above 0 it
+   brings the clock up to date. A simulated PendSV then runs
+   ES_PreemptActivate after the interrupt handlers, nested inside the run
+   function that was writing, just as it would on the target.
+
+   The environment variables read at start up are:
+     ES_HOST_TIME_SCALE   virtual seconds per real second, 0 = flat out
+     ES_HOST_RUN_SECONDS  exit after this many virtual seconds
+     ES_HOST_RECORD       with ES_USE_RECORD, write the input stream to
+                          this file on exit
+     ES_HOST_REPLAY       with ES_USE_RECORD, take the inputs from this
+                          file (an ES_RecordDump, or a console log holding
+                          one) and exit when they run out
+   see also ES_HOST_KEYS in HostTermio.c and ES_HOST_TONE in HostADFrames.c
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/systick.h"
+#include "ES_Port.h"
+#include "ES_Types.h"
+#include "ES_General.h"
+#include "ES_Timers.h"
+#include "ES_ShortTimer.h"
+#include "ES_IsrChannel.h"
+#include "ES_Framework.h"
+#include "ES_HostPort.h"
+#include "ADFrames.h"
+
+#define NS_PER_SEC        1000000000ULL
+#define NO_DEADLINE       UINT64_MAX
+
+// longest real time that _HW_Idle will sleep at once, so that the keyboard
+// stays responsive at slow time scales
+#define MAX_IDLE_SLEEP_NS 1000000UL
+
+// size of the simulated register file, must be a power of 2 and larger than
+// the number of distinct register addresses that the program touches
+#define NUM_HOST_REGS     1024
+
+// the interrupt handlers, as listed in the vector table in
+// StartUp/startup_rvmdk.S. ADCFrameHandler is run by the Timer 3A time-out
+// here, as HostADFrames.c has no ADC1 or uDMA to raise ADC1 SS3
+void ShortTimerAHandler(void);
+void ADCFrameHandler(void);
+
+typedef struct {
+  uint32_t Interrupt;
+  void (*Handler)(void);
+} HostVector_t;
+
+static const HostVector_t HostVectors[] = {
+  { INT_TIMER5A_TM4C123, ShortTimerAHandler },
+  { INT_TIMER3A_TM4C123, ADCFrameHandler },
+};
+
+typedef struct {
+  uint32_t Address;
+  bool     InUse;
+  volatile uint32_t Value;
+} HostReg_t;
+
+// TickCount & SysTickCounter play the same roles as in Source/ES_Port.c
+static volatile uint16_t TickCount;
+static volatile ES_Time_t SysTickCounter = 0;
+#ifdef ES_USE_TICKLESS
+// as in Source/ES_Port.c, the ticks that the next tick interrupt stands for
+static uint16_t TickStep = 1;
+#endif
+// the tick interrupts taken, for the report
+static uint32_t NumTickInts;
+
+// the simulated PRIMASK, BASEPRI and NVIC
+static uint32_t Primask;
+static uint32_t Basepri;
+static uint8_t IntPriority[NUM_INTERRUPTS];
+static bool MasterEnabled;
+static bool IntEnabled[NUM_INTERRUPTS];
+static bool IntPending[NUM_INTERRUPTS];
+static bool InHandler;      // running a simulated interrupt handler
+#ifdef ES_USE_PREEMPTION
+static bool PendSVPending;  // the simulated PendSV
+#endif
+
+// the simulated SysTick
+static uint32_t SysTickPeriod;
+static bool SysTickRunning;
+static bool SysTickIntOn;
+static uint64_t NextSysTick = NO_DEADLINE;
+
+// the virtual clock
+static uint64_t VirtualNow;
+static double TimeScale = 1.0;
+static uint64_t StopAt = NO_DEADLINE;
+static struct timespec RealStart;       // real time at the last re-base
+static uint64_t VirtualAtStart;         // virtual time at the last re-base
+static struct timespec RealLaunch;      // real time when the clock started
+static bool ClockStarted;
+
+static HostReg_t HostRegs[NUM_HOST_REGS];
+
+#ifdef ES_USE_RECORD
+static FILE *pRecordFile;   // where SaveRecording is writing to
+#endif
+
+static void StartClock( void );
+static void AdvanceTo( uint64_t Target );
+static uint64_t NextDeadline( void );
+static uint64_t ScaledNow( void );
+static void DeliverPending( void );
+static bool IsMasked( uint32_t Interrupt );
+static uint64_t RealNanos( void );
+static void Report( void );
+#ifdef ES_USE_TICKLESS
+static bool WorkPending( void );
+static void StretchTick( uint32_t SleepTicks );
+static void ShrinkTick( uint32_t SleepTicks );
+#endif
+static void ProcessPending( void );
+#ifdef ES_USE_RECORD
+static void StartRecorder( void );
+static void SaveRecording( void );
+static void PutRecordByte( unsigned char Byte );
+#endif
+
+/****************************************************************************
+ Function
+     _HW_Timer_Init
+ Parameters
+     TimerRate_t Rate set to one of the ES_Timer_RATE_XX values to set the
+     Tick rate
+ Returns
+     None.
+ Description
+     sets up the simulated SysTick and starts the virtual clock
+ Notes
+     this is the first port function that ES_Initialize calls, so it also
+     picks up the settings from the environment
+****************************************************************************/
+void _HW_Timer_Init(TimerRate_t Rate)
+{
+#ifdef ES_USE_BASEPRI
+  uint32_t Interrupt;
+
+  // as on the target, every interrupt starts at the masked priority
+  for ( Interrupt = INT_GPIOA_TM4C123; Interrupt < NUM_INTERRUPTS; Interrupt++ )
+    IntPrioritySet( Interrupt, ES_CRITICAL_PRIORITY );
+  IntPrioritySet( FAULT_SYSTICK, ES_CRITICAL_PRIORITY );
+#endif
+  StartClock();
+  SysTickPeriodSet(Rate);     /* Set the SysTick Interrupt Rate */
+  SysTickIntEnable();         /* Enable the SysTick Interrupt */
+  SysTickEnable();            /* Enable SysTick */
+  IntMasterEnable();          /* Make sure interrupts are enabled */
+}
+
+/****************************************************************************
+ Function
+     SysTickIntHandler
+ Parameters
+     none
+ Returns
+     None.
+ Description
+     response routine for the simulated tick interrupt, the same as the
+     target version
+****************************************************************************/
+void SysTickIntHandler(void)
+{
+  NumTickInts++;
+#ifdef ES_USE_TICKLESS
+  // a stretched tick stands for all of the ticks that it slept through
+  TickCount += TickStep;
+  SysTickCounter += TickStep;
+  TickStep = 1;
+#else
+  ++TickCount;          /* flag that it occurred and needs a response */
+  ++SysTickCounter;     // keep the free running time going
+#endif
+#ifdef ES_USE_PREEMPTION
+  _HW_PendPreempt();    // respond now, not when the running service is done
+#endif
+}
+
+/****************************************************************************
+ Function
+    _HW_GetTickCount()
+ Parameters
+    none
+ Returns
+    ES_Time_t  count of number of system ticks that have occurred.
+ Description
+    wrapper for access to SysTickCounter
+****************************************************************************/
+ES_Time_t _HW_GetTickCount(void)
+{
+   return (SysTickCounter);
+}
+
+/****************************************************************************
+ Function
+     _HW_Process_Pending_Ints
+ Parameters
+     none
+ Returns
+     always true.
+ Description
+     brings the virtual clock up to date, running the handlers for any
+     simulated interrupts that came due, and then runs the framework tick
+     response for each tick, as the target version does
+ Notes
+     at a time scale of 0 virtual time does not move here, it only moves
+     when the framework is idle. With ES_USE_PREEMPTION only the outermost
+     call does the work, as on the target
+****************************************************************************/
+bool _HW_Process_Pending_Ints( void )
+{
+#ifdef ES_USE_PREEMPTION
+   static bool Busy;
+   static bool Again;
+   bool Done;
+
+   EnterCritical();
+   if ( Busy ){
+      Again = true;   // leave it to the outer call
+      ExitCritical();
+      return true;
+   }
+   Busy = true;
+   ExitCritical();
+   ES_SchedLock();
+   do{
+      ProcessPending();
+      EnterCritical();
+      Done = !Again;
+      Again = false;
+      Busy = !Done;
+      ExitCritical();
+   }while ( !Done );
+   ES_SchedUnlock();
+#else
+   ProcessPending();
+#endif
+   return true; // always return true to allow loop test in ES_Run to proceed
+}
+
+// the body of _HW_Process_Pending_Ints
+static void ProcessPending( void )
+{
+   uint16_t NumTicks;
+
+   if ( TimeScale > 0 )
+      AdvanceTo( ScaledNow() );
+#ifdef ES_USE_RECORD
+   NumTicks = ES_INPUT_TICKS(TickCount);
+   TickCount = 0;
+   if ( ES_RecordReplayEnded() )
+      exit(0);
+   ES_Timer_CatchUp(NumTicks);
+   ES_ShortTimerPostPending();
+#else
+   // as on the target, the ticks that have built up are taken together
+   while ( (NumTicks = TickCount) > 0 )
+   {
+      TickCount = 0;
+      ES_Timer_CatchUp(NumTicks);
+   }
+#endif
+#ifdef ES_USE_ISR_CHANNELS
+   ES_ChannelDrain(); // post the events that interrupt responses left
+#endif
+}
+
+/****************************************************************************
+ Function
+     _HW_Idle
+ Parameters
+     none
+ Returns
+     none
+ Description
+     called by ES_Run when there is nothing to do. Moves the virtual clock on
+     to the next simulated interrupt, sleeping for the matching real time
+     unless the time scale is 0
+ Notes
+     exits the program once ES_HOST_RUN_SECONDS of virtual time have passed.
+     With ES_USE_TICKLESS the simulated SysTick is stretched over the ticks
+     with nothing due for the move, as the target does
+****************************************************************************/
+void _HW_Idle( void )
+{
+  uint64_t Next;
+  uint64_t Now;
+  uint64_t SleepNs;
+  struct timespec Sleep;
+#ifdef ES_USE_TICKLESS
+  uint32_t SleepTicks = 1;
+#endif
+
+  if ( VirtualNow >= StopAt )
+    exit(0);    // the report is printed on the way out
+#ifdef ES_USE_TICKLESS
+  if ( WorkPending() )
+    return;
+  SleepTicks = ES_Timer_IdleTicks( ES_TICKLESS_MAX_TICKS - 1 ) + 1;
+  if ( SleepTicks > 1 )
+    StretchTick( SleepTicks );
+#endif
+
+  Next = NextDeadline();
+  if ( Next == NO_DEADLINE )   // nothing scheduled, just step a mS
+    Next = VirtualNow + HOST_CLK_FREQ / 1000;
+  if ( Next > StopAt )
+    Next = StopAt;
+
+  if ( TimeScale <= 0 ){
+    AdvanceTo( Next );
+  }else{
+    Now = ScaledNow();
+    if ( Next > Now ){
+      SleepNs = (uint64_t)((double)(Next - Now) * NS_PER_SEC /
+                           (HOST_CLK_FREQ * TimeScale));
+      if ( SleepNs > MAX_IDLE_SLEEP_NS )
+        SleepNs = MAX_IDLE_SLEEP_NS;
+      Sleep.tv_sec = 0;
+      Sleep.tv_nsec = (long)SleepNs;
+      nanosleep( &Sleep, NULL );
+    }
+    AdvanceTo( ScaledNow() );
+  }
+#ifdef ES_USE_TICKLESS
+  if ( SleepTicks > 1 )
+    ShrinkTick( SleepTicks );
+#endif
+}
+
+/****************************************************************************
+ Function
+    _HW_CycleCounterInit() & _HW_GetCycleCount()
+ Description
+    the profiler's cycle counter. This measures real execution time, from
+    clock_gettime, scaled to 40MHz cycles so that host and target numbers
+    can be compared directly
+****************************************************************************/
+void _HW_CycleCounterInit(void)
+{
+}
+
+uint32_t _HW_GetCycleCount(void)
+{
+  return (uint32_t)(RealNanos() / (NS_PER_SEC / HOST_CLK_FREQ));
+}
+
+#ifdef ES_USE_PREEMPTION
+/****************************************************************************
+ Function
+    _HW_InInterrupt() & _HW_PendPreempt()
+ Description
+    the simulated PendSV. It is taken, running ES_PreemptActivate, once the
+    simulated interrupt handlers are done, if interrupts are enabled
+****************************************************************************/
+bool _HW_InInterrupt(void)
+{
+  return InHandler;
+}
+
+void _HW_PendPreempt(void)
+{
+  PendSVPending = true;
+}
+
+/****************************************************************************
+ Function
+     Host_YieldPoint
+ Description
+     lets the virtual clock catch up with real time, and so lets simulated
+     interrupts, and the preemptions they cause, happen in the middle of a
+     run function. Does nothing at a time scale of 0, where code takes no
+     virtual time, or from inside a handler or a critical region. With
+     ES_USE_BASEPRI a critical region does not stop it, but only the
+     interrupts above ES_CRITICAL_PRIORITY are taken
+****************************************************************************/
+void Host_YieldPoint( void )
+{
+  if ( (TimeScale > 0) && !InHandler && (Primask == 0) )
+    AdvanceTo( ScaledNow() );
+}
+#endif
+
+/****************************************************************************
+ Function
+     ConsoleInit
+ Description
+     nothing to do, the console is stdin/stdout (see HostTermio.c)
+****************************************************************************/
+void ConsoleInit(void)
+{
+}
+
+/****************************************************************************
+ Function
+     CPUgetPRIMASK_cpsid & CPUsetPRIMASK
+ Description
+     the simulated PRIMASK used by EnterCritical & ExitCritical. Simulated
+     interrupts are held pending while it is set
+****************************************************************************/
+uint32_t CPUgetPRIMASK_cpsid(void)
+{
+  uint32_t OldPrimask = Primask;
+  Primask = 1;
+  return OldPrimask;
+}
+
+void CPUsetPRIMASK(uint32_t newPRIMASK)
+{
+  Primask = newPRIMASK;
+}
+
+#ifdef ES_USE_BASEPRI
+/****************************************************************************
+ Function
+     CPUgetBASEPRI_raise & CPUsetBASEPRI
+ Description
+     the simulated BASEPRI used by EnterCritical & ExitCritical. Simulated
+     interrupts at its priority or below are held pending while it is set.
+     The raise works as BASEPRI_MAX does, never lowering it
+****************************************************************************/
+uint32_t CPUgetBASEPRI_raise(uint32_t newBASEPRI)
+{
+  uint32_t OldBasepri = Basepri;
+  if ( (Basepri == 0) || (newBASEPRI < Basepri) )
+    Basepri = newBASEPRI;
+  return OldBasepri;
+}
+
+void CPUsetBASEPRI(uint32_t newBASEPRI)
+{
+  Basepri = newBASEPRI;
+}
+#endif
+
+/*------------------------ Simulated NVIC & SysTick ----------------------*/
+bool IntMasterEnable(void)
+{
+  bool WasDisabled = !MasterEnabled;
+  MasterEnabled = true;
+  return WasDisabled;
+}
+
+bool IntMasterDisable(void)
+{
+  bool WasDisabled = !MasterEnabled;
+  MasterEnabled = false;
+  return WasDisabled;
+}
+
+void IntEnable(uint32_t ui32Interrupt)
+{
+  if ( ui32Interrupt < NUM_INTERRUPTS )
+    IntEnabled[ui32Interrupt] = true;
+}
+
+void IntDisable(uint32_t ui32Interrupt)
+{
+  if ( ui32Interrupt < NUM_INTERRUPTS )
+    IntEnabled[ui32Interrupt] = false;
+}
+
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority)
+{
+  // only BASEPRI looks at it, the handlers never preempt each other
+  if ( ui32Interrupt < NUM_INTERRUPTS )
+    IntPriority[ui32Interrupt] = ui8Priority;
+}
+
+void IntPendSet(uint32_t ui32Interrupt)
+{
+  Host_RaiseInterrupt( ui32Interrupt );
+}
+
+void Host_RaiseInterrupt( uint32_t Interrupt )
+{
+  if ( Interrupt < NUM_INTERRUPTS )
+    IntPending[Interrupt] = true;
+}
+
+void SysTickEnable(void)
+{
+  SysTickRunning = true;
+  NextSysTick = VirtualNow + SysTickPeriod;
+}
+
+void SysTickDisable(void)
+{
+  SysTickRunning = false;
+  NextSysTick = NO_DEADLINE;
+}
+
+void SysTickIntEnable(void)
+{
+  SysTickIntOn = true;
+}
+
+void SysTickIntDisable(void)
+{
+  SysTickIntOn = false;
+}
+
+void SysTickPeriodSet(uint32_t ui32Period)
+{
+  SysTickPeriod = ui32Period;
+}
+
+uint32_t SysTickPeriodGet(void)
+{
+  return SysTickPeriod;
+}
+
+uint32_t SysTickValueGet(void)
+{
+  if ( !SysTickRunning )
+    return 0;
+  return (uint32_t)(NextSysTick - VirtualNow);
+}
+
+/*------------------------ Simulated register file -----------------------*/
+/****************************************************************************
+ Function
+     HostReg
+ Parameters
+     uint32_t Address, the register address
+ Returns
+     pointer to the simulated register
+ Description
+     the target of HWREG on the host. Registers spring into existence,
+     holding 0, the first time that they are touched
+****************************************************************************/
+volatile uint32_t *HostReg(uint32_t Address)
+{
+  uint32_t Index = (Address >> 2) & (NUM_HOST_REGS - 1);
+  uint32_t Probes;
+
+  for ( Probes = 0; Probes < NUM_HOST_REGS; Probes++ ){
+    if ( !HostRegs[Index].InUse ){
+      HostRegs[Index].InUse = true;
+      HostRegs[Index].Address = Address;
+      HostRegs[Index].Value = 0;
+      return &HostRegs[Index].Value;
+    }
+    if ( HostRegs[Index].Address == Address )
+      return &HostRegs[Index].Value;
+    Index = (Index + 1) & (NUM_HOST_REGS - 1);
+  }
+  fprintf(stderr, "host: register file full at 0x%08X\n", Address);
+  exit(1);
+}
+
+/*------------------------------ Virtual clock ---------------------------*/
+void Host_SetTimeScale( double Scale )
+{
+  // re-base so that virtual time carries on smoothly from here
+  VirtualAtStart = VirtualNow;
+  clock_gettime( CLOCK_MONOTONIC, &RealStart );
+  TimeScale = Scale;
+}
+
+uint64_t Host_GetVirtualCycles( void )
+{
+  return VirtualNow;
+}
+
+uint32_t Host_GetVirtualMillis( void )
+{
+  return (uint32_t)(VirtualNow / (HOST_CLK_FREQ / 1000));
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static void StartClock( void )
+{
+  const char *pSetting;
+
+  if ( ClockStarted )
+    return;
+  ClockStarted = true;
+  clock_gettime( CLOCK_MONOTONIC, &RealLaunch );
+  pSetting = getenv("ES_HOST_TIME_SCALE");
+  Host_SetTimeScale( (pSetting != NULL) ? atof(pSetting) : 1.0 );
+  pSetting = getenv("ES_HOST_RUN_SECONDS");
+  if ( pSetting != NULL )
+    StopAt = (uint64_t)(atof(pSetting) * HOST_CLK_FREQ);
+  atexit( Report );
+#ifdef ES_USE_RECORD
+  StartRecorder();
+#endif
+}
+
+// move the virtual clock forward to Target, stopping at each simulated
+// interrupt on the way to run its handler
+static void AdvanceTo( uint64_t Target )
+{
+  uint64_t Next;
+
+  while ( (Next = NextDeadline()) <= Target ){
+    if ( Next > VirtualNow )
+      VirtualNow = Next;
+    if ( SysTickRunning && (NextSysTick <= VirtualNow) ){
+      NextSysTick += SysTickPeriod;
+      if ( SysTickIntOn )
+        IntPending[FAULT_SYSTICK] = true;
+    }
+    HostTimer_Update( VirtualNow );
+    DeliverPending();
+  }
+  if ( Target > VirtualNow )
+    VirtualNow = Target;
+  DeliverPending();
+}
+
+static uint64_t NextDeadline( void )
+{
+  uint64_t Next = HostTimer_NextDeadline();
+
+  if ( SysTickRunning && (NextSysTick < Next) )
+    Next = NextSysTick;
+  return Next;
+}
+
+#ifdef ES_USE_TICKLESS
+// true if a tick or an interrupt response is waiting to be dealt with
+static bool WorkPending( void )
+{
+  if ( (TickCount != 0) || IntPending[FAULT_SYSTICK] )
+    return true;
+#ifdef ES_USE_ISR_CHANNELS
+  return ES_ChannelsPending();
+#else
+  return false;
+#endif
+}
+
+// move the next simulated tick interrupt on to the end of SleepTicks ticks
+static void StretchTick( uint32_t SleepTicks )
+{
+  NextSysTick += (uint64_t)(SleepTicks - 1) * SysTickPeriod;
+  TickStep = SleepTicks;
+}
+
+// if the stretched tick has not come, count the ticks that did go by and
+// bring the tick interrupt back to the next of them
+static void ShrinkTick( uint32_t SleepTicks )
+{
+  uint64_t Next;
+  uint32_t Ticks = 0;
+
+  if ( TickStep == 1 )  // it came, and the handler counted the ticks
+    return;
+  Next = NextSysTick - (uint64_t)(SleepTicks - 1) * SysTickPeriod;
+  if ( VirtualNow >= Next )
+    Ticks = (uint32_t)((VirtualNow - Next) / SysTickPeriod) + 1;
+  TickCount += Ticks;
+  SysTickCounter += Ticks;
+  NextSysTick = Next + (uint64_t)Ticks * SysTickPeriod;
+  TickStep = 1;
+}
+#endif
+
+// the virtual time that corresponds to the present real time
+static uint64_t ScaledNow( void )
+{
+  struct timespec Now;
+  double RealElapsed;
+
+  clock_gettime( CLOCK_MONOTONIC, &Now );
+  RealElapsed = (double)(Now.tv_sec - RealStart.tv_sec) +
+                (double)(Now.tv_nsec - RealStart.tv_nsec) / NS_PER_SEC;
+  return VirtualAtStart + (uint64_t)(RealElapsed * TimeScale * HOST_CLK_FREQ);
+}
+
+// run the handlers for pending interrupts, if they are not masked. A
+// handler that leaves a critical region open would break the one that it
+// came in the middle of, so that stops the run
+static void DeliverPending( void )
+{
+  uint8_t i;
+  uint8_t Depth = _CriticalDepth;
+
+  if ( (Primask != 0) || !MasterEnabled || InHandler )
+    return;
+  InHandler = true;
+  if ( IntPending[FAULT_SYSTICK] && !IsMasked( FAULT_SYSTICK ) ){
+    IntPending[FAULT_SYSTICK] = false;
+    SysTickIntHandler();
+  }
+  for ( i = 0; i < ARRAY_SIZE(HostVectors); i++ ){
+    if ( IntPending[HostVectors[i].Interrupt] &&
+         IntEnabled[HostVectors[i].Interrupt] &&
+         !IsMasked( HostVectors[i].Interrupt ) ){
+      IntPending[HostVectors[i].Interrupt] = false;
+      HostVectors[i].Handler();
+    }
+  }
+  InHandler = false;
+  if ( _CriticalDepth != Depth ){
+    fprintf(stderr, "host: an interrupt handler left a critical region open\n");
+    exit(1);
+  }
+#ifdef ES_USE_PREEMPTION
+  // PendSV is the lowest priority, so it is taken last
+  if ( PendSVPending && !IsMasked( FAULT_PENDSV ) ){
+    PendSVPending = false;
+    ES_PreemptActivate();
+  }
+#endif
+}
+
+// true if BASEPRI holds the interrupt off. PendSV is always the lowest
+// priority, whatever it was set to
+static bool IsMasked( uint32_t Interrupt )
+{
+  if ( Basepri == 0 )
+    return false;
+  return (Interrupt == FAULT_PENDSV) || (IntPriority[Interrupt] >= Basepri);
+}
+
+static uint64_t RealNanos( void )
+{
+  struct timespec Now;
+  clock_gettime( CLOCK_MONOTONIC, &Now );
+  return (uint64_t)Now.tv_sec * NS_PER_SEC + (uint64_t)Now.tv_nsec;
+}
+
+// how much virtual time went by, and how long it took
+#ifdef ES_USE_RECORD
+// sets up a replay or a recording from the environment
+static void StartRecorder( void )
+{
+  const char *pFileName;
+  FILE *pFile;
+  long Length;
+  uint8_t *pStream;
+
+  pFileName = getenv("ES_HOST_REPLAY");
+  if ( pFileName != NULL ){
+    pFile = fopen(pFileName, "rb");
+    if ( (pFile == NULL) || (fseek(pFile, 0, SEEK_END) != 0) ||
+         ((Length = ftell(pFile)) < 0) ){
+      fprintf(stderr, "host: can't read replay %s\n", pFileName);
+      exit(1);
+    }
+    rewind(pFile);
+    pStream = malloc(Length + 1);   // kept until exit, the replay uses it
+    if ( (pStream == NULL) ||
+         (fread(pStream, 1, Length, pFile) != (size_t)Length) ||
+         !ES_RecordStartReplay(pStream, (uint32_t)Length) ){
+      fprintf(stderr, "host: no input recording found in %s\n", pFileName);
+      exit(1);
+    }
+    fclose(pFile);
+    return;
+  }
+  if ( getenv("ES_HOST_RECORD") != NULL )
+    atexit( SaveRecording );
+}
+
+static void SaveRecording( void )
+{
+  const char *pFileName = getenv("ES_HOST_RECORD");
+
+  pRecordFile = fopen(pFileName, "wb");
+  if ( pRecordFile == NULL ){
+    fprintf(stderr, "host: can't write recording %s\n", pFileName);
+    return;
+  }
+  ES_RecordDumpTo( PutRecordByte );
+  fclose(pRecordFile);
+}
+
+static void PutRecordByte( unsigned char Byte )
+{
+  fputc(Byte, pRecordFile);
+}
+#endif
+
+static void Report( void )
+{
+  struct timespec Now;
+  double Real, Virtual;
+  ES_TimerJitter_t Jitter;
+  ES_TimerCatchUp_t CatchUp;
+#ifdef ES_USE_WAIT_STATS
+  ES_WaitStats_t Wait;
+#endif
+  uint8_t i;
+
+  clock_gettime( CLOCK_MONOTONIC, &Now );
+  Real = (double)(Now.tv_sec - RealLaunch.tv_sec) +
+         (double)(Now.tv_nsec - RealLaunch.tv_nsec) / NS_PER_SEC;
+  Virtual = (double)VirtualNow / HOST_CLK_FREQ;
+  fflush(stdout);
+  fprintf(stderr, "\nhost: %.3f s simulated in %.3f s real (x%.1f)\n",
+          Virtual, Real, (Real > 0) ? Virtual / Real : 0.0);
+  fprintf(stderr, "host: %lu tick interrupts, %.1f a second\n",
+          (unsigned long)NumTickInts, (Virtual > 0) ? NumTickInts / Virtual : 0.0);
+  ES_Timer_GetCatchUp( &CatchUp );
+  fprintf(stderr, "host: %lu tick catch-ups of up to %u ticks, %lu timeouts"
+          " late by up to %lu ticks\n", (unsigned long)CatchUp.NumPasses,
+          CatchUp.MaxDepth, (unsigned long)CatchUp.NumLate,
+          (unsigned long)CatchUp.MaxLate);
+  // the lateness of the periodic timers, in ticks
+  for ( i = 0; i < MAX_NUM_TIMERS; i++ ){
+    if ( ES_Timer_GetJitter( i, &Jitter ) && (Jitter.NumExpiries != 0) )
+      fprintf(stderr, "host: timer %u %lu periodic timeouts, late mean %.2f"
+              " max %lu, %u overruns\n", i,
+              (unsigned long)Jitter.NumExpiries,
+              (double)Jitter.TotalLate / Jitter.NumExpiries,
+              (unsigned long)Jitter.MaxLate, Jitter.NumOverruns);
+  }
+#ifdef ES_USE_WAIT_STATS
+  // how long each priority waited to be dispatched once it was ready, in
+  // ticks, and the event checkers last
+  for ( i = 0; ES_GetWaitStats( i, &Wait ); i++ ){
+    if ( Wait.NumBatches != 0 )
+      fprintf(stderr, "host: service %u wait mean %.2f max %lu ticks over"
+              " %lu batches, %u forced\n", i,
+              (double)Wait.TotalWait / Wait.NumBatches,
+              (unsigned long)Wait.MaxWait, (unsigned long)Wait.NumBatches,
+              Wait.NumForced);
+  }
+  ES_GetWaitStats( ES_WAIT_STATS_CHECKERS, &Wait );
+  if ( Wait.NumBatches != 0 )
+    fprintf(stderr, "host: checkers wait mean %.2f max %lu ticks over"
+            " %lu passes, %u forced\n",
+            (double)Wait.TotalWait / Wait.NumBatches,
+            (unsigned long)Wait.MaxWait, (unsigned long)Wait.NumBatches,
+            Wait.NumForced);
+#endif
+#ifdef MIC_USE_ADC_FRAMES
+  fprintf(stderr, "host: %lu ADC frames of %u samples at %u a second\n",
+          (unsigned long)ADC_FrameCount(), ADC_FRAME_LEN, MIC_SAMPLE_RATE);
+#endif
+}
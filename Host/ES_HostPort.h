@@ -0,0 +1,53 @@
+/****************************************************************************
+ Module
+     ES_HostPort.h
+ Description
+     header file for the host (Linux) simulation port of the Events &
+     Services framework. The functions that ES_Port.h asks of a port are
+     provided by ES_HostPort.c; this header adds the controls for the
+     virtual clock and the simulated peripherals.
+ Notes
+     Everything here is only available in an ES_HOST build (see Host/Makefile)
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+*****************************************************************************/
+#ifndef ES_HOSTPORT_H
+#define ES_HOSTPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// the simulated CPU clock, the rate that virtual time is counted at
+#define HOST_CLK_FREQ 40000000UL
+
+// the virtual clock. A time scale of 1.0 runs in step with real time, 60.0
+// runs a minute of virtual time per second, and 0 runs as fast as possible,
+// jumping straight to the next interrupt whenever the framework is idle.
+// The scale is also taken from the ES_HOST_TIME_SCALE environment variable
+void Host_SetTimeScale( double Scale );
+uint64_t Host_GetVirtualCycles( void );
+uint32_t Host_GetVirtualMillis( void );
+
+// used by the simulated peripherals to post an interrupt request to the
+// simulated NVIC. The handler runs the next time the virtual clock is
+// advanced with interrupts enabled
+void Host_RaiseInterrupt( uint32_t Interrupt );
+
+// the simulated general purpose timers (HostDriverlib.c), stepped by the
+// virtual clock
+uint64_t HostTimer_NextDeadline( void );
+void HostTimer_Update( uint64_t Now );
+
+// the simulated analog inputs read by ADC_MultiRead (HostADMulti.c), as
+// 12 bit values
+void Host_SetAnalogInput( uint8_t Channel, uint16_t Value );
+
+// the last pulse width set on a PWM output (HostDriverlib.c)
+uint32_t Host_GetPulseWidth( uint32_t Base, uint32_t PWMOut );
+
+// with ES_USE_PREEMPTION, a point at which a run function can be preempted
+// (HostTermio.c calls it for every character written to the console)
+void Host_YieldPoint( void );
+
+#endif /* ES_HOSTPORT_H */
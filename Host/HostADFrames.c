@@ -0,0 +1,131 @@
+// HostADFrames.c
+// Host (Linux) version of ADFrames.c. In place of ADC1 and the uDMA, Timer 3
+// times out once a frame and its interrupt response, standing in for the
+// ADC1 SS3 interrupt, fills the frame from a signal generator and posts it.
+// The generator gives a tone on top of the same noise as HostADMulti.c, and
+// each sample is the value at its own sample time, so the frames are as
+// evenly sampled as the timer triggered ADC on the board. The tone is taken
+// from ES_HOST_TONE as "<Hz>[:<amplitude in LSBs>]", and is off by default
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <math.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "driverlib/timer.h"
+#include "driverlib/interrupt.h"
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_HostPort.h"
+#include "ADFrames.h"
+
+#if defined(ES_USE_BASEPRI) && !defined(ES_USE_ISR_CHANNELS)
+#error "with ES_USE_BASEPRI the sampling interrupt can only post through a channel"
+#endif
+
+#define ADC_FULL_SCALE 0xFFF
+#define ADC_MID_SCALE 0x800
+#define NOISE_LSBS 8
+#define DEFAULT_TONE_LSBS 500
+#define TWO_PI 6.28318530717958648
+
+void ADCFrameHandler(void);
+static void PostFrame(uint8_t Which);
+
+static uint16_t Frames[2][ADC_FRAME_LEN];
+static uint8_t MyService;
+static uint8_t NextFrame;
+static uint32_t NumFrames;
+static uint32_t Rate;
+// the samples taken since sampling started, which sets the generator phase
+static uint64_t SampleNum;
+static double ToneHz;
+static double ToneLSBs;
+static uint32_t NoiseSeed = 1;
+
+// read the tone for the generator and note the service to post to
+void ADC_FrameInit(uint8_t WhichService){
+  const char *pTone = getenv("ES_HOST_TONE");
+  char *pEnd;
+
+  MyService = WhichService;
+  NumFrames = 0;
+  ToneHz = 0;
+  ToneLSBs = DEFAULT_TONE_LSBS;
+  if (pTone != NULL){
+    ToneHz = strtod(pTone, &pEnd);
+    if (*pEnd == ':')
+      ToneLSBs = strtod(pEnd + 1, NULL);
+  }
+}
+
+//------------ADC_FrameStart------------
+// times out Timer 3 once a frame at SampleRate per second
+bool ADC_FrameStart(uint32_t SampleRate){
+  if ((SampleRate == 0) || (SampleRate > ADC_FRAME_MAX_RATE))
+    return false;
+  Rate = SampleRate;
+  SampleNum = 0;
+  NextFrame = 0;
+  TimerConfigure(TIMER3_BASE, TIMER_CFG_PERIODIC);
+  TimerLoadSet(TIMER3_BASE, TIMER_A,
+               ADC_FRAME_LEN * (HOST_CLK_FREQ / SampleRate));
+  TimerIntClear(TIMER3_BASE, TIMER_TIMA_TIMEOUT);
+  TimerIntEnable(TIMER3_BASE, TIMER_TIMA_TIMEOUT);
+#ifdef ES_USE_BASEPRI
+  IntPrioritySet(INT_TIMER3A_TM4C123, ES_SAMPLING_PRIORITY);
+#endif
+  IntEnable(INT_TIMER3A_TM4C123);
+  TimerEnable(TIMER3_BASE, TIMER_A);
+  return true;
+}
+
+void ADC_FrameStop(void){
+  TimerDisable(TIMER3_BASE, TIMER_A);
+  IntDisable(INT_TIMER3A_TM4C123);
+}
+
+const uint16_t *ADC_FrameData(uint8_t Which){
+  return Frames[Which & 1];
+}
+
+uint32_t ADC_FrameCount(void){
+  return NumFrames;
+}
+
+// the Timer 3A time-out: the frame that would now be full
+void ADCFrameHandler(void){
+  uint16_t i;
+  int32_t Value;
+
+  TimerIntClear(TIMER3_BASE, TIMER_TIMA_TIMEOUT);
+  for (i = 0; i < ADC_FRAME_LEN; i++, SampleNum++){
+    NoiseSeed = NoiseSeed * 1103515245 + 12345;
+    Value = ADC_MID_SCALE + (int32_t)((NoiseSeed >> 16) % (2*NOISE_LSBS + 1))
+            - NOISE_LSBS;
+    if (ToneHz > 0)
+      Value += (int32_t)lround(ToneLSBs *
+                               sin(TWO_PI * ToneHz * SampleNum / Rate));
+    if (Value < 0)
+      Value = 0;
+    if (Value > ADC_FULL_SCALE)
+      Value = ADC_FULL_SCALE;
+    Frames[NextFrame][i] = (uint16_t)Value;
+  }
+  PostFrame(NextFrame);
+  NextFrame ^= 1;
+}
+
+static void PostFrame(uint8_t Which){
+  ES_Event ThisEvent;
+
+  NumFrames++;
+  ThisEvent.EventType = ADC_FRAME_READY;
+  ThisEvent.EventParam = Which;
+#ifdef ES_USE_ISR_CHANNELS
+  ES_ChannelPost(ES_CHANNEL_ADCFrames, MyService, ThisEvent);
+#else
+  ES_PostToService(MyService, ThisEvent);
+#endif
+}
@@ -0,0 +1,53 @@
+// HostADMulti.c
+// Host (Linux) version of ADMulti.c. Instead of ADC0 sample sequencer 2,
+// the conversions return the simulated analog inputs set with
+// Host_SetAnalogInput. A little noise is added to every conversion, as there
+// always is on the real inputs; a perfectly silent microphone input would
+// otherwise give an all zero spectrum
+
+#include <stdint.h>
+#include "ADMulti.h"
+#include "ES_Record.h"
+#include "ES_HostPort.h"
+
+#define NUM_ANALOG_INPUTS 4
+#define ADC_FULL_SCALE 0xFFF
+#define ADC_MID_SCALE 0x800
+#define NOISE_LSBS 8
+
+static uint16_t AnalogInputs[NUM_ANALOG_INPUTS] = {
+  ADC_MID_SCALE, ADC_MID_SCALE, ADC_MID_SCALE, ADC_MID_SCALE };
+static uint32_t NoiseSeed = 1;
+static uint8_t NumChannelsConverting;
+
+// initialize the A/D converter to convert on 1-4 channels
+void ADC_MultiInit(uint8_t HowMany){
+  if ( (0 == HowMany) || (4 < HowMany))
+    return;
+  NumChannelsConverting = HowMany;
+}
+
+//------------ADC_MultiRead------------
+// returns the simulated inputs, lowest numbered channel in data[0]
+void ADC_MultiRead(uint32_t data[4]){
+  uint8_t i;
+  int32_t Value;
+
+  for (i=0; i< NumChannelsConverting; i++){
+    NoiseSeed = NoiseSeed * 1103515245 + 12345;
+    Value = AnalogInputs[i] + (int32_t)((NoiseSeed >> 16) % (2*NOISE_LSBS + 1))
+            - NOISE_LSBS;
+    if (Value < 0)
+      Value = 0;
+    if (Value > ADC_FULL_SCALE)
+      Value = ADC_FULL_SCALE;
+    data[i] = Value;
+  }
+  ES_INPUT_ADC(data, NumChannelsConverting);
+}
+
+// set the value that a channel will read, clipped to 12 bits
+void Host_SetAnalogInput( uint8_t Channel, uint16_t Value ){
+  if ( Channel < NUM_ANALOG_INPUTS )
+    AnalogInputs[Channel] = (Value > ADC_FULL_SCALE) ? ADC_FULL_SCALE : Value;
+}
@@ -0,0 +1,422 @@
+/****************************************************************************
+ Module
+   HostDriverlib.c
+
+ Description
+   Host (Linux) stand-ins for the TivaWare Peripheral Driver Library calls
+   used by this project. System control and GPIO set up calls are accepted
+   and ignored, GPIO data goes through the simulated register file, PWM
+   pulse widths are recorded and the general purpose timers are simulated
+   against the virtual clock in ES_HostPort.c.
+
+ Notes
+   The timers model the count-down modes that this project uses: one-shot
+   and periodic, either as a full width timer (TIMER_A only) or as a split
+   pair. A timer counts Load * (Prescale + 1) cycles of the 40MHz clock, and
+   on time-out sets its raw interrupt status and, if that interrupt is
+   enabled, raises the corresponding interrupt in the simulated NVIC.
+   A full width timer may also count up from 0 to Load, and round again,
+   with a match interrupt each time that the count reaches the match value
+   (the TAMIE bit is taken as set), as ES_ShortTimer.c uses it.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_types.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_gpio.h"
+#include "inc/hw_ints.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pwm.h"
+#include "driverlib/timer.h"
+#include "ES_General.h"
+#include "ES_HostPort.h"
+
+#define NUM_TIMER_MODULES 6
+#define TIMER_MODULE_SPACING 0x1000
+#define NO_DEADLINE UINT64_MAX
+
+#define NUM_PWM_MODULES 2
+#define NUM_PWM_OUTS 8
+#define PWM_OUT_NUM_MASK 0x7
+
+// GPIO data is accessed through the ALL_BITS mask, as the services do
+#define GPIO_DATA_ALL_BITS (GPIO_O_DATA + (0xff << 2))
+
+typedef struct {
+  uint32_t Load;
+  uint32_t Prescale;
+  uint32_t Match;
+  bool     Periodic;
+  bool     CountUp;
+  bool     Enabled;
+  uint64_t Started;     // virtual time when last enabled or reloaded
+  uint64_t Deadline;    // virtual time of the next time-out
+  uint64_t MatchTime;   // virtual time of the next match, counting up
+} HostTimerHalf_t;
+
+typedef struct {
+  bool     Split;
+  uint32_t IntMask;     // enabled interrupt sources
+  uint32_t RawInts;     // raw interrupt status
+  HostTimerHalf_t Half[2];  // [0] is TIMER_A, [1] is TIMER_B
+} HostTimer_t;
+
+static const uint32_t TimeoutFlag[2] = { TIMER_TIMA_TIMEOUT, TIMER_TIMB_TIMEOUT };
+static const uint32_t MatchFlag[2] = { TIMER_TIMA_MATCH, TIMER_TIMB_MATCH };
+
+static const uint32_t TimerInterrupt[NUM_TIMER_MODULES][2] = {
+  { INT_TIMER0A_TM4C123, INT_TIMER0B_TM4C123 },
+  { INT_TIMER1A_TM4C123, INT_TIMER1B_TM4C123 },
+  { INT_TIMER2A_TM4C123, INT_TIMER2B_TM4C123 },
+  { INT_TIMER3A_TM4C123, INT_TIMER3B_TM4C123 },
+  { INT_TIMER4A_TM4C123, INT_TIMER4B_TM4C123 },
+  { INT_TIMER5A_TM4C123, INT_TIMER5B_TM4C123 },
+};
+
+static HostTimer_t HostTimers[NUM_TIMER_MODULES];
+static uint32_t PulseWidths[NUM_PWM_MODULES][NUM_PWM_OUTS];
+
+static HostTimer_t *TimerFor( uint32_t Base );
+static uint64_t TimerPeriod( HostTimerHalf_t *pHalf );
+static void SetMatchTime( HostTimerHalf_t *pHalf, uint64_t Now );
+
+/*------------------------------ System control --------------------------*/
+void SysCtlClockSet(uint32_t ui32Config)
+{
+}
+
+uint32_t SysCtlClockGet(void)
+{
+  return HOST_CLK_FREQ;
+}
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral)
+{
+}
+
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral)
+{
+  return true;
+}
+
+void SysCtlPWMClockSet(uint32_t ui32Config)
+{
+}
+
+void SysCtlDelay(uint32_t ui32Count)
+{
+}
+
+/*---------------------------------- GPIO --------------------------------*/
+void GPIOPinConfigure(uint32_t ui32PinConfig)
+{
+}
+
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins)
+{
+  HWREG(ui32Port + GPIO_O_DEN) |= ui8Pins;
+  HWREG(ui32Port + GPIO_O_DIR) &= ~ui8Pins;
+}
+
+void GPIOPinTypeGPIOOutput(uint32_t ui32Port, uint8_t ui8Pins)
+{
+  HWREG(ui32Port + GPIO_O_DEN) |= ui8Pins;
+  HWREG(ui32Port + GPIO_O_DIR) |= ui8Pins;
+}
+
+void GPIOPinTypePWM(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void GPIOPinTypeADC(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins)
+{
+  return HWREG(ui32Port + GPIO_DATA_ALL_BITS) & ui8Pins;
+}
+
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val)
+{
+  HWREG(ui32Port + GPIO_DATA_ALL_BITS) =
+    (HWREG(ui32Port + GPIO_DATA_ALL_BITS) & ~ui8Pins) | (ui8Val & ui8Pins);
+}
+
+/*----------------------------------- PWM --------------------------------*/
+void PWMGenConfigure(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Config)
+{
+}
+
+void PWMGenPeriodSet(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Period)
+{
+}
+
+void PWMGenEnable(uint32_t ui32Base, uint32_t ui32Gen)
+{
+}
+
+void PWMPulseWidthSet(uint32_t ui32Base, uint32_t ui32PWMOut,
+                      uint32_t ui32Width)
+{
+  uint32_t Module = (ui32Base == PWM1_BASE) ? 1 : 0;
+  PulseWidths[Module][ui32PWMOut & PWM_OUT_NUM_MASK] = ui32Width;
+}
+
+void PWMOutputState(uint32_t ui32Base, uint32_t ui32PWMOutBits, bool bEnable)
+{
+}
+
+void PWMOutputInvert(uint32_t ui32Base, uint32_t ui32PWMOutBits, bool bInvert)
+{
+}
+
+void PWMSyncUpdate(uint32_t ui32Base, uint32_t ui32GenBits)
+{
+}
+
+uint32_t Host_GetPulseWidth( uint32_t Base, uint32_t PWMOut )
+{
+  uint32_t Module = (Base == PWM1_BASE) ? 1 : 0;
+  return PulseWidths[Module][PWMOut & PWM_OUT_NUM_MASK];
+}
+
+/*---------------------------------- Timers ------------------------------*/
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  uint32_t ModeA = ui32Config & 0x000000ff;
+  if ( pTimer == NULL )
+    return;
+  pTimer->Split = (ui32Config & TIMER_CFG_SPLIT_PAIR) != 0;
+  pTimer->Half[0].Periodic = (ModeA == TIMER_CFG_A_PERIODIC) ||
+                             (ModeA == TIMER_CFG_PERIODIC_UP);
+  pTimer->Half[0].CountUp = (ModeA == TIMER_CFG_ONE_SHOT_UP) ||
+                            (ModeA == TIMER_CFG_PERIODIC_UP);
+  pTimer->Half[1].Periodic = (ui32Config & 0x0000ff00) == TIMER_CFG_B_PERIODIC;
+  pTimer->Half[1].CountUp = false;
+  pTimer->Half[0].Enabled = false;
+  pTimer->Half[1].Enabled = false;
+}
+
+void TimerPrescaleSet(uint32_t ui32Base, uint32_t ui32Timer,
+                      uint32_t ui32Value)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer == NULL )
+    return;
+  if ( ui32Timer & TIMER_A )
+    pTimer->Half[0].Prescale = ui32Value;
+  if ( ui32Timer & TIMER_B )
+    pTimer->Half[1].Prescale = ui32Value;
+}
+
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer == NULL )
+    return;
+  if ( ui32Timer & TIMER_A )
+    pTimer->Half[0].Load = ui32Value;
+  if ( ui32Timer & TIMER_B )
+    pTimer->Half[1].Load = ui32Value;
+}
+
+void TimerMatchSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer == NULL )
+    return;
+  if ( ui32Timer & TIMER_A ){
+    pTimer->Half[0].Match = ui32Value;
+    SetMatchTime( &pTimer->Half[0], Host_GetVirtualCycles() );
+  }
+  if ( ui32Timer & TIMER_B ){
+    pTimer->Half[1].Match = ui32Value;
+    SetMatchTime( &pTimer->Half[1], Host_GetVirtualCycles() );
+  }
+}
+
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  HostTimerHalf_t *pHalf;
+  uint64_t Now = Host_GetVirtualCycles();
+
+  if ( pTimer == NULL )
+    return 0;
+  pHalf = &pTimer->Half[(ui32Timer == TIMER_B) ? 1 : 0];
+  if ( pHalf->Enabled && pHalf->CountUp )
+    return (uint32_t)((Now - pHalf->Started) / (pHalf->Prescale + 1));
+  if ( !pHalf->Enabled || (Now >= pHalf->Deadline) )
+    return 0;
+  // counting down, so report what is left
+  return (uint32_t)((pHalf->Deadline - Now) / (pHalf->Prescale + 1));
+}
+
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  uint8_t i;
+
+  if ( pTimer == NULL )
+    return;
+  for ( i = 0; i < 2; i++ ){
+    if ( (ui32Timer & (i == 0 ? TIMER_A : TIMER_B)) == 0 )
+      continue;
+    pTimer->Half[i].Enabled = true;
+    pTimer->Half[i].Started = Host_GetVirtualCycles();
+    pTimer->Half[i].Deadline = pTimer->Half[i].Started +
+                               TimerPeriod( &pTimer->Half[i] );
+    SetMatchTime( &pTimer->Half[i], pTimer->Half[i].Started );
+  }
+}
+
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer == NULL )
+    return;
+  if ( ui32Timer & TIMER_A )
+    pTimer->Half[0].Enabled = false;
+  if ( ui32Timer & TIMER_B )
+    pTimer->Half[1].Enabled = false;
+}
+
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer != NULL )
+    pTimer->IntMask |= ui32IntFlags;
+}
+
+void TimerIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer != NULL )
+    pTimer->IntMask &= ~ui32IntFlags;
+}
+
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer != NULL )
+    pTimer->RawInts &= ~ui32IntFlags;
+}
+
+uint32_t TimerIntStatus(uint32_t ui32Base, bool bMasked)
+{
+  HostTimer_t *pTimer = TimerFor(ui32Base);
+  if ( pTimer == NULL )
+    return 0;
+  return bMasked ? (pTimer->RawInts & pTimer->IntMask) : pTimer->RawInts;
+}
+
+/****************************************************************************
+ Function
+     HostTimer_NextDeadline
+ Returns
+     the virtual time of the next time-out or match of any running timer
+****************************************************************************/
+uint64_t HostTimer_NextDeadline( void )
+{
+  HostTimerHalf_t *pHalf;
+  uint64_t Next = NO_DEADLINE;
+  uint8_t Module, i;
+
+  for ( Module = 0; Module < NUM_TIMER_MODULES; Module++ ){
+    for ( i = 0; i < 2; i++ ){
+      pHalf = &HostTimers[Module].Half[i];
+      if ( !pHalf->Enabled )
+        continue;
+      if ( pHalf->Deadline < Next )
+        Next = pHalf->Deadline;
+      if ( pHalf->MatchTime < Next )
+        Next = pHalf->MatchTime;
+    }
+  }
+  return Next;
+}
+
+/****************************************************************************
+ Function
+     HostTimer_Update
+ Parameters
+     uint64_t Now, the present virtual time
+ Description
+     times out every running timer whose deadline has come, reloading the
+     periodic ones and stopping the one-shots, and raises the matches that
+     have come
+****************************************************************************/
+void HostTimer_Update( uint64_t Now )
+{
+  HostTimer_t *pTimer;
+  HostTimerHalf_t *pHalf;
+  uint8_t Module, i;
+
+  for ( Module = 0; Module < NUM_TIMER_MODULES; Module++ ){
+    pTimer = &HostTimers[Module];
+    for ( i = 0; i < 2; i++ ){
+      pHalf = &pTimer->Half[i];
+      if ( pHalf->Enabled && (pHalf->MatchTime <= Now) ){
+        pTimer->RawInts |= MatchFlag[i];
+        if ( pTimer->IntMask & MatchFlag[i] )
+          Host_RaiseInterrupt( TimerInterrupt[Module][i] );
+        pHalf->MatchTime += TimerPeriod( pHalf );
+      }
+      if ( !pHalf->Enabled || (pHalf->Deadline > Now) )
+        continue;
+      pTimer->RawInts |= TimeoutFlag[i];
+      if ( pTimer->IntMask & TimeoutFlag[i] )
+        Host_RaiseInterrupt( TimerInterrupt[Module][i] );
+      if ( pHalf->Periodic ){
+        pHalf->Started = pHalf->Deadline;
+        pHalf->Deadline += TimerPeriod( pHalf );
+      }else{
+        pHalf->Enabled = false;
+      }
+    }
+  }
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static HostTimer_t *TimerFor( uint32_t Base )
+{
+  uint32_t Module = (Base - TIMER0_BASE) / TIMER_MODULE_SPACING;
+  if ( (Base < TIMER0_BASE) || (Module >= NUM_TIMER_MODULES) )
+    return NULL;
+  return &HostTimers[Module];
+}
+
+static uint64_t TimerPeriod( HostTimerHalf_t *pHalf )
+{
+  uint64_t Period = (uint64_t)pHalf->Load * (pHalf->Prescale + 1);
+  if ( pHalf->CountUp )  // counts 0 to Load inclusive
+    Period += pHalf->Prescale + 1;
+  return (Period == 0) ? 1 : Period;  // never a zero length period
+}
+
+// the first time after Now that a timer counting up reaches its match
+static void SetMatchTime( HostTimerHalf_t *pHalf, uint64_t Now )
+{
+  if ( !pHalf->CountUp || (pHalf->Match > pHalf->Load) ){
+    pHalf->MatchTime = NO_DEADLINE;
+    return;
+  }
+  pHalf->MatchTime = pHalf->Started +
+                     (uint64_t)pHalf->Match * (pHalf->Prescale + 1);
+  while ( pHalf->MatchTime <= Now )
+    pHalf->MatchTime += TimerPeriod( pHalf );
+}
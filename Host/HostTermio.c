@@ -0,0 +1,156 @@
+/****************************************************************************
+ Module
+   HostTermio.c
+
+ Description
+   Host (Linux) version of termio.c. The console is stdin/stdout. When stdin
+   is a terminal it is put into character at a time mode, so keys reach the
+   event checkers as they are typed, just as over the UART.
+
+ Notes
+   Setting ES_HOST_KEYS to the name of a file replays keys from that file
+   instead of reading stdin. Each line is a virtual time in mS and the key
+   to deliver at that time, for example
+       500 m
+       8000 n
+       9000 space
+   so that a whole performance can be scripted and re-run at any time scale.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#include "termio.h"
+#include "ES_HostPort.h"
+
+#define MAX_SCRIPT_KEYS 1024
+#define NO_KEY (-1)
+
+typedef struct {
+  uint32_t When;      // virtual time in mS
+  unsigned char Key;
+} ScriptKey_t;
+
+static ScriptKey_t Script[MAX_SCRIPT_KEYS];
+static uint16_t NumScriptKeys;
+static uint16_t NextScriptKey;
+static bool UsingScript;
+
+static int PendingKey = NO_KEY;   // read ahead by kbhit
+static bool StdinClosed;
+static bool TermioSaved;
+static struct termios SavedTermio;
+
+static void LoadScript( const char *pFileName );
+static void RestoreTerminal( void );
+
+void TERMIO_Init(void)
+{
+  struct termios RawTermio;
+  const char *pScript = getenv("ES_HOST_KEYS");
+
+  setvbuf(stdout, NULL, _IONBF, 0);   // no buffering, like the UART
+  if ( pScript != NULL ){
+    LoadScript( pScript );
+  }else if ( isatty(STDIN_FILENO) && (tcgetattr(STDIN_FILENO, &SavedTermio) == 0) ){
+    RawTermio = SavedTermio;
+    RawTermio.c_lflag &= ~(ICANON | ECHO);
+    RawTermio.c_cc[VMIN] = 1;
+    RawTermio.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &RawTermio);
+    TermioSaved = true;
+    atexit( RestoreTerminal );
+  }
+}
+
+int kbhit(void)
+{
+  fd_set ReadSet;
+  struct timeval NoWait = { 0, 0 };
+  unsigned char Key;
+
+  if ( UsingScript )
+    return (NextScriptKey < NumScriptKeys) &&
+           (Script[NextScriptKey].When <= Host_GetVirtualMillis());
+
+  if ( PendingKey != NO_KEY )
+    return 1;
+  if ( StdinClosed )
+    return 0;
+  FD_ZERO(&ReadSet);
+  FD_SET(STDIN_FILENO, &ReadSet);
+  if ( select(STDIN_FILENO + 1, &ReadSet, NULL, NULL, &NoWait) <= 0 )
+    return 0;
+  if ( read(STDIN_FILENO, &Key, 1) != 1 ){
+    StdinClosed = true;   // end of a piped input, stop polling it
+    return 0;
+  }
+  PendingKey = Key;
+  return 1;
+}
+
+unsigned char TERMIO_GetChar(void) {
+  unsigned char Key;
+
+  if ( UsingScript ){
+    while ( !kbhit() )
+      ;
+    return Script[NextScriptKey++].Key;
+  }
+  if ( (PendingKey == NO_KEY) && !kbhit() ){
+    // blocking, as on the target
+    if ( read(STDIN_FILENO, &Key, 1) != 1 )
+      return 0;
+    return Key;
+  }
+  Key = (unsigned char)PendingKey;
+  PendingKey = NO_KEY;
+  return Key;
+}
+
+void TERMIO_PutChar(unsigned char ch) {
+  putchar(ch);
+#ifdef ES_USE_PREEMPTION
+  Host_YieldPoint();  // on the target the UART is where printf takes its time
+#endif
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static void LoadScript( const char *pFileName )
+{
+  FILE *pFile = fopen(pFileName, "r");
+  char Line[80];
+  char KeyName[16];
+  unsigned long When;
+
+  if ( pFile == NULL ){
+    fprintf(stderr, "host: can't open key script %s\n", pFileName);
+    exit(1);
+  }
+  UsingScript = true;
+  while ( (fgets(Line, sizeof(Line), pFile) != NULL) &&
+          (NumScriptKeys < MAX_SCRIPT_KEYS) ){
+    if ( sscanf(Line, "%lu %15s", &When, KeyName) != 2 )
+      continue;   // blank line or comment
+    Script[NumScriptKeys].When = (uint32_t)When;
+    Script[NumScriptKeys].Key = (strcmp(KeyName, "space") == 0) ? ' ' :
+                                (unsigned char)KeyName[0];
+    NumScriptKeys++;
+  }
+  fclose(pFile);
+}
+
+static void RestoreTerminal( void )
+{
+  if ( TermioSaved )
+    tcsetattr(STDIN_FILENO, TCSANOW, &SavedTermio);
+}
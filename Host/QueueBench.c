@@ -0,0 +1,265 @@
+/****************************************************************************
+ Module
+     QueueBench.c
+
+ Description
+     Host benchmark for the event queue functions. Built once against
+     ES_Queue.c and once against ES_SpscQueue.c (ES_USE_SPSC_QUEUE) by
+     "make queuebench", it times the queue operations in ns per event, one
+     at a time and in batches, and, for the SPSC ring, runs a producer
+     thread against a consumer thread to check that no event is lost,
+     duplicated or reordered.
+
+ Notes
+     The host critical regions only set a simulated PRIMASK, so the times
+     leave out the cost of turning interrupts off and on that ES_Queue.c
+     pays on the target. ES_Queue.c is not thread safe on the host, so
+     the stress test only runs against the SPSC ring.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_Queue.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define QUEUE_EVENTS    8           // the size of a typical service queue
+#define NUM_OPS         20000000UL  // enqueue/dequeue pairs to time
+#define STRESS_EVENTS   20000000UL  // events through the stress test
+#define STRESS_EVENTS_Q 64          // queue size for the stress test
+#define STRESS_BATCH_IN  3          // odd sizes, so batches straddle the wrap
+#define STRESS_BATCH_OUT 5
+#define NS_PER_SEC      1000000000.0
+
+/*---------------------------- Module Functions ---------------------------*/
+static double Seconds( void );
+static double TimeSteady( void );
+static double TimeBurst( void );
+static double TimeBatch( void );
+#ifdef ES_USE_SPSC_QUEUE
+static bool StressTest( bool Batched );
+static void *Producer( void *pArg );
+static void *BatchProducer( void *pArg );
+#endif
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_Event Queue[ES_QUEUE_BLOCK_SIZE(QUEUE_EVENTS)];
+#ifdef ES_USE_SPSC_QUEUE
+static ES_Event StressQueue[ES_QUEUE_BLOCK_SIZE(STRESS_EVENTS_Q)];
+#endif
+// stops the compiler from throwing the dequeued events away
+static volatile uint16_t Sink;
+
+/*------------------------------ Module Code ------------------------------*/
+int main( void )
+{
+  int ReturnVal = 0;
+
+#ifdef ES_USE_SPSC_QUEUE
+  printf("ES_SpscQueue.c (%u byte events)\n", (unsigned)sizeof(ES_Event));
+#else
+  printf("ES_Queue.c (%u byte events)\n", (unsigned)sizeof(ES_Event));
+#endif
+  printf("  one in, one out  %6.2f ns/op\n", TimeSteady());
+  printf("  fill then drain  %6.2f ns/op\n", TimeBurst());
+  printf("  batch in and out %6.2f ns/op\n", TimeBatch());
+#ifdef ES_USE_SPSC_QUEUE
+  if ( StressTest( false ) ){
+    printf("  2 thread stress  %lu events in order\n", STRESS_EVENTS);
+  }else{
+    printf("  2 thread stress  FAILED\n");
+    ReturnVal = 1;
+  }
+  if ( StressTest( true ) ){
+    printf("  batched stress   %lu events in order\n", STRESS_EVENTS);
+  }else{
+    printf("  batched stress   FAILED\n");
+    ReturnVal = 1;
+  }
+#endif
+  return ReturnVal;
+}
+
+// the simulated PRIMASK and BASEPRI for EnterCritical/ExitCritical
+uint32_t CPUgetPRIMASK_cpsid( void )
+{
+  return 0;
+}
+
+void CPUsetPRIMASK( uint32_t newPRIMASK )
+{
+}
+
+#ifdef ES_USE_BASEPRI
+uint32_t CPUgetBASEPRI_raise( uint32_t newBASEPRI )
+{
+  return 0;
+}
+
+void CPUsetBASEPRI( uint32_t newBASEPRI )
+{
+}
+#endif
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static double Seconds( void )
+{
+  struct timespec Now;
+
+  clock_gettime( CLOCK_MONOTONIC, &Now );
+  return (double)Now.tv_sec + (double)Now.tv_nsec / NS_PER_SEC;
+}
+
+// the steady state of a service keeping up: post one, dispatch one. The
+// queue moves round the whole ring, so the wrap is timed as well
+static double TimeSteady( void )
+{
+  ES_Event ThisEvent;
+  uint32_t i;
+  double Start;
+
+  ES_InitQueue( Queue, ARRAY_SIZE(Queue) );
+  ThisEvent.EventType = ES_NEW_KEY;
+  Start = Seconds();
+  for ( i = 0; i < NUM_OPS; i++ ){
+    ThisEvent.EventParam = (uint16_t)i;
+    ES_EnQueueFIFO( Queue, ThisEvent );
+    ES_DeQueue( Queue, &ThisEvent );
+    Sink = ThisEvent.EventParam;
+  }
+  return (Seconds() - Start) * NS_PER_SEC / (2.0 * NUM_OPS);
+}
+
+// a burst of posts that fills the queue, then the service catching up
+static double TimeBurst( void )
+{
+  ES_Event ThisEvent;
+  uint32_t i;
+  uint32_t j;
+  double Start;
+
+  ES_InitQueue( Queue, ARRAY_SIZE(Queue) );
+  ThisEvent.EventType = ES_NEW_KEY;
+  Start = Seconds();
+  for ( i = 0; i < NUM_OPS / QUEUE_EVENTS; i++ ){
+    for ( j = 0; j < QUEUE_EVENTS; j++ ){
+      ThisEvent.EventParam = (uint16_t)j;
+      ES_EnQueueFIFO( Queue, ThisEvent );
+    }
+    while ( ES_DeQueue( Queue, &ThisEvent ) != 0 )
+      Sink = ThisEvent.EventParam;
+  }
+  return (Seconds() - Start) * NS_PER_SEC /
+                                   (2.0 * (NUM_OPS / QUEUE_EVENTS) * QUEUE_EVENTS);
+}
+
+// the same burst, moved with one ES_EnQueueBatch and one ES_DeQueueBatch
+static double TimeBatch( void )
+{
+  ES_Event Events[QUEUE_EVENTS];
+  uint32_t i;
+  uint32_t j;
+  double Start;
+
+  ES_InitQueue( Queue, ARRAY_SIZE(Queue) );
+  for ( j = 0; j < QUEUE_EVENTS; j++ ){
+    Events[j].EventType = ES_NEW_KEY;
+    Events[j].EventParam = (uint16_t)j;
+  }
+  Start = Seconds();
+  for ( i = 0; i < NUM_OPS / QUEUE_EVENTS; i++ ){
+    ES_EnQueueBatch( Queue, Events, QUEUE_EVENTS );
+    Sink = ES_DeQueueBatch( Queue, Events, QUEUE_EVENTS );
+  }
+  return (Seconds() - Start) * NS_PER_SEC /
+                                   (2.0 * (NUM_OPS / QUEUE_EVENTS) * QUEUE_EVENTS);
+}
+
+#ifdef ES_USE_SPSC_QUEUE
+// the producer thread posts a numbered stream, waiting whenever it is full
+static void *Producer( void *pArg )
+{
+  ES_Event ThisEvent;
+  uint32_t i;
+
+  ThisEvent.EventType = ES_NEW_KEY;
+  for ( i = 0; i < STRESS_EVENTS; i++ ){
+    ThisEvent.EventParam = (uint16_t)i;
+    while ( !ES_EnQueueFIFO( StressQueue, ThisEvent ) )
+      sched_yield(); // let the consumer in, there may be only one CPU
+  }
+  return NULL;
+}
+
+// the same stream, posted STRESS_BATCH_IN events at a time
+static void *BatchProducer( void *pArg )
+{
+  ES_Event Events[STRESS_BATCH_IN];
+  uint32_t i;
+  uint32_t j;
+  uint32_t NumEvents;
+
+  for ( i = 0; i < STRESS_EVENTS; i += NumEvents ){
+    NumEvents = STRESS_EVENTS - i;
+    if ( NumEvents > STRESS_BATCH_IN )
+      NumEvents = STRESS_BATCH_IN;
+    for ( j = 0; j < NumEvents; j++ ){
+      Events[j].EventType = ES_NEW_KEY;
+      Events[j].EventParam = (uint16_t)(i + j);
+    }
+    while ( !ES_EnQueueBatch( StressQueue, Events, NumEvents ) )
+      sched_yield();
+  }
+  return NULL;
+}
+
+// the consumer, on this thread, checks that the numbers arrive in sequence.
+// When Batched, both sides move the events in batches
+static bool StressTest( bool Batched )
+{
+  pthread_t ProducerThread;
+  ES_Event Events[STRESS_BATCH_OUT];
+  ES_QueueIndex_t NumTaken;
+  ES_QueueIndex_t i;
+  uint32_t Received = 0;
+  bool InOrder = true;
+
+  ES_InitQueue( StressQueue, ARRAY_SIZE(StressQueue) );
+  if ( pthread_create( &ProducerThread, NULL,
+                       Batched ? BatchProducer : Producer, NULL ) != 0 )
+    return false;
+  while ( Received < STRESS_EVENTS ){
+    if ( ES_IsQueueEmpty( StressQueue ) ){
+      sched_yield();
+      continue;
+    }
+    if ( Batched )
+      NumTaken = ES_DeQueueBatch( StressQueue, Events, STRESS_BATCH_OUT );
+    else{
+      ES_DeQueue( StressQueue, &Events[0] );
+      NumTaken = 1;
+    }
+    for ( i = 0; i < NumTaken; i++ ){
+      if ( (Events[i].EventType != ES_NEW_KEY) ||
+           (Events[i].EventParam != (uint16_t)Received) )
+        InOrder = false;
+      Received++;
+    }
+  }
+  pthread_join( ProducerThread, NULL );
+  return InOrder && ES_IsQueueEmpty( StressQueue );
+}
+#endif
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,269 @@
+/****************************************************************************
+ Module
+     TimerBench.c
+
+ Description
+     Host benchmark for the timer wheel (ES_TimerWheel.c). Built by
+     "make timerbench" with room for 512 timers, it times a tick in ns as
+     the number of running timers grows from 1 to 512, against decrementing
+     every running timer on every tick as ES_Timers.c does without
+     ES_USE_TIMER_WHEEL. It then times catching up with a backlog of ticks
+     one at a time against stepping over the idle ones with ES_WheelSkip,
+     as ES_Timer_CatchUp does, and checks that a mix of starts, stops,
+     restarts and catch-ups expires every timer on exactly the right tick.
+
+ Notes
+     Every timer that expires is started again, so the number running
+     stays the same through each timing. The times include the expiry
+     function, which only restarts the timer.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include <time.h>
+
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_TimerWheel.h"
+
+/*----------------------------- Module Defines ----------------------------*/
+#define NUM_TICKS       2000000UL   // ticks to time for each timer count
+#define MAX_TIME        5000        // longest time used in the timings
+#define CHECK_TICKS     3000000UL   // ticks to run the check for
+#define BACKLOG         100         // ticks in each timed catch-up
+#define NUM_CATCH_UPS   20000UL     // catch-ups to time
+#define NS_PER_SEC      1000000000.0
+
+/*---------------------------- Module Functions ---------------------------*/
+static double Seconds( void );
+static uint32_t Random( void );
+static uint32_t RandomTime( void );
+static double TimeWheel( uint16_t NumTimers );
+static double TimeLinear( uint16_t NumTimers );
+static double TimeCatchUp( uint16_t NumTimers, bool Skip );
+static void CatchUp( uint32_t NumTicks, bool Skip );
+static void Restart( ES_WheelIndex_t Which );
+static void Check( ES_WheelIndex_t Which );
+static bool CheckWheel( void );
+
+/*---------------------------- Module Variables ---------------------------*/
+uint32_t _CriticalSave;
+uint8_t _CriticalDepth;
+static uint32_t RandomState = 2463534242UL;
+// the linear timers, as in ES_Timers.c
+static uint32_t LinearTimers[ES_WHEEL_TIMERS];
+// for the check, the tick that each timer should expire on, 0 if stopped
+static uint64_t TickNow;
+static uint64_t DueTick[ES_WHEEL_TIMERS];
+static uint32_t NumExpired;
+static uint32_t NumWrong;
+
+/*------------------------------ Module Code ------------------------------*/
+int main( void )
+{
+  uint16_t NumTimers;
+
+  printf("ns per tick   timers   wheel   linear\n");
+  for ( NumTimers = 1; NumTimers <= ES_WHEEL_TIMERS; NumTimers *= 2 ){
+    printf("              %6u  %6.1f  %7.1f\n", NumTimers,
+           TimeWheel( NumTimers ), TimeLinear( NumTimers ));
+  }
+  printf("ns per %u tick catch-up   timers   one by one   skipped\n", BACKLOG);
+  for ( NumTimers = 1; NumTimers <= ES_WHEEL_TIMERS; NumTimers *= 8 ){
+    printf("                          %6u  %11.1f  %8.1f\n", NumTimers,
+           TimeCatchUp( NumTimers, false ), TimeCatchUp( NumTimers, true ));
+  }
+  if ( !CheckWheel() ){
+    printf("check FAILED: %lu of %lu expiries on the wrong tick\n",
+           (unsigned long)NumWrong, (unsigned long)NumExpired);
+    return 1;
+  }
+  printf("check: %lu expiries, all on time\n", (unsigned long)NumExpired);
+  return 0;
+}
+
+// the simulated PRIMASK and BASEPRI for EnterCritical/ExitCritical
+uint32_t CPUgetPRIMASK_cpsid( void )
+{
+  return 0;
+}
+
+void CPUsetPRIMASK( uint32_t newPRIMASK )
+{
+}
+
+#ifdef ES_USE_BASEPRI
+uint32_t CPUgetBASEPRI_raise( uint32_t newBASEPRI )
+{
+  return 0;
+}
+
+void CPUsetBASEPRI( uint32_t newBASEPRI )
+{
+}
+#endif
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static double Seconds( void )
+{
+  struct timespec Now;
+
+  clock_gettime( CLOCK_MONOTONIC, &Now );
+  return (double)Now.tv_sec + (double)Now.tv_nsec / NS_PER_SEC;
+}
+
+// xorshift32, so that every run times the same sequence
+static uint32_t Random( void )
+{
+  RandomState ^= RandomState << 13;
+  RandomState ^= RandomState >> 17;
+  RandomState ^= RandomState << 5;
+  return RandomState;
+}
+
+static uint32_t RandomTime( void )
+{
+  return 1 + Random() % MAX_TIME;
+}
+
+static void Restart( ES_WheelIndex_t Which )
+{
+  ES_WheelStart( Which, RandomTime() );
+}
+
+static double TimeWheel( uint16_t NumTimers )
+{
+  uint32_t i;
+  double Start;
+
+  ES_WheelInit( Restart );
+  for ( i = 0; i < NumTimers; i++ )
+    ES_WheelStart( (ES_WheelIndex_t)i, RandomTime() );
+  Start = Seconds();
+  for ( i = 0; i < NUM_TICKS; i++ )
+    ES_WheelTick();
+  return (Seconds() - Start) * NS_PER_SEC / NUM_TICKS;
+}
+
+static double TimeLinear( uint16_t NumTimers )
+{
+  uint32_t i;
+  uint16_t j;
+  double Start;
+
+  for ( j = 0; j < NumTimers; j++ )
+    LinearTimers[j] = RandomTime();
+  Start = Seconds();
+  for ( i = 0; i < NUM_TICKS; i++ ){
+    for ( j = 0; j < NumTimers; j++ ){
+      if ( --LinearTimers[j] == 0 )
+        LinearTimers[j] = RandomTime();
+    }
+  }
+  return (Seconds() - Start) * NS_PER_SEC / NUM_TICKS;
+}
+
+static double TimeCatchUp( uint16_t NumTimers, bool Skip )
+{
+  uint32_t i;
+  double Start;
+
+  ES_WheelInit( Restart );
+  for ( i = 0; i < NumTimers; i++ )
+    ES_WheelStart( (ES_WheelIndex_t)i, RandomTime() );
+  Start = Seconds();
+  for ( i = 0; i < NUM_CATCH_UPS; i++ )
+    CatchUp( BACKLOG, Skip );
+  return (Seconds() - Start) * NS_PER_SEC / NUM_CATCH_UPS;
+}
+
+// take NumTicks ticks, counting them in TickNow for the check, either one
+// at a time or stepping over those with nothing due
+static void CatchUp( uint32_t NumTicks, bool Skip )
+{
+  uint32_t Skipped;
+
+  while ( NumTicks > 0 ){
+    if ( Skip ){
+      Skipped = ES_WheelSkip( NumTicks );
+      TickNow += Skipped;
+      NumTicks -= Skipped;
+      if ( NumTicks == 0 )
+        break;
+    }
+    TickNow++;
+    ES_WheelTick();
+    NumTicks--;
+  }
+}
+
+// the expiry function for the check: was it due now? Then start it again
+// for a while, sometimes long enough to go up to the top of the wheel
+static void Check( ES_WheelIndex_t Which )
+{
+  uint32_t NewTime;
+
+  NumExpired++;
+  if ( DueTick[Which] != TickNow )
+    NumWrong++;
+  switch ( Random() % 4 ){
+    case 0:  NewTime = 1 + Random() % 64;          break;
+    case 1:  NewTime = 1 + Random() % 5000;        break;
+    case 2:  NewTime = 1 + Random() % 300000;      break;
+    default: NewTime = 1 + Random() % 0xFFFFFFFEu; break;
+  }
+  ES_WheelStart( Which, NewTime );
+  DueTick[Which] = TickNow + NewTime;
+}
+
+// TickNow counts the ticks, so a timer started with N ticks to go expires
+// on the tick N ticks on. Every step, one timer is stopped, restarted or
+// has its time left read, and then one tick is taken, or now and then a
+// catch-up of up to 300
+static bool CheckWheel( void )
+{
+  ES_WheelIndex_t Which;
+  uint32_t NewTime;
+  uint32_t i;
+
+  ES_WheelInit( Check );
+  TickNow = 0;
+  NumExpired = 0;
+  NumWrong = 0;
+  for ( Which = 0; Which < ES_WHEEL_TIMERS; Which++ ){
+    NewTime = 1 + Random() % 5000;
+    ES_WheelStart( Which, NewTime );
+    DueTick[Which] = NewTime;
+  }
+  for ( i = 0; i < CHECK_TICKS; i++ ){
+    Which = (ES_WheelIndex_t)(Random() % ES_WHEEL_TIMERS);
+    switch ( Random() % 3 ){
+      case 0:
+        ES_WheelStop( Which );
+        DueTick[Which] = 0;
+        break;
+      case 1:
+        NewTime = 1 + Random() % 20000;
+        ES_WheelStart( Which, NewTime );
+        DueTick[Which] = TickNow + NewTime;
+        break;
+      default:
+        if ( (DueTick[Which] == 0) ? ES_WheelIsRunning( Which ) :
+             (ES_WheelRemaining( Which ) != DueTick[Which] - TickNow) )
+          NumWrong++;
+        break;
+    }
+    if ( Random() % 16 == 0 )
+      CatchUp( 1 + Random() % 300, true );
+    else
+      CatchUp( 1, false );
+  }
+  return (NumWrong == 0) && (NumExpired != 0);
+}
+/*------------------------------ End of file ------------------------------*/
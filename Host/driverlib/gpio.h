@@ -0,0 +1,27 @@
+//*****************************************************************************
+// gpio.h - host (Linux) stand-in for the TivaWare driverlib header
+//*****************************************************************************
+#ifndef __DRIVERLIB_GPIO_H__
+#define __DRIVERLIB_GPIO_H__
+
+#include <stdint.h>
+
+#define GPIO_PIN_0              0x00000001
+#define GPIO_PIN_1              0x00000002
+#define GPIO_PIN_2              0x00000004
+#define GPIO_PIN_3              0x00000008
+#define GPIO_PIN_4              0x00000010
+#define GPIO_PIN_5              0x00000020
+#define GPIO_PIN_6              0x00000040
+#define GPIO_PIN_7              0x00000080
+
+void GPIOPinConfigure(uint32_t ui32PinConfig);
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeGPIOOutput(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypePWM(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeADC(uint32_t ui32Port, uint8_t ui8Pins);
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val);
+
+#endif // __DRIVERLIB_GPIO_H__
@@ -0,0 +1,18 @@
+//*****************************************************************************
+// interrupt.h - host (Linux) stand-in for the TivaWare driverlib header
+// The simulated NVIC lives in ES_HostPort.c
+//*****************************************************************************
+#ifndef __DRIVERLIB_INTERRUPT_H__
+#define __DRIVERLIB_INTERRUPT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool IntMasterEnable(void);
+bool IntMasterDisable(void);
+void IntEnable(uint32_t ui32Interrupt);
+void IntDisable(uint32_t ui32Interrupt);
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority);
+void IntPendSet(uint32_t ui32Interrupt);
+
+#endif // __DRIVERLIB_INTERRUPT_H__
@@ -0,0 +1,23 @@
+//*****************************************************************************
+// pin_map.h - host (Linux) stand-in for the TivaWare driverlib header
+// Only the pin functions used by this project are listed.
+//*****************************************************************************
+#ifndef __DRIVERLIB_PIN_MAP_H__
+#define __DRIVERLIB_PIN_MAP_H__
+
+#define GPIO_PA0_U0RX           0x00000001
+#define GPIO_PA1_U0TX           0x00000401
+#define GPIO_PA6_M1PWM2         0x00001805
+#define GPIO_PA7_M1PWM3         0x00001C05
+#define GPIO_PB4_M0PWM2         0x00011004
+#define GPIO_PB5_M0PWM3         0x00011404
+#define GPIO_PB6_M0PWM0         0x00011804
+#define GPIO_PB7_M0PWM1         0x00011C04
+#define GPIO_PC4_M0PWM6         0x00021004
+#define GPIO_PC5_M0PWM7         0x00021404
+#define GPIO_PD0_M1PWM0         0x00030005
+#define GPIO_PD1_M1PWM1         0x00030405
+#define GPIO_PE4_M0PWM4         0x00041004
+#define GPIO_PE5_M0PWM5         0x00041404
+
+#endif // __DRIVERLIB_PIN_MAP_H__
@@ -0,0 +1,50 @@
+//*****************************************************************************
+// pwm.h - host (Linux) stand-in for the TivaWare driverlib header
+// The pulse widths that are set can be read back with Host_GetPulseWidth.
+//*****************************************************************************
+#ifndef __DRIVERLIB_PWM_H__
+#define __DRIVERLIB_PWM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PWM_GEN_MODE_DOWN       0x00000000
+#define PWM_GEN_MODE_UP_DOWN    0x00000002
+#define PWM_GEN_MODE_NO_SYNC    0x00000000
+
+#define PWM_GEN_0               0x00000040
+#define PWM_GEN_1               0x00000080
+#define PWM_GEN_2               0x000000C0
+#define PWM_GEN_3               0x00000100
+#define PWM_GEN_0_BIT           0x00000001
+#define PWM_GEN_1_BIT           0x00000002
+#define PWM_GEN_2_BIT           0x00000004
+#define PWM_GEN_3_BIT           0x00000008
+
+#define PWM_OUT_0               0x00000040
+#define PWM_OUT_1               0x00000041
+#define PWM_OUT_2               0x00000082
+#define PWM_OUT_3               0x00000083
+#define PWM_OUT_4               0x000000C4
+#define PWM_OUT_5               0x000000C5
+#define PWM_OUT_6               0x00000106
+#define PWM_OUT_7               0x00000107
+#define PWM_OUT_0_BIT           0x00000001
+#define PWM_OUT_1_BIT           0x00000002
+#define PWM_OUT_2_BIT           0x00000004
+#define PWM_OUT_3_BIT           0x00000008
+#define PWM_OUT_4_BIT           0x00000010
+#define PWM_OUT_5_BIT           0x00000020
+#define PWM_OUT_6_BIT           0x00000040
+#define PWM_OUT_7_BIT           0x00000080
+
+void PWMGenConfigure(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Config);
+void PWMGenPeriodSet(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Period);
+void PWMGenEnable(uint32_t ui32Base, uint32_t ui32Gen);
+void PWMPulseWidthSet(uint32_t ui32Base, uint32_t ui32PWMOut,
+                      uint32_t ui32Width);
+void PWMOutputState(uint32_t ui32Base, uint32_t ui32PWMOutBits, bool bEnable);
+void PWMOutputInvert(uint32_t ui32Base, uint32_t ui32PWMOutBits, bool bInvert);
+void PWMSyncUpdate(uint32_t ui32Base, uint32_t ui32GenBits);
+
+#endif // __DRIVERLIB_PWM_H__
@@ -0,0 +1,39 @@
+//*****************************************************************************
+// sysctl.h - host (Linux) stand-in for the TivaWare driverlib header
+//*****************************************************************************
+#ifndef __DRIVERLIB_SYSCTL_H__
+#define __DRIVERLIB_SYSCTL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SYSCTL_PERIPH_GPIOA     0xf0000800
+#define SYSCTL_PERIPH_GPIOB     0xf0000801
+#define SYSCTL_PERIPH_GPIOC     0xf0000802
+#define SYSCTL_PERIPH_GPIOD     0xf0000803
+#define SYSCTL_PERIPH_GPIOE     0xf0000804
+#define SYSCTL_PERIPH_GPIOF     0xf0000805
+#define SYSCTL_PERIPH_TIMER5    0xf0000405
+#define SYSCTL_PERIPH_UART0     0xf0001800
+#define SYSCTL_PERIPH_ADC0      0xf0003800
+#define SYSCTL_PERIPH_PWM0      0xf0004000
+#define SYSCTL_PERIPH_PWM1      0xf0004001
+#define SYSCTL_PERIPH_UDMA      0xf0000c00
+
+#define SYSCTL_SYSDIV_5         0x84C00000
+#define SYSCTL_USE_PLL          0x00000000
+#define SYSCTL_OSC_MAIN         0x00000000
+#define SYSCTL_XTAL_16MHZ       0x00000540
+
+#define SYSCTL_PWMDIV_1         0x00000000
+#define SYSCTL_PWMDIV_32        0x001C0000
+#define SYSCTL_PWMDIV_64        0x001E0000
+
+void SysCtlClockSet(uint32_t ui32Config);
+uint32_t SysCtlClockGet(void);
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral);
+void SysCtlPWMClockSet(uint32_t ui32Config);
+void SysCtlDelay(uint32_t ui32Count);
+
+#endif // __DRIVERLIB_SYSCTL_H__
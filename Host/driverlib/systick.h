@@ -0,0 +1,18 @@
+//*****************************************************************************
+// systick.h - host (Linux) stand-in for the TivaWare driverlib header
+// SysTick is simulated against the virtual clock in ES_HostPort.c
+//*****************************************************************************
+#ifndef __DRIVERLIB_SYSTICK_H__
+#define __DRIVERLIB_SYSTICK_H__
+
+#include <stdint.h>
+
+void SysTickEnable(void);
+void SysTickDisable(void);
+void SysTickIntEnable(void);
+void SysTickIntDisable(void);
+void SysTickPeriodSet(uint32_t ui32Period);
+uint32_t SysTickPeriodGet(void);
+uint32_t SysTickValueGet(void);
+
+#endif // __DRIVERLIB_SYSTICK_H__
@@ -0,0 +1,46 @@
+//*****************************************************************************
+// timer.h - host (Linux) stand-in for the TivaWare driverlib header
+// The general purpose timers are simulated against the virtual clock in
+// ES_HostPort.c; a timer that times out with its interrupt enabled calls the
+// handler listed for it in the host vector table.
+//*****************************************************************************
+#ifndef __DRIVERLIB_TIMER_H__
+#define __DRIVERLIB_TIMER_H__
+
+#include <stdint.h>
+
+#define TIMER_A                 0x000000ff
+#define TIMER_B                 0x0000ff00
+#define TIMER_BOTH              0x0000ffff
+
+#define TIMER_CFG_ONE_SHOT      0x00000021
+#define TIMER_CFG_ONE_SHOT_UP   0x00000031
+#define TIMER_CFG_PERIODIC      0x00000022
+#define TIMER_CFG_PERIODIC_UP   0x00000032
+#define TIMER_CFG_SPLIT_PAIR    0x04000000
+#define TIMER_CFG_A_ONE_SHOT    0x00000021
+#define TIMER_CFG_A_PERIODIC    0x00000022
+#define TIMER_CFG_B_ONE_SHOT    0x00002100
+#define TIMER_CFG_B_PERIODIC    0x00002200
+
+#define TIMER_TIMA_TIMEOUT      0x00000001
+#define TIMER_TIMA_MATCH        0x00000010
+#define TIMER_TIMB_TIMEOUT      0x00000100
+#define TIMER_TIMB_MATCH        0x00000800
+
+#define TIMER_ADC_TIMEOUT_A     0x00000001
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config);
+void TimerPrescaleSet(uint32_t ui32Base, uint32_t ui32Timer,
+                      uint32_t ui32Value);
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerMatchSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer);
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+void TimerIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags);
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+uint32_t TimerIntStatus(uint32_t ui32Base, bool bMasked);
+
+#endif // __DRIVERLIB_TIMER_H__
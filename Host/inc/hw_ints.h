@@ -0,0 +1,31 @@
+//*****************************************************************************
+// hw_ints.h - host (Linux) stand-in for the TivaWare header of the same name
+//*****************************************************************************
+#ifndef __HW_INTS_H__
+#define __HW_INTS_H__
+
+#define FAULT_PENDSV            14
+#define FAULT_SYSTICK           15
+
+#define INT_GPIOA_TM4C123       16
+#define INT_ADC0SS0_TM4C123     30
+#define INT_ADC0SS1_TM4C123     31
+#define INT_ADC0SS2_TM4C123     32
+#define INT_ADC0SS3_TM4C123     33
+#define INT_TIMER0A_TM4C123     35
+#define INT_TIMER0B_TM4C123     36
+#define INT_TIMER1A_TM4C123     37
+#define INT_TIMER1B_TM4C123     38
+#define INT_TIMER2A_TM4C123     39
+#define INT_TIMER2B_TM4C123     40
+#define INT_TIMER3A_TM4C123     51
+#define INT_TIMER3B_TM4C123     52
+#define INT_UDMA_TM4C123        62
+#define INT_TIMER4A_TM4C123     86
+#define INT_TIMER4B_TM4C123     87
+#define INT_TIMER5A_TM4C123     108
+#define INT_TIMER5B_TM4C123     109
+
+#define NUM_INTERRUPTS          155
+
+#endif // __HW_INTS_H__
@@ -0,0 +1,20 @@
+//*****************************************************************************
+// hw_sysctl.h - host (Linux) stand-in for the TivaWare header of the same name
+//*****************************************************************************
+#ifndef __HW_SYSCTL_H__
+#define __HW_SYSCTL_H__
+
+#define SYSCTL_RCGCTIMER        0x400FE604
+#define SYSCTL_RCGCGPIO         0x400FE608
+#define SYSCTL_RCGCADC          0x400FE638
+#define SYSCTL_RCGCPWM          0x400FE640
+#define SYSCTL_PRGPIO           0x400FEA08
+
+#define SYSCTL_RCGCGPIO_R5      0x00000020
+#define SYSCTL_RCGCGPIO_R4      0x00000010
+#define SYSCTL_RCGCGPIO_R3      0x00000008
+#define SYSCTL_RCGCGPIO_R2      0x00000004
+#define SYSCTL_RCGCGPIO_R1      0x00000002
+#define SYSCTL_RCGCGPIO_R0      0x00000001
+
+#endif // __HW_SYSCTL_H__
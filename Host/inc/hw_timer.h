@@ -0,0 +1,25 @@
+//*****************************************************************************
+// hw_timer.h - host (Linux) stand-in for the TivaWare header of the same name
+// The simulated timers are driven through the driverlib calls, so only the
+// register offsets are given here.
+//*****************************************************************************
+#ifndef __HW_TIMER_H__
+#define __HW_TIMER_H__
+
+#define TIMER_O_CFG             0x00000000
+#define TIMER_O_TAMR            0x00000004
+#define TIMER_O_TBMR            0x00000008
+#define TIMER_O_CTL             0x0000000C
+#define TIMER_O_IMR             0x00000018
+#define TIMER_O_RIS             0x0000001C
+#define TIMER_O_ICR             0x00000024
+#define TIMER_O_TAILR           0x00000028
+#define TIMER_O_TBILR           0x0000002C
+#define TIMER_O_TAMATCHR        0x00000030
+#define TIMER_O_TBMATCHR        0x00000034
+#define TIMER_O_TAV             0x00000050
+#define TIMER_O_TBV             0x00000054
+
+#define TIMER_TAMR_TAMIE        0x00000020  // Timer A match interrupt enable
+
+#endif // __HW_TIMER_H__
@@ -0,0 +1,18 @@
+//*****************************************************************************
+// hw_types.h - host (Linux) stand-in for the TivaWare header of the same name
+//
+// HWREG is routed to the simulated register file in ES_HostPort.c, so code
+// that pokes registers directly builds and runs unchanged on the host. Reads
+// return whatever was last written, or what a test put there with HWREG.
+//*****************************************************************************
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+volatile uint32_t *HostReg(uint32_t Address);
+
+#define HWREG(x)    (*HostReg((uint32_t)(x)))
+
+#endif // __HW_TYPES_H__
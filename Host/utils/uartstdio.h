@@ -0,0 +1,12 @@
+//*****************************************************************************
+// uartstdio.h - host (Linux) stand-in for the TivaWare utils header
+// On the host the console is stdin/stdout, see HostTermio.c
+//*****************************************************************************
+#ifndef __UARTSTDIO_H__
+#define __UARTSTDIO_H__
+
+#include <stdio.h>
+
+#define UARTprintf printf
+
+#endif // __UARTSTDIO_H__
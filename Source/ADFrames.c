@@ -0,0 +1,174 @@
+// ADFrames.c
+// Timer triggered sampling of the microphone input (PE0) on ADC1, with
+// uDMA filling two frame buffers in turn.
+// Timer 3A, periodic at the sample rate, triggers sample sequencer 3 of
+// ADC1 to convert channel 3 (PE0). Each result asks uDMA channel 27 to move
+// it from the FIFO to the next place in the frame being filled. The channel
+// runs in ping-pong mode, its primary control structure filling frame 0 and
+// its alternate frame 1, and when either is done the ADC1 SS3 interrupt
+// sets it up again and posts the frame. So no software runs per sample, and
+// the samples are as evenly spaced as the timer.
+// ADC0 stays with ADMulti.c, for the software triggered reads.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_adc.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/gpio.h"
+#include "driverlib/adc.h"
+#include "driverlib/timer.h"
+#include "driverlib/udma.h"
+#include "driverlib/interrupt.h"
+
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ADFrames.h"
+
+#if defined(ES_USE_BASEPRI) && !defined(ES_USE_ISR_CHANNELS)
+#error "with ES_USE_BASEPRI the sampling interrupt can only post through a channel"
+#endif
+
+#define SEQUENCER 3
+#define DMA_CHANNEL UDMA_CH27_ADC1_3
+
+void ADCFrameHandler(void);
+static void SetUpTransfer(uint8_t Which);
+static void PostFrame(uint8_t Which);
+
+static uint16_t Frames[2][ADC_FRAME_LEN];
+static uint8_t MyService;
+static volatile uint32_t NumFrames;
+
+// the uDMA control table, which must start on a 1024 byte boundary. It has
+// room for the primary and alternate structures of all 32 channels
+#if defined(rvmdk) || defined(__ARMCC_VERSION)
+__align(1024) static uint8_t DMAControlTable[1024];
+#else
+static uint8_t DMAControlTable[1024] __attribute__((aligned(1024)));
+#endif
+
+// set up ADC1, Timer 3 and the uDMA, to post ADC_FRAME_READY events to
+// WhichService
+void ADC_FrameInit(uint8_t WhichService){
+  MyService = WhichService;
+  NumFrames = 0;
+
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC1);
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER3);
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+  while (SysCtlPeripheralReady(SYSCTL_PERIPH_GPIOE) != true)
+    ;
+  while (SysCtlPeripheralReady(SYSCTL_PERIPH_ADC1) != true)
+    ;
+  while (SysCtlPeripheralReady(SYSCTL_PERIPH_TIMER3) != true)
+    ;
+  while (SysCtlPeripheralReady(SYSCTL_PERIPH_UDMA) != true)
+    ;
+  GPIOPinTypeADC(GPIO_PORTE_BASE, GPIO_PIN_0);
+
+  // one conversion of PE0 on each timer trigger, handed to the uDMA
+  ADCSequenceDisable(ADC1_BASE, SEQUENCER);
+  ADCSequenceConfigure(ADC1_BASE, SEQUENCER, ADC_TRIGGER_TIMER, 0);
+  ADCSequenceStepConfigure(ADC1_BASE, SEQUENCER, 0,
+                           ADC_CTL_CH3 | ADC_CTL_IE | ADC_CTL_END);
+  ADCSequenceDMAEnable(ADC1_BASE, SEQUENCER);
+  ADCSequenceEnable(ADC1_BASE, SEQUENCER);
+
+  // the trigger, loaded with the sample period by ADC_FrameStart
+  TimerConfigure(TIMER3_BASE, TIMER_CFG_PERIODIC);
+  TimerControlTrigger(TIMER3_BASE, TIMER_A, true);
+
+  // 16 bits at a time from the FIFO to the frame, one per request
+  uDMAEnable();
+  uDMAControlBaseSet(DMAControlTable);
+  uDMAChannelAssign(DMA_CHANNEL);
+  uDMAChannelAttributeDisable(DMA_CHANNEL, UDMA_ATTR_ALL);
+  uDMAChannelControlSet(DMA_CHANNEL | UDMA_PRI_SELECT, UDMA_SIZE_16 |
+                        UDMA_SRC_INC_NONE | UDMA_DST_INC_16 | UDMA_ARB_1);
+  uDMAChannelControlSet(DMA_CHANNEL | UDMA_ALT_SELECT, UDMA_SIZE_16 |
+                        UDMA_SRC_INC_NONE | UDMA_DST_INC_16 | UDMA_ARB_1);
+}
+
+//------------ADC_FrameStart------------
+// starts sampling at SampleRate per second, into frame 0 and then frame 1
+// and round again
+// Input: the sample rate, 1 to ADC_FRAME_MAX_RATE
+// Output: false if the rate is out of range
+bool ADC_FrameStart(uint32_t SampleRate){
+  if ((SampleRate == 0) || (SampleRate > ADC_FRAME_MAX_RATE))
+    return false;
+  ADC_FrameStop();
+  SetUpTransfer(0);
+  SetUpTransfer(1);
+  uDMAChannelEnable(DMA_CHANNEL);
+  ADCIntClear(ADC1_BASE, SEQUENCER);
+  ADCIntEnable(ADC1_BASE, SEQUENCER);
+#ifdef ES_USE_BASEPRI
+  // above the critical regions, so the frames are never re-armed late
+  IntPrioritySet(INT_ADC1SS3_TM4C123, ES_SAMPLING_PRIORITY);
+#endif
+  IntEnable(INT_ADC1SS3_TM4C123);
+  TimerLoadSet(TIMER3_BASE, TIMER_A, SysCtlClockGet() / SampleRate - 1);
+  TimerEnable(TIMER3_BASE, TIMER_A);
+  return true;
+}
+
+// stops sampling, dropping the frame that was being filled
+void ADC_FrameStop(void){
+  TimerDisable(TIMER3_BASE, TIMER_A);
+  IntDisable(INT_ADC1SS3_TM4C123);
+  uDMAChannelDisable(DMA_CHANNEL);
+}
+
+// the 12 bit samples of a frame, oldest in [0]
+const uint16_t *ADC_FrameData(uint8_t Which){
+  return Frames[Which & 1];
+}
+
+// the number of frames filled since ADC_FrameInit
+uint32_t ADC_FrameCount(void){
+  return NumFrames;
+}
+
+// the ADC1 SS3 interrupt, which comes when the uDMA has filled a frame.
+// The finished half of the ping-pong has stopped, so set it up to fill the
+// same frame again after the one in progress, and post it
+void ADCFrameHandler(void){
+  ADCIntClear(ADC1_BASE, SEQUENCER);
+  if (uDMAChannelModeGet(DMA_CHANNEL | UDMA_PRI_SELECT) == UDMA_MODE_STOP){
+    SetUpTransfer(0);
+    PostFrame(0);
+  }
+  if (uDMAChannelModeGet(DMA_CHANNEL | UDMA_ALT_SELECT) == UDMA_MODE_STOP){
+    SetUpTransfer(1);
+    PostFrame(1);
+  }
+}
+
+// point the primary (frame 0) or alternate (frame 1) control structure at
+// the start of its frame
+static void SetUpTransfer(uint8_t Which){
+  uDMAChannelTransferSet(DMA_CHANNEL |
+                         ((Which == 0) ? UDMA_PRI_SELECT : UDMA_ALT_SELECT),
+                         UDMA_MODE_PINGPONG,
+                         (void *)(ADC1_BASE + ADC_O_SSFIFO3),
+                         Frames[Which], ADC_FRAME_LEN);
+}
+
+static void PostFrame(uint8_t Which){
+  ES_Event ThisEvent;
+
+  NumFrames++;
+  ThisEvent.EventType = ADC_FRAME_READY;
+  ThisEvent.EventParam = Which;
+#ifdef ES_USE_ISR_CHANNELS
+  // leave the post to _HW_Process_Pending_Ints, without turning ints off
+  ES_ChannelPost(ES_CHANNEL_ADCFrames, MyService, ThisEvent);
+#else
+  ES_PostToService(MyService, ThisEvent);
+#endif
+}
@@ -10,6 +10,8 @@
 #include "inc/tm4c123gh6pm.h"
 
 #include "ADMulti.h"
+#include "ES_Record.h"
+#include "ES_Section.h"
 
 static const uint32_t HowMany2Mask[4] = {0x01,0x03,0x07,0x0F};
 // this mapping puts PE0 as resuult 0, PE1 as result 1...
@@ -57,11 +59,13 @@ void ADC_MultiInit(uint8_t HowMany){
 // Input: none
 // Output: up to 4 12-bit result of ADC conversions
 // software trigger, busy-wait sampling, takes about 18.6uS to execute
+// (time it with ES_USE_SECTIONS, as the ADC_MultiRead section)
 // data returned by reference
 // lowest numbered converted channel is in data[0]
 void ADC_MultiRead(uint32_t data[4]){ 
   uint8_t i;
   
+  ES_SECTION_BEGIN(ADC_MultiRead);
   ADC0_PSSI_R = 0x0004;               // 1) initiate SS2
   while((ADC0_RIS_R&0x04)==0)
   {};                                 // 2) wait for conversion(s) to complete
@@ -69,4 +73,6 @@ void ADC_MultiRead(uint32_t data[4]){
     data[i] = ADC0_SSFIFO2_R&0xFFF;   // 3) read result, one at a time
   }
   ADC0_ISC_R = 0x0004;                // 4) acknowledge completion, clear int
+  ES_INPUT_ADC(data, NumChannelsConverting); // 5) log or replay the results
+  ES_SECTION_END(ADC_MultiRead);
 }
@@ -35,6 +35,30 @@
 /*---------------------------- Module Variables ---------------------------*/
 
 /*------------------------------ Module Code ------------------------------*/
+#ifdef ES_USE_EVENT_POOL
+/****************************************************************************
+ Function
+     ES_DeferEvent
+ Parameters
+     ES_Event * pBlock : pointer to the block of memory in use as the Queue
+     ES_Event Event2Add : event to be added to the Queue
+ Returns
+     bool : true if the add was successful, false if not
+ Description
+     if it will fit, adds Event2Add to the Queue, holding a reference to its
+     payload while it is there
+ Notes
+     only a function when ES_USE_EVENT_POOL is defined, a macro otherwise
+****************************************************************************/
+bool ES_DeferEvent( ES_Event * pBlock, ES_Event Event2Add ){
+  if ( ES_EnQueueLIFO( pBlock, Event2Add ) != true )
+    return false;
+  if ( ES_EVENT_HAS_PAYLOAD(Event2Add.EventType) )
+    ES_PoolAddRef( Event2Add.pPayload );
+  return true;
+}
+#endif
+
 /****************************************************************************
  Function
      ES_RecallEvents
@@ -62,6 +86,11 @@ bool ES_RecallEvents( uint8_t WhichService, ES_Event * pBlock ){
 		ES_DeQueue( pBlock, &RecalledEvent );
 		if (RecalledEvent.EventType != ES_NO_EVENT){
 			ES_PostToServiceLIFO( WhichService, RecalledEvent);
+#ifdef ES_USE_EVENT_POOL
+			// the post took its own reference, drop the deferred copy's
+			if ( ES_EVENT_HAS_PAYLOAD(RecalledEvent.EventType) )
+				ES_PoolRelease( RecalledEvent.pPayload );
+#endif
 			WereEventsPulled = true;
 		}
   }while(RecalledEvent.EventType != ES_NO_EVENT);
@@ -51,177 +51,193 @@ typedef struct {
 
 typedef struct {
     ES_Event *pMem;       // pointer to the memory
-    uint8_t Size;      // how big is it
+    ES_QueueIndex_t Size;      // how big is it
 }ES_QueueDesc_t;
 
-/*---------------------------- Module Functions ---------------------------*/
-//static bool CheckSystemEvents( void );
-
-/*---------------------------- Module Variables ---------------------------*/
-/****************************************************************************/
-// You fill in this array with the names of the service init & run functions
-// for each service that you use.
-// The order is: InitFunction, RunFunction
-// The first entry, at index 0, is the lowest priority, with increasing
-// priority with higher indices
-
-static ES_ServDesc_t const ServDescList[] =
-{ {SERV_0_INIT, SERV_0_RUN } /* lowest priority  always present */
-#if NUM_SERVICES > 1
-  ,{SERV_1_INIT, SERV_1_RUN }
-#endif
-#if NUM_SERVICES > 2
-  ,{SERV_2_INIT, SERV_2_RUN }
-#endif
-#if NUM_SERVICES > 3
-  ,{SERV_3_INIT, SERV_3_RUN }
+// stamp events with their post time and count the result of each post when
+// profiling, and compile to nothing when not
+#ifdef ES_USE_PROFILER
+#define STAMP_POST(_event_)         ((_event_).PostTime = _HW_GetCycleCount())
+#define LOG_POST(_serv_, _posted_)  LogPost((_serv_), (_posted_))
+#else
+#define STAMP_POST(_event_)
+#define LOG_POST(_serv_, _posted_)
 #endif
-#if NUM_SERVICES > 4
-  ,{SERV_4_INIT, SERV_4_RUN }
-#endif
-#if NUM_SERVICES > 5
-  ,{SERV_5_INIT, SERV_5_RUN }
-#endif
-#if NUM_SERVICES > 6
-  ,{SERV_6_INIT, SERV_6_RUN }
-#endif
-#if NUM_SERVICES > 7
-  ,{SERV_7_INIT, SERV_7_RUN }
+
+// with the event pool, each queued copy of an event with a payload holds a
+// reference to it, which is dropped once the copy has been dispatched
+#ifdef ES_USE_EVENT_POOL
+#define HOLD_PAYLOAD(_event_) \
+  ( ES_EVENT_HAS_PAYLOAD((_event_).EventType) ? \
+    ES_PoolAddRef((_event_).pPayload) : (void)0 )
+#define DROP_PAYLOAD(_event_) \
+  ( ES_EVENT_HAS_PAYLOAD((_event_).EventType) ? \
+    ES_PoolRelease((_event_).pPayload) : (void)0 )
+#else
+#define HOLD_PAYLOAD(_event_)
+#define DROP_PAYLOAD(_event_)
 #endif
-#if NUM_SERVICES > 8
-  ,{SERV_8_INIT, SERV_8_RUN }
+
+// a post to several services only needs to visit each of them again, once
+// interrupts are back on, if one of these options has per-service work to do
+#if defined(ES_USE_PROFILER) || defined(ES_USE_TRACE) || \
+    defined(ES_USE_EVENT_POOL)
+#define ES_PER_SERVICE_POST_WORK
 #endif
-#if NUM_SERVICES > 9
-  ,{SERV_9_INIT, SERV_9_RUN }
+
+// with the preemptive kernel, every successful post checks whether a higher
+// priority service than the one running has just become ready
+#ifdef ES_USE_PREEMPTION
+#ifdef ES_USE_BATCH_DISPATCH
+#error "ES_USE_PREEMPTION and ES_USE_BATCH_DISPATCH can not be used together"
 #endif
-#if NUM_SERVICES > 10
-  ,{SERV_10_INIT, SERV_10_RUN }
+#ifdef ES_USE_WAIT_STATS
+#error "ES_USE_PREEMPTION and ES_USE_WAIT_STATS can not be used together"
 #endif
-#if NUM_SERVICES > 11
-  ,{SERV_11_INIT, SERV_11_RUN }
+#define PREEMPT() ES_Preempt()
+#else
+#define PREEMPT()
 #endif
-#if NUM_SERVICES > 12
-  ,{SERV_12_INIT, SERV_12_RUN }
+
+/*---------------------------- Module Functions ---------------------------*/
+//static bool CheckSystemEvents( void );
+static void MarkReady( uint8_t WhichService );
+static bool PostToMask( ES_BitFlags_t Targets, ES_Event ThisEvent );
+static bool PostOne( uint8_t WhichService, ES_Event TheEvent );
+static bool PostWithPolicy( uint8_t WhichService, ES_Event TheEvent,
+                            ES_QueuePolicy_t Policy );
+static bool BatchIsPlain( uint8_t WhichService, const ES_Event *pEvents,
+                          ES_QueueIndex_t NumEvents );
+static void LogQueue( uint8_t WhichService, bool Coalesced, bool Dropped );
+static bool LogQueueInCritical( uint8_t WhichService, bool Coalesced,
+                                bool Dropped );
+static void EaseQueue( uint8_t WhichService );
+#ifdef ES_USE_PREEMPTION
+static void Schedule( void );
 #endif
-#if NUM_SERVICES > 13
-  ,{SERV_13_INIT, SERV_13_RUN }
+static ES_Event RunService( uint8_t WhichService, ES_Event ThisEvent );
+#ifdef ES_USE_PROFILER
+static void LogPost( uint8_t WhichService, bool Posted );
 #endif
-#if NUM_SERVICES > 14
-  ,{SERV_14_INIT, SERV_14_RUN }
+#ifdef ES_USE_BATCH_DISPATCH
+static uint8_t PickService( ES_Time_t Now, bool *pForced );
 #endif
-#if NUM_SERVICES > 15
-  ,{SERV_15_INIT, SERV_15_RUN }
+#ifdef ES_USE_WAIT_STATS
+static void LogWait( ES_WaitStats_t *pStats, ES_Time_t Wait, bool Forced );
 #endif
 
+/*---------------------------- Module Variables ---------------------------*/
+/****************************************************************************/
+// The service descriptors, queues and queue descriptors below are all 
+// generated from SERVICE_LIST in ES_Configure.h. 
+// The order is: InitFunction, RunFunction
+// The first entry, at index 0, is the lowest priority, with increasing
+// priority with higher indices
+
+#define ES_SERV_DESC(_init_, _run_, _post_, _qsize_)  { _init_, _run_ },
+
+static ES_ServDesc_t const ServDescList[] =
+{ 
+  SERVICE_LIST(ES_SERV_DESC)
 };
 
 
 /****************************************************************************/
-// The queues for the services
+// The queues for the services, with room for the requested number of events
+// and the queue header (see ES_QUEUE_BLOCK_SIZE in ES_Queue.h)
 
-static ES_Event Queue0[SERV_0_QUEUE_SIZE+1];
-#if NUM_SERVICES > 1
-static ES_Event Queue1[SERV_1_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 2
-static ES_Event Queue2[SERV_2_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 3
-static ES_Event Queue3[SERV_3_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 4
-static ES_Event Queue4[SERV_4_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 5
-static ES_Event Queue5[SERV_5_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 6
-static ES_Event Queue6[SERV_6_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 7
-static ES_Event Queue7[SERV_7_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 8
-static ES_Event Queue8[SERV_8_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 9
-static ES_Event Queue9[SERV_9_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 10
-static ES_Event Queue10[SERV_10_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 11
-static ES_Event Queue11[SERV_11_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 12
-static ES_Event Queue12[SERV_12_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 13
-static ES_Event Queue13[SERV_13_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 14
-static ES_Event Queue14[SERV_14_QUEUE_SIZE+1];
-#endif
-#if NUM_SERVICES > 15
-static ES_Event Queue15[SERV_15_QUEUE_SIZE+1];
-#endif
+#define ES_SERV_QUEUE(_init_, _run_, _post_, _qsize_) \
+  static ES_Event _run_##Queue[ES_QUEUE_BLOCK_SIZE(_qsize_)];
+
+SERVICE_LIST(ES_SERV_QUEUE)
 
 /****************************************************************************/
 // array of queue descriptors for posting by priority level
 
+#define ES_SERV_QUEUE_DESC(_init_, _run_, _post_, _qsize_) \
+  { _run_##Queue, ARRAY_SIZE(_run_##Queue) },
+
 static ES_QueueDesc_t const EventQueues[NUM_SERVICES] = { 
-  { Queue0, ARRAY_SIZE(Queue0) } 
-#if NUM_SERVICES > 1
-, { Queue1, ARRAY_SIZE(Queue1) }
-#endif
-#if NUM_SERVICES > 2
-, { Queue2, ARRAY_SIZE(Queue2) }
-#endif
-#if NUM_SERVICES > 3
-, { Queue3, ARRAY_SIZE(Queue3) }
-#endif
-#if NUM_SERVICES > 4
-, { Queue4, ARRAY_SIZE(Queue4) }
-#endif
-#if NUM_SERVICES > 5
-, { Queue5, ARRAY_SIZE(Queue5) }
-#endif
-#if NUM_SERVICES > 6
-, { Queue6, ARRAY_SIZE(Queue6) }
-#endif
-#if NUM_SERVICES > 7
-, { Queue7, ARRAY_SIZE(Queue7) }
-#endif
-#if NUM_SERVICES > 8
-, { Queue8, ARRAY_SIZE(Queue8) }
-#endif
-#if NUM_SERVICES > 9
-, { Queue9, ARRAY_SIZE(Queue9) }
-#endif
-#if NUM_SERVICES > 10
-, { Queue10, ARRAY_SIZE(Queue10) }
-#endif
-#if NUM_SERVICES > 11
-, { Queue11, ARRAY_SIZE(Queue11) }
-#endif
-#if NUM_SERVICES > 12
-, { Queue12, ARRAY_SIZE(Queue12) }
-#endif
-#if NUM_SERVICES > 13
-, { Queue13, ARRAY_SIZE(Queue13) }
-#endif
-#if NUM_SERVICES > 14
-, { Queue14, ARRAY_SIZE(Queue14) }
-#endif
-#if NUM_SERVICES > 15
-, { Queue15, ARRAY_SIZE(Queue15) }
+  SERVICE_LIST(ES_SERV_QUEUE_DESC)
+};
+
+/****************************************************************************/
+// static report of the RAM taken up by the service queues. Look for
+// ES_QueueRAMBytes in the link map, or set ES_MAX_QUEUE_RAM in ES_Configure.h
+// to turn an overrun into a build error
+
+#define ES_SERV_QUEUE_BYTES(_init_, _run_, _post_, _qsize_) \
+  + sizeof(_run_##Queue)
+
+#define ES_QUEUE_RAM_BYTES (0 SERVICE_LIST(ES_SERV_QUEUE_BYTES))
+
+uint16_t const ES_QueueRAMBytes = ES_QUEUE_RAM_BYTES;
+
+#ifdef ES_MAX_QUEUE_RAM
+// a negative array size stops the build if the queues need too much RAM
+typedef char ES_QueueRAMCheck_t[(ES_QUEUE_RAM_BYTES <= ES_MAX_QUEUE_RAM) ? 1 : -1];
 #endif
+
+/****************************************************************************/
+// what a post does when it finds each queue full, from QUEUE_POLICY_LIST in
+// ES_Configure.h. Services that are not listed get ES_QUEUE_REJECT (0)
+
+#define ES_QUEUE_POLICY(_run_, _policy_) [ES_PRIORITY(_run_)] = (_policy_),
+
+static ES_QueuePolicy_t const QueuePolicy[NUM_SERVICES] = {
+  QUEUE_POLICY_LIST(ES_QUEUE_POLICY)
 };
 
+// the overflow counters and alert function for each queue, and which of the
+// queues are congested, one bit per service as in Ready
+static ES_QueueStats_t QueueStats[NUM_SERVICES];
+static ES_QueueAlertFunc_t *QueueAlert[NUM_SERVICES];
+static ES_BitFlags_t Congested;
+
 /****************************************************************************/
 // Variable used to keep track of which queues have events in them
+// sized by ES_LookupTables.h to hold at least MAX_NUM_SERVICES bits
+
+ES_BitFlags_t Ready;
+
+/****************************************************************************/
+// The subscribers to each event type, one bit per service as in Ready.
+// Filled in from SUBSCRIPTION_LIST in ES_Configure.h, and changed at run time
+// by ES_Subscribe and ES_Unsubscribe
+
+#define ES_SUBSCRIBERS(_type_, _mask_) [_type_] = (_mask_),
+
+static ES_BitFlags_t Subscribers[ES_NUM_EVENT_TYPES] = {
+  SUBSCRIPTION_LIST(ES_SUBSCRIBERS)
+};
+
+// every service, the targets for ES_PostAll
+#define ALL_SERVICES_MASK \
+  ((ES_BitFlags_t)(((ES_BitFlags_t)1 << (NUM_SERVICES - 1)) * 2 - 1))
+
+#ifdef ES_USE_PROFILER
+static ES_ServiceProfile_t Profile[NUM_SERVICES];
+#endif
+
+#ifdef ES_USE_PREEMPTION
+// the priority of the service that is running plus 1, 0 when none is, and
+// the number of ES_SchedLock calls not yet matched by ES_SchedUnlock
+static volatile uint8_t RunningLevel;
+static volatile uint8_t SchedLockCount;
+// set if a run function returned an error from inside a preemption, where
+// there is no ES_Run to return it to
+static bool RunFailed;
+#endif
+
+#ifdef ES_USE_WAIT_STATS
+// the time at which each service last went from idle to ready, and the time
+// of the last pass through ES_CheckUserEvents
+static ES_Time_t ReadySince[NUM_SERVICES];
+static ES_Time_t CheckersSince;
 
-uint16_t Ready;
+static ES_WaitStats_t WaitStats[NUM_SERVICES];
+static ES_WaitStats_t CheckerStats;
+#endif
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -242,13 +258,18 @@ uint16_t Ready;
 ES_Return_t ES_Initialize( TimerRate_t NewRate ){
   uint8_t i;
   ES_Timer_Init( NewRate); // start up the timer subsystem
+  _HW_CycleCounterInit(); // start ES_Cycles, for the profilers and the app
+#ifdef ES_USE_RECORD
+  ES_RecordInit(); // before the init functions, they read inputs too
+#endif
   // loop through the list testing for NULL pointers and
   for ( i=0; i< ARRAY_SIZE(ServDescList); i++) {
     if ( (ServDescList[i].InitFunc == (pInitFunc)0) ||
          (ServDescList[i].RunFunc == (pRunFunc)0) )
       return FailedPointer; // protect against NULL pointers
     // and initializing the event queues (must happen before running inits)  
-    ES_InitQueue( EventQueues[i].pMem, EventQueues[i].Size );
+    QueueStats[i].Capacity = ES_InitQueue( EventQueues[i].pMem, 
+                                           EventQueues[i].Size );
    // executing the init functions
     if ( ServDescList[i].InitFunc(i) != true )
       return FailedInit; // this is a failed initialization
@@ -275,29 +296,113 @@ ES_Return_t ES_Initialize( TimerRate_t NewRate ){
    J. Edward Carryer, 10/23/11,
 ****************************************************************************/
 ES_Return_t ES_Run( void ){
+#ifndef ES_USE_PREEMPTION
   // make these static to improve speed
   uint8_t HighestPrior;
+#ifndef ES_USE_BATCH_DISPATCH
   static ES_Event ThisEvent;
+#endif
+#endif
+#ifdef ES_USE_BATCH_DISPATCH
+  static ES_Event Batch[ES_DISPATCH_BATCH];
+  ES_QueueIndex_t NumTaken;
+  ES_QueueIndex_t BatchCount;
+  ES_Time_t Now;
+  bool Forced;
+#endif
   
+#ifdef ES_USE_PREEMPTION
+  // ES_Run is the idle level of the preemptive kernel. Every service runs
+  // from Schedule, either here or nested inside a lower priority one
+  while(1){
+    _HW_Process_Pending_Ints();
+    Schedule();
+    if ( RunFailed )
+      return FailedRun;
+    if ( (ES_CheckUserEvents() == false) && (Ready == 0) )
+      _HW_Idle(); // nothing to do until the next interrupt
+  }
+#else
   while(1){ // stay here unless we detect an error condition
 
     // loop through the list executing the run functions for services
     // with a non-empty queue. Process any pending ints before testing
     // Ready
     while( (_HW_Process_Pending_Ints()) && (Ready != 0)){
+#ifndef ES_USE_BATCH_DISPATCH
       HighestPrior =  ES_GetMSBitSet(Ready);
+#ifdef ES_USE_WAIT_STATS
+      LogWait( &WaitStats[HighestPrior],
+              ES_Timer_GetTime() - ReadySince[HighestPrior], false);
+#endif
       if ( ES_DeQueue( EventQueues[HighestPrior].pMem, &ThisEvent ) == 0 ){
         Ready &= BitNum2ClrMask[HighestPrior]; // mark queue as now empty
       }
-      if( ServDescList[HighestPrior].RunFunc(ThisEvent).EventType != 
+      ES_TRACE(ES_TRACE_DISPATCH, HighestPrior, ThisEvent);
+      if( RunService(HighestPrior, ThisEvent).EventType != 
+                                                              ES_NO_EVENT) {
+              return FailedRun;
+      }
+#ifdef ES_USE_WAIT_STATS
+      // anything left over starts a new wait
+      if ( (Ready & BitNum2SetMask[HighestPrior]) != 0 )
+        ReadySince[HighestPrior] = ES_Timer_GetTime();
+#endif
+#else
+      Now = ES_Timer_GetTime();
+      // if the event checkers have been held off too long, give them a pass
+      if ( (ES_Time_t)(Now - CheckersSince) >= ES_STARVATION_TICKS ){
+        LogWait( &CheckerStats, Now - CheckersSince, true);
+        CheckersSince = Now;
+        ES_CheckUserEvents();
+        continue;
+      }
+      HighestPrior = PickService( Now, &Forced );
+      LogWait( &WaitStats[HighestPrior], 
+              Now - ReadySince[HighestPrior], Forced);
+      // take up to a batch of events from this service in one go. A
+      // forced pick already has a higher priority service waiting on it, so
+      // it only gets the one event
+      NumTaken = ES_DeQueueBatch( EventQueues[HighestPrior].pMem, Batch,
+                                  Forced ? 1 : ES_DISPATCH_BATCH );
+      if ( ES_IsQueueEmpty( EventQueues[HighestPrior].pMem ) ){
+        Ready &= BitNum2ClrMask[HighestPrior]; // mark queue as now empty
+      }
+      // and run them, stopping early if a higher priority service becomes
+      // ready. The events not yet run go back to the front of the queue,
+      // unless new posts have taken their room, when they are run anyway
+      for ( BatchCount = 0; BatchCount < NumTaken; BatchCount++ ){
+        ES_TRACE(ES_TRACE_DISPATCH, HighestPrior, Batch[BatchCount]);
+        if( RunService(HighestPrior, Batch[BatchCount]).EventType != 
                                                               ES_NO_EVENT) {
               return FailedRun;
+        }
+        if ( BatchCount + 1 == NumTaken )
+          break;
+        if ( (Ready != 0) && (ES_GetMSBitSet(Ready) > HighestPrior) &&
+             ES_EnQueueBatchLIFO( EventQueues[HighestPrior].pMem,
+                                  &Batch[BatchCount + 1],
+                                  NumTaken - BatchCount - 1 ) ){
+          Ready |= BitNum2SetMask[HighestPrior];
+          break;
+        }
+        _HW_Process_Pending_Ints(); // keep the timers ticking between events
       }
+      // anything left over starts a new wait
+      if ( (Ready & BitNum2SetMask[HighestPrior]) != 0 )
+        ReadySince[HighestPrior] = ES_Timer_GetTime();
+#endif
     }
 
     // all the queues are empty, so look for new user detected events
-    ES_CheckUserEvents();
+#ifdef ES_USE_WAIT_STATS
+    LogWait( &CheckerStats, ES_Timer_GetTime() - CheckersSince, false);
+    CheckersSince = ES_Timer_GetTime();
+#endif
+    if ( (ES_CheckUserEvents() == false) && (Ready == 0) )
+      _HW_Idle(); // nothing to do until the next interrupt
   }
+#endif
 }
 
 /****************************************************************************
@@ -315,21 +420,73 @@ ES_Return_t ES_Run( void ){
    J. Edward Carryer, 01/15/12,
 ****************************************************************************/
 bool ES_PostAll( ES_Event ThisEvent){
+  ES_TRACE(ES_TRACE_POST_ALL, ES_TRACE_NO_SERVICE, ThisEvent);
+  return PostToMask( ALL_SERVICES_MASK, ThisEvent );
+}
 
-  uint8_t i;
-  // loop through the list executing the post functions
-  for ( i=0; i< ARRAY_SIZE(EventQueues); i++) {
-    if ( ES_EnQueueFIFO( EventQueues[i].pMem, ThisEvent ) != true ){
-      break; // this is a failed post
-    }else{
-      Ready |= BitNum2SetMask[i]; // show queue as non-empty
-    }
-  }
-  if ( i == ARRAY_SIZE(EventQueues) ){ // if no failures
-    return (true);
-  }else{
-    return(false);
-  }
+/****************************************************************************
+ Function
+   ES_Publish
+ Parameters
+   ES_Event : The Event to be published
+ Returns
+   boolean : False if any of the subscribers' queues was full
+ Description
+   posts the event to every service that has subscribed to its event type,
+   so the publisher does not need to know who is listening
+ Notes
+   the subscribers come from SUBSCRIPTION_LIST in ES_Configure.h and from
+   ES_Subscribe. Publishing an event type with no subscribers succeeds.
+****************************************************************************/
+bool ES_Publish( ES_Event ThisEvent){
+  if ( ThisEvent.EventType >= ES_NUM_EVENT_TYPES )
+    return false;
+  return PostToMask( Subscribers[ThisEvent.EventType], ThisEvent );
+}
+
+/****************************************************************************
+ Function
+   ES_Subscribe
+ Parameters
+   uint8_t : Which service is subscribing (its priority)
+   ES_EventTyp_t : the event type that it wants to receive
+ Returns
+   boolean : False if either parameter is out of range
+ Description
+   adds the service to the subscribers for the event type
+ Notes
+
+****************************************************************************/
+bool ES_Subscribe( uint8_t WhichService, ES_EventTyp_t EventType ){
+  if ( (WhichService >= NUM_SERVICES) || (EventType >= ES_NUM_EVENT_TYPES) )
+    return false;
+  EnterCritical();   // ES_Publish may be called from an interrupt response
+  Subscribers[EventType] |= BitNum2SetMask[WhichService];
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_Unsubscribe
+ Parameters
+   uint8_t : Which service is unsubscribing (its priority)
+   ES_EventTyp_t : the event type that it no longer wants to receive
+ Returns
+   boolean : False if either parameter is out of range
+ Description
+   removes the service from the subscribers for the event type. Events of
+   that type that are already in its queue are still delivered.
+ Notes
+
+****************************************************************************/
+bool ES_Unsubscribe( uint8_t WhichService, ES_EventTyp_t EventType ){
+  if ( (WhichService >= NUM_SERVICES) || (EventType >= ES_NUM_EVENT_TYPES) )
+    return false;
+  EnterCritical();
+  Subscribers[EventType] &= BitNum2ClrMask[WhichService];
+  ExitCritical();
+  return true;
 }
 
 /****************************************************************************
@@ -348,14 +505,29 @@ bool ES_PostAll( ES_Event ThisEvent){
    J. Edward Carryer, 01/16/12,
 ****************************************************************************/
 bool ES_PostToService( uint8_t WhichService, ES_Event TheEvent){
-  if ((WhichService < ARRAY_SIZE(EventQueues)) &&
-      (ES_EnQueueFIFO( EventQueues[WhichService].pMem, TheEvent) == 
-                                                                true )){
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
-    return true;
-  } else
-    return false;
+  STAMP_POST(TheEvent);
+  return PostOne( WhichService, TheEvent );
+}
+
+#ifdef ES_USE_ISR_CHANNELS
+/****************************************************************************
+ Function
+   ES_PostFromChannel
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted
+ Returns
+   boolean : False if the post function failed during execution
+ Description
+   the same as ES_PostToService, for ES_ChannelDrain
+ Notes
+   when profiling, the event keeps the post time stamped by ES_ChannelPost,
+   so that its latency includes the time spent waiting in the channel
+****************************************************************************/
+bool ES_PostFromChannel( uint8_t WhichService, ES_Event TheEvent){
+  return PostOne( WhichService, TheEvent );
 }
+#endif
 
 /****************************************************************************
  Function
@@ -373,18 +545,925 @@ bool ES_PostToService( uint8_t WhichService, ES_Event TheEvent){
    J. Edward Carryer, 11/02/13
 ****************************************************************************/
 bool ES_PostToServiceLIFO( uint8_t WhichService, ES_Event TheEvent){
+  STAMP_POST(TheEvent);
   if ((WhichService < ARRAY_SIZE(EventQueues)) &&
       (ES_EnQueueLIFO( EventQueues[WhichService].pMem, TheEvent) == 
                                                                 true )){
-    Ready |= BitNum2SetMask[WhichService]; // show queue as non-empty
+    HOLD_PAYLOAD(TheEvent);
+    MarkReady(WhichService); // show queue as non-empty
+    LOG_POST(WhichService, true);
+    LogQueue( WhichService, false, false );
+    ES_TRACE(ES_TRACE_POST, WhichService, TheEvent);
+    PREEMPT();
     return true;
-  } else
+  } else {
+    LOG_POST(WhichService, false);
+    if ( WhichService < ARRAY_SIZE(EventQueues) )
+      LogQueue( WhichService, false, true );
+    ES_TRACE(ES_TRACE_POST_FAIL, WhichService, TheEvent);
     return false;
+  }
 }
 
-//*********************************
-// private functions
-//*********************************
+/****************************************************************************
+ Function
+   ES_PostToServiceLatest
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted
+ Returns
+   boolean : False if the post function failed during execution
+ Description
+   Posts to one of the services' queues. If the event is of a type listed in
+   ES_EVENT_IS_LATEST and one of that type is still waiting in the queue, it
+   takes the place of the older one, which is never dispatched.
+ Notes
+   other event types are posted as by ES_PostToService. A replaced event
+   gives back its payload reference, if it has one
+****************************************************************************/
+bool ES_PostToServiceLatest( uint8_t WhichService, ES_Event TheEvent){
+  STAMP_POST(TheEvent);
+  if ( !ES_EVENT_IS_LATEST(TheEvent.EventType) )
+    return PostOne( WhichService, TheEvent );
+  return PostWithPolicy( WhichService, TheEvent, ES_QUEUE_COALESCE );
+}
+
+/****************************************************************************
+ Function
+   ES_PostToServiceBatch
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event * : the events to be posted, oldest first
+   ES_QueueIndex_t : how many events there are
+ Returns
+   boolean : False if any of the events could not be posted
+ Description
+   posts the events to one of the services' queues, with the same result as
+   posting them one at a time with ES_PostToService, but when they all fit
+   they are queued with one ES_EnQueueBatch and Ready is updated once
+ Notes
+   when profiling, the events are stamped with their post time in place.
+   If they do not all fit, or the queue's policy could treat them
+   differently from a plain FIFO (see BatchIsPlain), they are posted one at
+   a time with the queue's policy
+****************************************************************************/
+bool ES_PostToServiceBatch( uint8_t WhichService, ES_Event *pEvents,
+                            ES_QueueIndex_t NumEvents ){
+  ES_QueueIndex_t i;
+  bool ReturnVal = true;
+
+#ifdef ES_USE_PROFILER
+  for ( i = 0; i < NumEvents; i++ )
+    STAMP_POST(pEvents[i]);
+#endif
+  if ( (WhichService < ARRAY_SIZE(EventQueues)) && (NumEvents != 0) &&
+       BatchIsPlain( WhichService, pEvents, NumEvents ) &&
+       ES_EnQueueBatch( EventQueues[WhichService].pMem, pEvents, NumEvents ) ){
+    for ( i = 0; i < NumEvents; i++ ){
+      HOLD_PAYLOAD(pEvents[i]);
+      ES_TRACE(ES_TRACE_POST, WhichService, pEvents[i]);
+    }
+    MarkReady(WhichService); // show queue as non-empty
+    LOG_POST(WhichService, true);
+    LogQueue( WhichService, false, false );
+    PREEMPT();
+    return true;
+  }
+  for ( i = 0; i < NumEvents; i++ ){
+    if ( !PostOne( WhichService, pEvents[i] ) )
+      ReturnVal = false;
+  }
+  return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_SetQueueAlert
+ Parameters
+   uint8_t : Which service's queue to watch
+   ES_QueueAlertFunc_t * : the function to call, or NULL for none
+ Returns
+   boolean : False if WhichService is out of range
+ Description
+   sets the function to call when a post fills the service's queue, or loses
+   an event to it, and again once the service has emptied the queue. A
+   producer uses this to slow down while the service is behind
+ Notes
+   there is one alert function per queue. It is called from whatever posted
+   or ran the service, which may be an interrupt response, so it should do
+   no more than note the state for the producer to act on
+****************************************************************************/
+bool ES_SetQueueAlert( uint8_t WhichService, ES_QueueAlertFunc_t *pAlert ){
+  if ( WhichService >= ARRAY_SIZE(QueueAlert) )
+    return false;
+  QueueAlert[WhichService] = pAlert;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_GetQueueStats
+ Parameters
+   uint8_t : Which service's queue to report on
+   ES_QueueStats_t * : where to put a copy of the stats
+ Returns
+   boolean : False if WhichService is out of range
+ Description
+   copies out the overflow counters for the service's queue
+ Notes
+
+****************************************************************************/
+bool ES_GetQueueStats( uint8_t WhichService, ES_QueueStats_t *pStats ){
+  if ( WhichService >= ARRAY_SIZE(QueueStats) )
+    return false;
+  EnterCritical();
+  *pStats = QueueStats[WhichService];
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ClearQueueStats
+ Parameters
+   None
+ Returns
+   None
+ Description
+   zeroes the overflow counters for all of the queues
+ Notes
+   the capacities are left as they are
+
+****************************************************************************/
+void ES_ClearQueueStats( void ){
+  uint8_t i;
+
+  EnterCritical();
+  for ( i=0; i< ARRAY_SIZE(QueueStats); i++) {
+    QueueStats[i].NumDropped = 0;
+    QueueStats[i].NumCoalesced = 0;
+    QueueStats[i].PeakDepth = 0;
+  }
+  ExitCritical();
+}
+
+#ifdef ES_USE_PREEMPTION
+/****************************************************************************
+ Function
+   ES_Preempt
+ Parameters
+   None
+ Returns
+   None
+ Description
+   runs any ready service of higher priority than the one running, nested
+   inside it. From an interrupt response it asks the port to do that once
+   the interrupts are done (PendSV on the target)
+ Notes
+   called after every successful post. Only available when
+   ES_USE_PREEMPTION is defined
+****************************************************************************/
+void ES_Preempt( void ){
+  if ( _HW_InInterrupt() )
+    _HW_PendPreempt();
+  else
+    Schedule();
+}
+
+/****************************************************************************
+ Function
+   ES_PreemptActivate
+ Parameters
+   None
+ Returns
+   None
+ Description
+   the thread level response to _HW_PendPreempt: processes the pending
+   interrupts and then runs the services that they made ready
+ Notes
+   called by the port, with interrupts enabled, in place of whatever was
+   running when the interrupt came in
+****************************************************************************/
+void ES_PreemptActivate( void ){
+  _HW_Process_Pending_Ints();
+  Schedule();
+}
+
+/****************************************************************************
+ Function
+   ES_SchedLock
+ Parameters
+   None
+ Returns
+   None
+ Description
+   holds off preemption, without holding off interrupts, until the matching
+   ES_SchedUnlock. Calls may be nested
+ Notes
+   _HW_Process_Pending_Ints uses this so that the timeouts it posts are all
+   posted before any of their services run
+****************************************************************************/
+void ES_SchedLock( void ){
+  EnterCritical();
+  SchedLockCount++;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+   ES_SchedUnlock
+ Parameters
+   None
+ Returns
+   None
+ Description
+   undoes one ES_SchedLock. The last one runs anything that became ready at
+   a higher priority while preemption was held off
+ Notes
+
+****************************************************************************/
+void ES_SchedUnlock( void ){
+  EnterCritical();
+  SchedLockCount--;
+  ExitCritical();
+  Schedule();
+}
+#endif
+
+#ifdef ES_USE_PROFILER
+/****************************************************************************
+ Function
+   ES_GetServiceProfile
+ Parameters
+   uint8_t : Which service to report on (index into ServDescList)
+   ES_ServiceProfile_t * : where to put a copy of the profile
+ Returns
+   boolean : False if WhichService is out of range
+ Description
+   copies out the dispatch profile for one service
+ Notes
+   only available when ES_USE_PROFILER is defined
+****************************************************************************/
+bool ES_GetServiceProfile( uint8_t WhichService, ES_ServiceProfile_t *pProfile ){
+  if ( WhichService >= ARRAY_SIZE(Profile) )
+    return false;
+  EnterCritical();   // posts from interrupts also update the profile
+  *pProfile = Profile[WhichService];
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ClearProfile
+ Parameters
+   None
+ Returns
+   None
+ Description
+   zeros the dispatch profile for all of the services
+ Notes
+   only available when ES_USE_PROFILER is defined
+****************************************************************************/
+void ES_ClearProfile( void ){
+  uint8_t i;
+  for ( i=0; i< ARRAY_SIZE(Profile); i++) {
+    EnterCritical();
+    Profile[i] = (ES_ServiceProfile_t){ 0 };
+    ExitCritical();
+  }
+}
+
+/****************************************************************************
+ Function
+   ES_DumpProfile
+ Parameters
+   None
+ Returns
+   None
+ Description
+   prints the dispatch profile for all of the services to the console, one
+   line per service, in cycles of the CPU clock
+ Notes
+   only available when ES_USE_PROFILER is defined. This uses printf, so call
+   it from a run function, not from an interrupt response
+****************************************************************************/
+void ES_DumpProfile( void ){
+  uint8_t i;
+  ES_ServiceProfile_t ThisProfile;
+  uint32_t MeanCycles;
+  uint32_t MeanLatency;
+
+  printf("\r\nServ  Events  MeanCyc   MaxCyc  MeanLat   MaxLat  HiWtr  Fails\r\n");
+  for ( i=0; i< ARRAY_SIZE(Profile); i++) {
+    ES_GetServiceProfile( i, &ThisProfile );
+    MeanCycles = 0;
+    MeanLatency = 0;
+    if ( ThisProfile.NumDispatched != 0 ){
+      MeanCycles = (uint32_t)(ThisProfile.TotalCycles / 
+                                                  ThisProfile.NumDispatched);
+      MeanLatency = (uint32_t)(ThisProfile.TotalLatency / 
+                                                  ThisProfile.NumDispatched);
+    }
+    printf("%4u %7lu %8lu %8lu %8lu %8lu %6u %6u\r\n", i,
+           (unsigned long)ThisProfile.NumDispatched,
+           (unsigned long)MeanCycles, (unsigned long)ThisProfile.MaxCycles,
+           (unsigned long)MeanLatency, (unsigned long)ThisProfile.MaxLatency,
+           ThisProfile.QueueHighWater, ThisProfile.NumFailedPosts);
+  }
+}
+#endif
+
+#ifdef ES_USE_WAIT_STATS
+/****************************************************************************
+ Function
+   ES_GetWaitStats
+ Parameters
+   uint8_t : Which priority to report on, or ES_WAIT_STATS_CHECKERS for the
+             ES_CheckUserEvents pass
+   ES_WaitStats_t * : where to put a copy of the stats
+ Returns
+   boolean : False if WhichPriority is out of range
+ Description
+   copies out the wait time statistics kept by the dispatcher
+ Notes
+   only available when ES_USE_WAIT_STATS is defined, as it is with
+   ES_USE_BATCH_DISPATCH
+****************************************************************************/
+bool ES_GetWaitStats( uint8_t WhichPriority, ES_WaitStats_t *pStats ){
+  if ( WhichPriority == ES_WAIT_STATS_CHECKERS ){
+    *pStats = CheckerStats;
+  }else if ( WhichPriority < ARRAY_SIZE(WaitStats) ){
+    *pStats = WaitStats[WhichPriority];
+  }else
+    return false;
+  return true;
+}
+
+/****************************************************************************
+ Function
+   ES_ClearWaitStats
+ Parameters
+   None
+ Returns
+   None
+ Description
+   zeros the wait time statistics for all priorities and the event checkers
+ Notes
+   only available when ES_USE_WAIT_STATS is defined
+****************************************************************************/
+void ES_ClearWaitStats( void ){
+  uint8_t i;
+  for ( i=0; i< ARRAY_SIZE(WaitStats); i++) {
+    WaitStats[i] = (ES_WaitStats_t){ 0 };
+  }
+  CheckerStats = (ES_WaitStats_t){ 0 };
+}
+
+/****************************************************************************
+ Function
+   ES_DumpWaitStats
+ Parameters
+   None
+ Returns
+   None
+ Description
+   prints the wait time statistics for all of the priorities to the console,
+   one line per priority and a last one for the event checkers, in timer
+   ticks with the mean to a hundredth
+ Notes
+   only available when ES_USE_WAIT_STATS is defined. This uses printf, so
+   call it from a run function, not from an interrupt response
+****************************************************************************/
+void ES_DumpWaitStats( void ){
+  uint8_t i;
+  ES_WaitStats_t ThisStats;
+  uint32_t MeanHundredths;
+
+  printf("\r\nPrio  Batches  MeanWait  MaxWait  Forced\r\n");
+  for ( i=0; i<= ARRAY_SIZE(WaitStats); i++) {
+    if ( i < ARRAY_SIZE(WaitStats) ){
+      ES_GetWaitStats( i, &ThisStats );
+      printf("%4u", i);
+    }else{
+      ES_GetWaitStats( ES_WAIT_STATS_CHECKERS, &ThisStats );
+      printf("chks");
+    }
+    MeanHundredths = 0;
+    if ( ThisStats.NumBatches != 0 )
+      MeanHundredths = (uint32_t)(((uint64_t)ThisStats.TotalWait * 100 +
+                          ThisStats.NumBatches / 2) / ThisStats.NumBatches);
+    printf(" %8lu %6lu.%02lu %8lu %7u\r\n",
+           (unsigned long)ThisStats.NumBatches,
+           (unsigned long)(MeanHundredths / 100),
+           (unsigned long)(MeanHundredths % 100),
+           (unsigned long)ThisStats.MaxWait, ThisStats.NumForced);
+  }
+}
+#endif
+
+//*********************************
+// private functions
+//*********************************
+/****************************************************************************
+ Function
+   MarkReady
+ Parameters
+   uint8_t : Which service just had an event posted to it
+ Returns
+   None
+ Description
+   sets the service's bit in Ready and, for the batched dispatcher, notes the
+   time if the service was idle until now
+ Notes
+
+****************************************************************************/
+static void MarkReady( uint8_t WhichService ){
+#ifdef ES_USE_WAIT_STATS
+  if ( (Ready & BitNum2SetMask[WhichService]) == 0 )
+    ReadySince[WhichService] = ES_Timer_GetTime();
+#endif
+  Ready |= BitNum2SetMask[WhichService];
+}
+
+/****************************************************************************
+ Function
+   PostToMask
+ Parameters
+   ES_BitFlags_t : the services to post to, one bit per service as in Ready
+   ES_Event : The Event to be posted
+ Returns
+   boolean : False if any of the queues was full
+ Description
+   posts the event to each of the services in Targets. All of the queues are
+   filled and Ready is updated inside one critical region, so an interrupt
+   response never sees some of the services posted to and not others.
+ Notes
+   The payload references are taken before the region, and the profiler
+   and trace are updated after it, to keep interrupts off for as short a
+   time as possible.
+****************************************************************************/
+static bool PostToMask( ES_BitFlags_t Targets, ES_Event ThisEvent ){
+  ES_BitFlags_t Remaining;
+  ES_BitFlags_t Delivered = 0;
+  ES_BitFlags_t Alerts = 0;
+  uint8_t i;
+#ifdef ES_USE_WAIT_STATS
+  ES_Time_t Now = ES_Timer_GetTime();
+#endif
+
+  STAMP_POST(ThisEvent);
+#ifdef ES_USE_EVENT_POOL
+  // one reference for each queue, the ones not used are given back below
+  for ( Remaining = Targets; Remaining != 0; 
+                                        Remaining &= BitNum2ClrMask[i] ){
+    i = ES_GetMSBitSet(Remaining);
+    HOLD_PAYLOAD(ThisEvent);
+  }
+#endif
+  EnterCritical();
+  for ( Remaining = Targets; Remaining != 0; 
+                                        Remaining &= BitNum2ClrMask[i] ){
+    i = ES_GetMSBitSet(Remaining);
+    if ( ES_EnQueueFIFOInCritical( EventQueues[i].pMem, ThisEvent ) ){
+      Delivered |= BitNum2SetMask[i];
+#ifdef ES_USE_WAIT_STATS
+      if ( (Ready & BitNum2SetMask[i]) == 0 )
+        ReadySince[i] = Now;
+#endif
+    }
+    if ( LogQueueInCritical( i, false, 
+                             (Delivered & BitNum2SetMask[i]) == 0 ) )
+      Alerts |= BitNum2SetMask[i];
+  }
+  Ready |= Delivered; // show the queues as non-empty
+  ExitCritical();
+
+  for ( Remaining = Alerts; Remaining != 0; 
+                                        Remaining &= BitNum2ClrMask[i] ){
+    i = ES_GetMSBitSet(Remaining);
+    if ( QueueAlert[i] != NULL )
+      QueueAlert[i]( i, true );
+  }
+
+#ifdef ES_PER_SERVICE_POST_WORK
+  for ( Remaining = Targets; Remaining != 0; 
+                                        Remaining &= BitNum2ClrMask[i] ){
+    i = ES_GetMSBitSet(Remaining);
+    if ( (Delivered & BitNum2SetMask[i]) != 0 ){
+      LOG_POST(i, true);
+      ES_TRACE(ES_TRACE_POST, i, ThisEvent);
+    }else{
+      DROP_PAYLOAD(ThisEvent);
+      LOG_POST(i, false);
+      ES_TRACE(ES_TRACE_POST_FAIL, i, ThisEvent);
+    }
+  }
+#endif
+  if ( Delivered != 0 )
+    PREEMPT();
+  return (Delivered == Targets);
+}
+
+/****************************************************************************
+ Function
+   PostOne
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted, already stamped if profiling
+ Returns
+   boolean : False if the post function failed during execution
+ Description
+   the body of ES_PostToService and ES_PostFromChannel, posts using the
+   policy for the service's queue from QUEUE_POLICY_LIST
+ Notes
+   ES_QUEUE_COALESCE only applies to the types in ES_EVENT_IS_LATEST, other
+   events are rejected when the queue is full
+****************************************************************************/
+static bool PostOne( uint8_t WhichService, ES_Event TheEvent ){
+  ES_QueuePolicy_t Policy = ES_QUEUE_REJECT;
+
+  if ( WhichService < ARRAY_SIZE(QueuePolicy) ){
+    Policy = QueuePolicy[WhichService];
+    if ( (Policy == ES_QUEUE_COALESCE) &&
+         !ES_EVENT_IS_LATEST(TheEvent.EventType) )
+      Policy = ES_QUEUE_REJECT;
+  }
+  return PostWithPolicy( WhichService, TheEvent, Policy );
+}
+
+/****************************************************************************
+ Function
+   PostWithPolicy
+ Parameters
+   uint8_t : Which service to post to (index into ServDescList)
+   ES_Event : The Event to be posted, already stamped if profiling
+   ES_QueuePolicy_t : what to do if the queue is full
+ Returns
+   boolean : False if the event could not be posted
+ Description
+   posts to one of the services' queues with ES_EnQueuePolicy, and counts
+   the events that were lost or coalesced to make room for it
+ Notes
+   an event that took the place of another found the queue already ready,
+   so it can not cause a preemption
+****************************************************************************/
+static bool PostWithPolicy( uint8_t WhichService, ES_Event TheEvent,
+                            ES_QueuePolicy_t Policy ){
+  ES_Event Lost;
+
+  if ((WhichService < ARRAY_SIZE(EventQueues)) &&
+      (ES_EnQueuePolicy( EventQueues[WhichService].pMem, TheEvent, Policy,
+                                                      &Lost ) == true )){
+    HOLD_PAYLOAD(TheEvent);
+    LOG_POST(WhichService, true);
+    if ( Lost.EventType != ES_NO_EVENT ){
+      DROP_PAYLOAD(Lost);
+      if ( Policy == ES_QUEUE_COALESCE ){
+        LogQueue( WhichService, true, false );
+        ES_TRACE(ES_TRACE_COALESCE, WhichService, TheEvent);
+      }else{
+        LogQueue( WhichService, false, true );
+        ES_TRACE(ES_TRACE_POST, WhichService, TheEvent);
+      }
+      return true;
+    }
+    MarkReady(WhichService); // show queue as non-empty
+    LogQueue( WhichService, false, false );
+    ES_TRACE(ES_TRACE_POST, WhichService, TheEvent);
+    PREEMPT();
+    return true;
+  } else {
+    LOG_POST(WhichService, false);
+    if ( WhichService < ARRAY_SIZE(EventQueues) )
+      LogQueue( WhichService, false, true );
+    ES_TRACE(ES_TRACE_POST_FAIL, WhichService, TheEvent);
+    return false;
+  }
+}
+
+/****************************************************************************
+ Function
+   BatchIsPlain
+ Parameters
+   uint8_t : Which service the events are for, in range
+   const ES_Event * : the events to be posted
+   ES_QueueIndex_t : how many events there are
+ Returns
+   boolean : True if queuing the events as a block, when they all fit, gives
+             the same result as posting them one at a time
+ Description
+   the other policies only differ from ES_QUEUE_REJECT when the queue is
+   full, which ES_EnQueueBatch checks for. ES_QUEUE_COALESCE also replaces
+   a waiting event of a type in ES_EVENT_IS_LATEST, so its queue must be
+   empty and the batch must not hold two events of such a type
+ Notes
+   an interrupt response may post between the test and the enqueue. The
+   worst that can do is leave two events of a latest type queued, which is
+   what a queue without ES_QUEUE_COALESCE would hold anyway
+****************************************************************************/
+static bool BatchIsPlain( uint8_t WhichService, const ES_Event *pEvents,
+                          ES_QueueIndex_t NumEvents ){
+  ES_QueueIndex_t i;
+  ES_QueueIndex_t j;
+
+  if ( QueuePolicy[WhichService] != ES_QUEUE_COALESCE )
+    return true;
+  if ( !ES_IsQueueEmpty( EventQueues[WhichService].pMem ) )
+    return false;
+  for ( i = 1; i < NumEvents; i++ ){
+    if ( ES_EVENT_IS_LATEST(pEvents[i].EventType) ){
+      for ( j = 0; j < i; j++ ){
+        if ( pEvents[j].EventType == pEvents[i].EventType )
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+/****************************************************************************
+ Function
+   LogQueue
+ Parameters
+   uint8_t : Which service was posted to
+   bool : true if an event was coalesced with a newer one
+   bool : true if an event was lost
+ Returns
+   None
+ Description
+   updates the overflow counters for the service's queue after a post, and
+   calls its alert function if the post left it congested
+ Notes
+   for use outside of critical regions, see LogQueueInCritical
+****************************************************************************/
+static void LogQueue( uint8_t WhichService, bool Coalesced, bool Dropped ){
+  bool Alert;
+
+  EnterCritical();
+  Alert = LogQueueInCritical( WhichService, Coalesced, Dropped );
+  ExitCritical();
+  if ( Alert && (QueueAlert[WhichService] != NULL) )
+    QueueAlert[WhichService]( WhichService, true );
+}
+
+/****************************************************************************
+ Function
+   LogQueueInCritical
+ Parameters
+   uint8_t : Which service was posted to
+   bool : true if an event was coalesced with a newer one
+   bool : true if an event was lost
+ Returns
+   bool : true if the queue has just become congested, and the caller must
+          call its alert function once interrupts are back on
+ Description
+   the body of LogQueue, for use inside a critical region. A queue becomes
+   congested when a post loses an event to it or leaves it full, and stays
+   that way until the service empties it (see EaseQueue)
+ Notes
+
+****************************************************************************/
+static bool LogQueueInCritical( uint8_t WhichService, bool Coalesced,
+                                bool Dropped ){
+  ES_QueueStats_t *pStats = &QueueStats[WhichService];
+  ES_QueueIndex_t Depth;
+
+  Depth = ES_QueueDepth( EventQueues[WhichService].pMem );
+  if ( Depth > pStats->PeakDepth )
+    pStats->PeakDepth = Depth;
+  if ( Coalesced )
+    pStats->NumCoalesced++;
+  if ( Dropped )
+    pStats->NumDropped++;
+  if ( (Dropped || (Depth >= pStats->Capacity)) &&
+       ((Congested & BitNum2SetMask[WhichService]) == 0) ){
+    Congested |= BitNum2SetMask[WhichService];
+    return true;
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+   EaseQueue
+ Parameters
+   uint8_t : Which service has just run
+ Returns
+   None
+ Description
+   if the service's queue was congested and is now empty, clears the state
+   and calls its alert function to let the producer speed up again
+ Notes
+
+****************************************************************************/
+static void EaseQueue( uint8_t WhichService ){
+  bool Eased = false;
+
+  EnterCritical();
+  if ( ES_IsQueueEmpty( EventQueues[WhichService].pMem ) ){
+    Congested &= BitNum2ClrMask[WhichService];
+    Eased = true;
+  }
+  ExitCritical();
+  if ( Eased && (QueueAlert[WhichService] != NULL) )
+    QueueAlert[WhichService]( WhichService, false );
+}
+
+#ifdef ES_USE_PREEMPTION
+/****************************************************************************
+ Function
+   Schedule
+ Parameters
+   None
+ Returns
+   None
+ Description
+   the preemptive kernel's dispatcher. Runs events, one at a time and
+   highest priority first, for as long as there is a ready service of higher
+   priority than the one that was running when it was called
+ Notes
+   everything runs on the one stack: a preempting service runs to completion
+   inside the call to Schedule made by the post that readied it. Ready and
+   RunningLevel are shared with every level above this one, so they are only
+   changed inside critical regions
+****************************************************************************/
+static void Schedule( void ){
+  uint8_t Prio;
+  uint8_t SavedLevel;
+  ES_Event ThisEvent;
+
+  for(;;){
+    EnterCritical();
+    if ( (Ready == 0) || (SchedLockCount != 0) ||
+         (ES_GetMSBitSet(Ready) < RunningLevel) ){
+      ExitCritical();
+      return;
+    }
+    Prio = ES_GetMSBitSet(Ready);
+    SavedLevel = RunningLevel;
+    RunningLevel = Prio + 1;
+    ExitCritical();
+
+    ES_DeQueue( EventQueues[Prio].pMem, &ThisEvent );
+    // a post from a preempting service between the DeQueue and here leaves
+    // the queue non-empty, so its Ready bit must stay
+    EnterCritical();
+    if ( ES_IsQueueEmpty( EventQueues[Prio].pMem ) )
+      Ready &= BitNum2ClrMask[Prio];
+    ExitCritical();
+
+    ES_TRACE(ES_TRACE_DISPATCH, Prio, ThisEvent);
+    if ( RunService(Prio, ThisEvent).EventType != ES_NO_EVENT )
+      RunFailed = true;
+    RunningLevel = SavedLevel;
+  }
+}
+#endif
+
+/****************************************************************************
+ Function
+   RunService
+ Parameters
+   uint8_t : Which service to run
+   ES_Event : the event to pass to its run function
+ Returns
+   ES_Event : whatever the run function returned
+ Description
+   calls the run function for the service and, when profiling, times the
+   call and the time that the event spent waiting in the queue
+ Notes
+   the reference that the queued event held on its payload, if it has one,
+   is dropped here once the run function returns. With the preemptive
+   kernel the cycles include those of any services that preempted this one
+
+****************************************************************************/
+static ES_Event RunService( uint8_t WhichService, ES_Event ThisEvent ){
+#ifndef ES_USE_PROFILER
+  ES_Event ReturnEvent;
+
+  ReturnEvent = ServDescList[WhichService].RunFunc(ThisEvent);
+  DROP_PAYLOAD(ThisEvent);
+  if ( (Congested & BitNum2SetMask[WhichService]) != 0 )
+    EaseQueue( WhichService );
+  return ReturnEvent;
+#else
+  ES_ServiceProfile_t *pProfile = &Profile[WhichService];
+  ES_Event ReturnEvent;
+  uint32_t StartTime;
+  uint32_t Elapsed;
+
+  StartTime = _HW_GetCycleCount();
+  Elapsed = StartTime - ThisEvent.PostTime;
+  pProfile->TotalLatency += Elapsed;
+  if ( Elapsed > pProfile->MaxLatency )
+    pProfile->MaxLatency = Elapsed;
+
+  ReturnEvent = ServDescList[WhichService].RunFunc(ThisEvent);
+
+  Elapsed = _HW_GetCycleCount() - StartTime;
+  DROP_PAYLOAD(ThisEvent);
+  pProfile->NumDispatched++;
+  pProfile->TotalCycles += Elapsed;
+  if ( Elapsed > pProfile->MaxCycles )
+    pProfile->MaxCycles = Elapsed;
+  if ( (Congested & BitNum2SetMask[WhichService]) != 0 )
+    EaseQueue( WhichService );
+  return ReturnEvent;
+#endif
+}
+
+#ifdef ES_USE_PROFILER
+/****************************************************************************
+ Function
+   LogPost
+ Parameters
+   uint8_t : Which service was posted to
+   bool : true if the post succeeded
+ Returns
+   None
+ Description
+   counts failed posts and tracks the queue high-water mark
+ Notes
+   WhichService may be out of range if the post was rejected for that reason
+****************************************************************************/
+static void LogPost( uint8_t WhichService, bool Posted ){
+  ES_QueueIndex_t Depth;
+
+  if ( WhichService >= ARRAY_SIZE(Profile) )
+    return;
+  if ( Posted ){
+    Depth = ES_QueueDepth( EventQueues[WhichService].pMem );
+    if ( Depth > Profile[WhichService].QueueHighWater )
+      Profile[WhichService].QueueHighWater = Depth;
+  }else{
+    Profile[WhichService].NumFailedPosts++;
+  }
+}
+#endif
+
+#ifdef ES_USE_BATCH_DISPATCH
+/****************************************************************************
+ Function
+   PickService
+ Parameters
+   ES_Time_t : the current time
+   bool * : set to true if the pick was forced by the starvation guard
+ Returns
+   uint8_t : the priority of the service to run next
+ Description
+   normally the highest priority ready service. If any lower priority ready
+   service has waited ES_STARVATION_TICKS or longer, the one that has waited
+   longest is picked instead.
+ Notes
+   Ready must be non-zero
+****************************************************************************/
+static uint8_t PickService( ES_Time_t Now, bool *pForced ){
+  uint8_t Highest = ES_GetMSBitSet(Ready);
+  uint8_t Pick = Highest;
+  ES_Time_t LongestWait = ES_STARVATION_TICKS - 1;
+  ES_Time_t Wait;
+  uint8_t i;
+
+  for ( i=0; i < Highest; i++) {
+    if ( (Ready & BitNum2SetMask[i]) != 0 ){
+      Wait = Now - ReadySince[i];
+      if ( Wait > LongestWait ){
+        LongestWait = Wait;
+        Pick = i;
+      }
+    }
+  }
+  *pForced = (Pick != Highest);
+  return Pick;
+}
+#endif
+
+#ifdef ES_USE_WAIT_STATS
+/****************************************************************************
+ Function
+   LogWait
+ Parameters
+   ES_WaitStats_t * : the stats to update
+   ES_Time_t : how long the wait was
+   bool : true if the starvation guard forced this dispatch
+ Returns
+   None
+ Description
+   folds one wait into the running statistics
+ Notes
+
+****************************************************************************/
+static void LogWait( ES_WaitStats_t *pStats, ES_Time_t Wait, bool Forced ){
+  if ( Wait > pStats->MaxWait )
+    pStats->MaxWait = Wait;
+  pStats->TotalWait += Wait;
+  pStats->NumBatches++;
+  if ( Forced )
+    pStats->NumForced++;
+}
+#endif
+
 #if 0
 /****************************************************************************
  Function
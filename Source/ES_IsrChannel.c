@@ -0,0 +1,192 @@
+/****************************************************************************
+ Module
+     ES_IsrChannel.c
+
+ Description
+     This is a module implementing lock-free single producer, single consumer
+     channels that let interrupt responses post events without turning
+     interrupts off.
+
+ Notes
+     ES_PostToService goes through ES_EnQueueFIFO, which holds off every
+     other interrupt while it writes the queue, and with ES_USE_BASEPRI can
+     not be called at all from an interrupt above ES_CRITICAL_PRIORITY.
+     Instead, each interrupt source gets its own channel from ISR_CHANNEL_LIST
+     in ES_Configure.h. The interrupt response is the only writer of its
+     channel and _HW_Process_Pending_Ints, through ES_ChannelDrain, is the
+     only reader, so each index has a single writer and no locking is
+     needed. Head and Tail run freely and wrap at 256; the difference between
+     them is the number of entries waiting, which is why the channel sizes
+     must be powers of 2 no larger than 128.
+     A channel must never be written from anywhere other than its one
+     interrupt response.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_Framework.h"
+#include "ES_IsrChannel.h"
+
+#ifdef ES_USE_ISR_CHANNELS
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct {
+  uint8_t WhichService;   // the service to post to
+  ES_Event Event;
+} ChannelEntry_t;
+
+typedef struct {
+  ChannelEntry_t *pEntries;
+  uint8_t Mask;           // size - 1, to wrap the indices
+} ChannelDesc_t;
+
+typedef struct {
+  volatile uint8_t Head;  // next entry to write, only the producer changes it
+  volatile uint8_t Tail;  // next entry to read, only the consumer changes it
+  uint16_t NumOverruns;   // posts lost to a full channel, producer only
+} ChannelState_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+// the entries for each channel, generated from ISR_CHANNEL_LIST. A negative
+// array size stops the build if a channel size is not a power of 2 <= 128
+#define ES_CHANNEL_ENTRIES(_name_, _size_)                                  \
+  static ChannelEntry_t _name_##Entries[_size_];                            \
+  typedef char _name_##SizeCheck_t[                                         \
+    (((_size_) & ((_size_) - 1)) == 0 && (_size_) <= 128) ? 1 : -1];
+
+ISR_CHANNEL_LIST(ES_CHANNEL_ENTRIES)
+
+#define ES_CHANNEL_DESC(_name_, _size_) { _name_##Entries, (_size_) - 1 },
+
+static ChannelDesc_t const ChannelDescs[ES_NUM_CHANNELS] = {
+  ISR_CHANNEL_LIST(ES_CHANNEL_DESC)
+};
+
+static ChannelState_t Channels[ES_NUM_CHANNELS];
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_ChannelPost
+ Parameters
+     ES_ChannelId_t : the channel to write, ES_CHANNEL_<name>
+     uint8_t : the service that the event is for
+     ES_Event : the event to post
+ Returns
+     bool : false if the channel was full and the event was lost
+ Description
+     puts the event in the channel, to be posted to the service the next
+     time that _HW_Process_Pending_Ints runs
+ Notes
+     only to be called from the one interrupt response that owns the channel
+****************************************************************************/
+bool ES_ChannelPost( ES_ChannelId_t WhichChannel, uint8_t WhichService,
+                     ES_Event ThisEvent )
+{
+  ChannelState_t *pState = &Channels[WhichChannel];
+  ChannelDesc_t const *pDesc = &ChannelDescs[WhichChannel];
+  ChannelEntry_t *pEntry;
+  uint8_t Head = pState->Head;
+
+  if ( (uint8_t)(Head - pState->Tail) > pDesc->Mask ){
+    pState->NumOverruns++;
+    return false;
+  }
+  pEntry = &pDesc->pEntries[Head & pDesc->Mask];
+  pEntry->WhichService = WhichService;
+  pEntry->Event = ThisEvent;
+#ifdef ES_USE_PROFILER
+  pEntry->Event.PostTime = _HW_GetCycleCount(); // latency starts here
+#endif
+  ES_MEMORY_BARRIER(); // the entry must be complete before it is published
+  pState->Head = Head + 1;
+#ifdef ES_USE_PREEMPTION
+  ES_Preempt(); // have the port drain the channel as soon as it can
+#endif
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_ChannelDrain
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     posts everything waiting in the channels to the services' queues, in
+     the order that it was written to each channel
+ Notes
+     called from _HW_Process_Pending_Ints, which is the only consumer
+****************************************************************************/
+void ES_ChannelDrain( void )
+{
+  uint8_t i;
+  uint8_t Tail;
+  ChannelEntry_t Entry;
+
+  for ( i = 0; i < ES_NUM_CHANNELS; i++ ){
+    Tail = Channels[i].Tail;
+    while ( Tail != Channels[i].Head ){
+      ES_MEMORY_BARRIER(); // read the entry only after seeing the new Head
+      Entry = ChannelDescs[i].pEntries[Tail & ChannelDescs[i].Mask];
+      ES_MEMORY_BARRIER(); // and finish reading it before freeing its slot
+      Channels[i].Tail = ++Tail;
+      ES_PostFromChannel( Entry.WhichService, Entry.Event );
+    }
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_ChannelsPending
+ Parameters
+     None.
+ Returns
+     true if any of the channels hold events still to be drained
+ Description
+     see above
+ Notes
+     used by the tickless idle to check, with interrupts off, that no
+     interrupt response has left work since the last drain
+****************************************************************************/
+bool ES_ChannelsPending( void )
+{
+  uint8_t i;
+
+  for ( i = 0; i < ES_NUM_CHANNELS; i++ ){
+    if ( Channels[i].Tail != Channels[i].Head )
+      return true;
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+     ES_ChannelOverruns
+ Parameters
+     ES_ChannelId_t : the channel to report on
+ Returns
+     uint16_t : the number of events lost because the channel was full
+ Description
+     see above
+ Notes
+
+****************************************************************************/
+uint16_t ES_ChannelOverruns( ES_ChannelId_t WhichChannel )
+{
+  return Channels[WhichChannel].NumOverruns;
+}
+
+#endif /* ES_USE_ISR_CHANNELS */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
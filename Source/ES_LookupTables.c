@@ -33,12 +33,26 @@
 #include "ES_Types.h"
 #include "ES_General.h"
 #include "ES_Timers.h"
-#include "bitdefs.h"
+#include "ES_LookupTables.h"
+#include "BITDEFS.H"
 
 /*----------------------------- Module Defines ----------------------------*/
 #define ISOLATE_LS_NYBBLE 0x0F
+#define NO_BIT_SET 128
+// the set masks above bit 31 are beyond the reach of the BITxHI constants
+#define UPPER_BIT_HI(_bit_) ((ES_BitFlags_t)1 << (_bit_))
+
+#if defined(ES_USE_CLZ_DISPATCH) && !defined(ES_CLZ32)
+#error "ES_USE_CLZ_DISPATCH needs an ES_CLZ32 definition for this compiler"
+#endif
 
 /*---------------------------- Module Functions ---------------------------*/
+#if !defined(ES_USE_CLZ_DISPATCH) || defined(TEST)
+static uint8_t NybbleMSBitSet( ES_BitFlags_t Val2Check);
+#endif
+#if defined(ES_USE_CLZ_DISPATCH) || defined(TEST)
+static uint8_t ClzMSBitSet( ES_BitFlags_t Val2Check);
+#endif
 
 /*---------------------------- Module Variables ---------------------------*/
 
@@ -56,12 +70,26 @@ uint16_t const BitNum2ClrMask[] = {
 */
 
 /*
-  this table is used to go from a bit number (0-15) to the mask used to set
-  that bit in a byte.
+  this table is used to go from a bit number (0 to ES_FLAG_BITS-1) to the mask
+  used to set that bit in a flag word.
 */
-uint16_t const BitNum2SetMask[] = {
+ES_BitFlags_t const BitNum2SetMask[ES_FLAG_BITS] = {
   BIT0HI, BIT1HI, BIT2HI, BIT3HI, BIT4HI, BIT5HI, BIT6HI, BIT7HI, BIT8HI, BIT9HI,
   BIT10HI, BIT11HI, BIT12HI, BIT13HI, BIT14HI, BIT15HI
+#if ES_FLAG_BITS > 16
+  ,BIT16HI, BIT17HI, BIT18HI, BIT19HI, BIT20HI, BIT21HI, BIT22HI, BIT23HI,
+  BIT24HI, BIT25HI, BIT26HI, BIT27HI, BIT28HI, BIT29HI, BIT30HI, BIT31HI
+#endif
+#if ES_FLAG_BITS > 32
+  ,UPPER_BIT_HI(32), UPPER_BIT_HI(33), UPPER_BIT_HI(34), UPPER_BIT_HI(35),
+  UPPER_BIT_HI(36), UPPER_BIT_HI(37), UPPER_BIT_HI(38), UPPER_BIT_HI(39),
+  UPPER_BIT_HI(40), UPPER_BIT_HI(41), UPPER_BIT_HI(42), UPPER_BIT_HI(43),
+  UPPER_BIT_HI(44), UPPER_BIT_HI(45), UPPER_BIT_HI(46), UPPER_BIT_HI(47),
+  UPPER_BIT_HI(48), UPPER_BIT_HI(49), UPPER_BIT_HI(50), UPPER_BIT_HI(51),
+  UPPER_BIT_HI(52), UPPER_BIT_HI(53), UPPER_BIT_HI(54), UPPER_BIT_HI(55),
+  UPPER_BIT_HI(56), UPPER_BIT_HI(57), UPPER_BIT_HI(58), UPPER_BIT_HI(59),
+  UPPER_BIT_HI(60), UPPER_BIT_HI(61), UPPER_BIT_HI(62), UPPER_BIT_HI(63)
+#endif
 };
 
 /*
@@ -76,11 +104,38 @@ uint8_t const Nybble2MSBitNum[15] = {
 };
 
 /*------------------------------ Module Code ------------------------------*/
-uint8_t ES_GetMSBitSet( uint16_t Val2Check) {
+uint8_t ES_GetMSBitSet( ES_BitFlags_t Val2Check) {
+#ifdef ES_USE_CLZ_DISPATCH
+  return ClzMSBitSet( Val2Check);
+#else
+  return NybbleMSBitSet( Val2Check);
+#endif
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+#if !defined(ES_USE_CLZ_DISPATCH) || defined(TEST)
+/****************************************************************************
+ Function
+   NybbleMSBitSet
+ Parameters
+   ES_BitFlags_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   walks Val2Check from the top, a nybble at a time, and uses Nybble2MSBitNum
+   to find the MSB in the first non-zero nybble
+ Notes
+   the cost grows with the width of ES_BitFlags_t and with how low the MSB is
+ Author
+   J. Edward Carryer, 10/20/13, 17:03
+****************************************************************************/
+static uint8_t NybbleMSBitSet( ES_BitFlags_t Val2Check) {
 
   int8_t LoopCntr;
   uint8_t Nybble2Test; 
-  uint8_t ReturnVal = 128; // this is the error return value
+  uint8_t ReturnVal = NO_BIT_SET; // this is the error return value
 
   // loop through the parameter, nybble by nybble
   for( LoopCntr = sizeof(Val2Check) * (BITS_PER_BYTE/BITS_PER_NYBBLE)-1;
@@ -98,28 +153,123 @@ uint8_t ES_GetMSBitSet( uint16_t Val2Check) {
   }
   return ReturnVal;  
 }
+#endif
+
+#if defined(ES_USE_CLZ_DISPATCH) || defined(TEST)
+/****************************************************************************
+ Function
+   ClzMSBitSet
+ Parameters
+   ES_BitFlags_t  Val2Check The number to find the MSB in
+ Returns
+   bit number of the MSB that is set in Val2Check, 128 if Val2Check = 0
+ Description
+   uses the count-leading-zeros instruction to find the MSB in constant time
+ Notes
+   a 64 bit flag word takes a second CLZ on the upper half on a 32 bit core
+****************************************************************************/
+static uint8_t ClzMSBitSet( ES_BitFlags_t Val2Check) {
+  if ( Val2Check == 0 ){
+    return NO_BIT_SET;
+  }
+#if ES_FLAG_BITS > 32
+  if ( (uint32_t)(Val2Check >> 32) != 0 ){
+    return (uint8_t)(63 - ES_CLZ32( (uint32_t)(Val2Check >> 32)));
+  }
+#endif
+  return (uint8_t)(31 - ES_CLZ32( (uint32_t)Val2Check));
+}
+#endif
 
-/***************************************************************************
- private functions
- ***************************************************************************/
 #ifdef TEST
 #include <stdio.h>
+#include <time.h>
 
-void main(void) {
+#define BENCH_PASSES 200
+#define BENCH_VALUES 1024
 
-  uint16_t Counter=0;
-  uint8_t MSBit;
+// timing sink, keeps the optimizer from throwing the searches away
+static volatile uint8_t MSBitSink;
 
-  puts("Testing the MSB Look-up function\n\r");
+int main(void) {
+
+  static ES_BitFlags_t TestVals[BENCH_VALUES];
+  uint32_t Counter;
+  uint32_t Seed = 1;
+  uint8_t Bit;
+  uint8_t Expected;
+  uint16_t Pass;
+  uint16_t Errors = 0;
+  clock_t Start;
+  double NybbleTime, ClzTime;
+
+  puts("Testing the MSB Look-up functions\n\r");
   puts(__TIME__ " " __DATE__);
   puts("\n\r");
-  MSBit = ES_GetMSBitSet( Counter);
-  printf("the MSB set in %u is bit %d\n\r",Counter,MSBit);
 
-  for (Counter = 1; Counter !=0; Counter++){
-    MSBit = ES_GetMSBitSet( Counter);
-    printf("the MSB set in %u is bit %d\n\r",Counter,MSBit);
+  // check both searches against a brute force bit walk, first with every
+  // single bit set on its own, then with a spread of random words
+  for (Bit = 0; Bit < ES_FLAG_BITS; Bit++){
+    if ( (NybbleMSBitSet(BitNum2SetMask[Bit]) != Bit) ||
+         (ClzMSBitSet(BitNum2SetMask[Bit]) != Bit) ){
+      printf("single bit %u failed\n\r", Bit);
+      Errors++;
+    }
   }
+  if ( (NybbleMSBitSet(0) != NO_BIT_SET) || (ClzMSBitSet(0) != NO_BIT_SET) ){
+    puts("zero value failed\n\r");
+    Errors++;
+  }
+  for (Counter = 0; Counter < BENCH_VALUES; Counter++){
+    // simple LCG so that the run is repeatable
+    Seed = Seed * 1103515245UL + 12345UL;
+    TestVals[Counter] = (ES_BitFlags_t)Seed;
+#if ES_FLAG_BITS > 32
+    Seed = Seed * 1103515245UL + 12345UL;
+    TestVals[Counter] |= ((ES_BitFlags_t)Seed) << 32;
+#endif
+    // mimic a sparse Ready word: keep between 1 and 3 bits
+    TestVals[Counter] &= BitNum2SetMask[Seed % ES_FLAG_BITS] |
+                         BitNum2SetMask[(Seed >> 8) % ES_FLAG_BITS] |
+                         BitNum2SetMask[(Seed >> 16) % ES_FLAG_BITS];
+    if (TestVals[Counter] == 0){
+      TestVals[Counter] = BitNum2SetMask[Seed % ES_FLAG_BITS];
+    }
+    for (Expected = ES_FLAG_BITS-1;
+         (TestVals[Counter] & BitNum2SetMask[Expected]) == 0; Expected--)
+      ;
+    if ( (NybbleMSBitSet(TestVals[Counter]) != Expected) ||
+         (ClzMSBitSet(TestVals[Counter]) != Expected) ){
+      printf("value %lu failed\n\r", (unsigned long)Counter);
+      Errors++;
+    }
+  }
+  printf("%u errors\n\r", Errors);
+
+  // now time the two approaches on the same set of words
+  Start = clock();
+  for (Pass = 0; Pass < BENCH_PASSES; Pass++){
+    for (Counter = 0; Counter < BENCH_VALUES; Counter++){
+      MSBitSink = NybbleMSBitSet(TestVals[Counter]);
+    }
+  }
+  NybbleTime = (double)(clock() - Start) / CLOCKS_PER_SEC;
+
+  Start = clock();
+  for (Pass = 0; Pass < BENCH_PASSES; Pass++){
+    for (Counter = 0; Counter < BENCH_VALUES; Counter++){
+      MSBitSink = ClzMSBitSet(TestVals[Counter]);
+    }
+  }
+  ClzTime = (double)(clock() - Start) / CLOCKS_PER_SEC;
+
+  printf("%u bit flags, %u searches each\n\r", ES_FLAG_BITS,
+         BENCH_PASSES * BENCH_VALUES);
+  printf("nybble table: %.2f ns/search\n\r",
+         NybbleTime * 1e9 / (BENCH_PASSES * BENCH_VALUES));
+  printf("clz:          %.2f ns/search\n\r",
+         ClzTime * 1e9 / (BENCH_PASSES * BENCH_VALUES));
+  return (Errors == 0) ? 0 : 1;
 }
 #endif
 /*------------------------------ End of File ------------------------------*/
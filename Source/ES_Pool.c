@@ -0,0 +1,190 @@
+/****************************************************************************
+ Module
+     ES_Pool.c
+
+ Description
+     This is a module implementing a static pool of fixed size, reference
+     counted blocks for event payloads, so that data too big for EventParam
+     can be passed between services without copying it.
+
+ Notes
+     A publisher takes a block with ES_PoolAlloc, which holds one reference
+     for the publisher, fills it in, sets it as the pPayload of an event
+     whose type satisfies ES_EVENT_HAS_PAYLOAD and posts the event as many
+     times as it likes. Each successful post (or deferral) adds a reference
+     and each dispatch drops one after the run function returns, so the
+     publisher only has to ES_PoolRelease its own reference once it is done
+     posting. The block goes back to the pool when the last reference goes.
+     Consumers must not keep the pointer after their run function returns,
+     unless they take a reference of their own with ES_PoolAddRef.
+     The free blocks are kept as bits in an ES_BitFlags_t, so finding one
+     takes the same ES_GetMSBitSet that ES_Run uses to find a ready service.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_LookupTables.h"
+#include "ES_Pool.h"
+
+#ifdef ES_USE_EVENT_POOL
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+#if ES_POOL_NUM_BLOCKS > ES_FLAG_BITS
+#error "ES_POOL_NUM_BLOCKS can be no larger than the bits in ES_BitFlags_t"
+#endif
+
+// blocks are whole words, so any payload struct is suitably aligned
+#define BLOCK_WORDS ((ES_POOL_BLOCK_SIZE + sizeof(uint32_t) - 1) / \
+                     sizeof(uint32_t))
+
+/*------------------------------ Module Types -----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+static int8_t BlockNum( void *pBlock );
+
+/*---------------------------- Module Variables ---------------------------*/
+static uint32_t PoolMem[ES_POOL_NUM_BLOCKS][BLOCK_WORDS];
+static uint8_t RefCount[ES_POOL_NUM_BLOCKS];
+static ES_BitFlags_t FreeBlocks =
+  (ES_POOL_NUM_BLOCKS == ES_FLAG_BITS) ? (ES_BitFlags_t)~0 :
+  (((ES_BitFlags_t)1 << ES_POOL_NUM_BLOCKS) - 1);
+static uint8_t NumFree = ES_POOL_NUM_BLOCKS;
+static uint8_t MinFree = ES_POOL_NUM_BLOCKS;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_PoolAlloc
+ Parameters
+     None.
+ Returns
+     void *, a block of ES_POOL_BLOCK_SIZE bytes, or NULL if there are none
+ Description
+     takes a free block from the pool, holding one reference for the caller
+ Notes
+     may be called from interrupt responses
+****************************************************************************/
+void *ES_PoolAlloc( void )
+{
+  uint8_t Which;
+
+  EnterCritical();
+  if ( FreeBlocks == 0 ){
+    ExitCritical();
+    return NULL;
+  }
+  Which = ES_GetMSBitSet( FreeBlocks );
+  FreeBlocks &= BitNum2ClrMask[Which];
+  RefCount[Which] = 1;
+  if ( --NumFree < MinFree )
+    MinFree = NumFree;
+  ExitCritical();
+  return PoolMem[Which];
+}
+
+/****************************************************************************
+ Function
+     ES_PoolAddRef
+ Parameters
+     void *pBlock, a block from ES_PoolAlloc
+ Returns
+     None.
+ Description
+     adds a reference to the block, so that it stays allocated until a
+     matching ES_PoolRelease
+ Notes
+     NULL and pointers that are not pool blocks are ignored
+****************************************************************************/
+void ES_PoolAddRef( void *pBlock )
+{
+  int8_t Which = BlockNum( pBlock );
+
+  if ( Which < 0 )
+    return;
+  EnterCritical();
+  if ( RefCount[Which] != 0 )
+    RefCount[Which]++;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_PoolRelease
+ Parameters
+     void *pBlock, a block from ES_PoolAlloc
+ Returns
+     None.
+ Description
+     drops a reference to the block, returning it to the pool when the last
+     reference goes
+ Notes
+     NULL and pointers that are not pool blocks are ignored
+****************************************************************************/
+void ES_PoolRelease( void *pBlock )
+{
+  int8_t Which = BlockNum( pBlock );
+
+  if ( Which < 0 )
+    return;
+  EnterCritical();
+  if ( (RefCount[Which] != 0) && (--RefCount[Which] == 0) ){
+    FreeBlocks |= BitNum2SetMask[Which];
+    NumFree++;
+  }
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_PoolNumFree
+ Parameters
+     None.
+ Returns
+     uint8_t, the number of blocks free now
+****************************************************************************/
+uint8_t ES_PoolNumFree( void )
+{
+  return NumFree;
+}
+
+/****************************************************************************
+ Function
+     ES_PoolMinFree
+ Parameters
+     None.
+ Returns
+     uint8_t, the fewest blocks that have been free at once, for sizing
+     ES_POOL_NUM_BLOCKS
+****************************************************************************/
+uint8_t ES_PoolMinFree( void )
+{
+  return MinFree;
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+// maps a block pointer back to its number, -1 if it is not a pool block
+static int8_t BlockNum( void *pBlock )
+{
+  uint32_t Offset;
+
+  if ( ((uint32_t *)pBlock < PoolMem[0]) ||
+       ((uint32_t *)pBlock >= PoolMem[ES_POOL_NUM_BLOCKS]) )
+    return -1;
+  Offset = (uint32_t *)pBlock - PoolMem[0];
+  if ( (Offset % BLOCK_WORDS) != 0 )
+    return -1;
+  return (int8_t)(Offset / BLOCK_WORDS);
+}
+
+#endif /* ES_USE_EVENT_POOL */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
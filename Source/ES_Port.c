@@ -24,6 +24,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_nvic.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/uart.h"
@@ -34,12 +37,40 @@
 #include "ES_Port.h"
 #include "ES_Types.h"
 #include "ES_Timers.h"
+#include "ES_ShortTimer.h"
+#include "ES_IsrChannel.h"
+#include "ES_Framework.h"
 
 #define UART_PORT 		0
 #define UART_BAUD		115200UL
 #define SRC_CLK_FREQ	16000000UL
 #define CLK_FREQ		40000000UL
 
+// Cortex M4 Data Watchpoint & Trace unit, used for the free running cycle
+// counter. TivaWare does not define these
+#define DEMCR_REG         0xE000EDFCUL
+#define DEMCR_TRCENA      0x01000000UL
+#define DWT_CTRL_REG      0xE0001000UL
+#define DWT_CTRL_CYCCNTENA 0x00000001UL
+#define DWT_CYCCNT_REG    0xE0001004UL
+
+// the lowest interrupt priority, for PendSV under ES_USE_PREEMPTION
+#define LOWEST_INT_PRIORITY 0xE0
+
+#ifdef ES_USE_TICKLESS
+// SysTick counts down from a 24 bit reload value
+#define MAX_SYSTICK_RELOAD  0x00FFFFFFUL
+// sleep until an interrupt is pending, even one masked by PRIMASK. One
+// masked by BASEPRI does not wake it
+#if defined(rvmdk) || defined(__ARMCC_VERSION)
+#define WAIT_FOR_INTERRUPT()  __wfi()
+#elif defined(ccs)
+#define WAIT_FOR_INTERRUPT()  __asm("    wfi\n")
+#else
+#define WAIT_FOR_INTERRUPT()  __asm volatile ("wfi")
+#endif
+#endif
+
 // TickCount is used to track the number of timer ints that have occurred
 // since the last check. It should really never be more than 1, but just to
 // be sure, we increment it in the interrupt response rather than simply 
@@ -47,12 +78,30 @@
 // need to post events from the interrupt response routine. This is necessary
 // for compilers like HTC for the midrange PICs which do not produce re-entrant
 // code so cannot post directly to the queues from within the interrupt resp.
-static volatile uint8_t TickCount;
+// It is 16 bits so that it can hold the ticks of a stretched tickless tick.
+static volatile uint16_t TickCount;
 
 // Global tick count to monitor number of SysTick Interrupts
-// make uint16_t to maintain backwards compatibility and not overly burden
-// 8 and 16 bit processors
-static volatile uint16_t SysTickCounter = 0;
+// an ES_Time_t, so that it takes 49.7 days at 1mS to wrap. The Cortex M4
+// reads and writes it in one access, so it needs no critical region
+static volatile ES_Time_t SysTickCounter = 0;
+
+#ifdef ES_USE_TICKLESS
+// the ticks that the next tick interrupt stands for, more than 1 only while
+// _HW_Idle has stretched the tick, and the SysTick period, in cycles
+static volatile uint16_t TickStep = 1;
+static uint32_t TickPeriod;
+#endif
+
+static void ProcessPending( void );
+#ifdef ES_USE_TICKLESS
+static bool WorkPending( void );
+static bool StretchTick( uint32_t SleepTicks, uint32_t * pLeft );
+static void ShrinkTick( uint32_t SleepTicks, uint32_t Left );
+#endif
+#ifdef ES_USE_PREEMPTION
+void PendSVActivate( void );
+#endif
 
 /****************************************************************************
  Function
@@ -73,9 +122,25 @@ static volatile uint16_t SysTickCounter = 0;
 ****************************************************************************/
 void _HW_Timer_Init(TimerRate_t Rate)
 {
+#ifdef ES_USE_BASEPRI
+	uint32_t Interrupt;
+
+	// every interrupt at the priority that EnterCritical masks, so none can
+	// come in the middle of a critical region unless raised above it later
+	for (Interrupt = INT_GPIOA_TM4C123; Interrupt < NUM_INTERRUPTS; Interrupt++)
+		IntPrioritySet(Interrupt, ES_CRITICAL_PRIORITY);
+	IntPrioritySet(FAULT_SYSTICK, ES_CRITICAL_PRIORITY);
+#endif
 	SysTickPeriodSet(Rate);			/* Set the SysTick Interrupt Rate */
 	SysTickIntEnable();				/* Enable the SysTick Interrupt */
 	SysTickEnable();				/* Enable SysTick */
+#ifdef ES_USE_TICKLESS
+	TickPeriod = HWREG(NVIC_ST_RELOAD) + 1;
+#endif
+#ifdef ES_USE_PREEMPTION
+	// PendSV must never preempt an interrupt response, only thread code
+	IntPrioritySet(FAULT_PENDSV, LOWEST_INT_PRIORITY);
+#endif
 	IntMasterEnable();				/* Make sure interrupts are enabled */
 
 }
@@ -100,11 +165,21 @@ void _HW_Timer_Init(TimerRate_t Rate)
 void SysTickIntHandler(void)
 {
 	/* Interrupt automatically cleared by hardware */
+#ifdef ES_USE_TICKLESS
+  // a stretched tick stands for all of the ticks that it slept through
+  TickCount += TickStep;
+  SysTickCounter += TickStep;
+  TickStep = 1;
+#else
   ++TickCount;          /* flag that it occurred and needs a response */
 	++SysTickCounter;     // keep the free running time going
+#endif
 #ifdef LED_DEBUG
 	BlinkLED();
 #endif
+#ifdef ES_USE_PREEMPTION
+	_HW_PendPreempt();    // respond now, not when the running service is done
+#endif
 }
 
 /****************************************************************************
@@ -113,7 +188,7 @@ void SysTickIntHandler(void)
  Parameters
     none
  Returns
-    uint16_t   count of number of system ticks that have occurred.
+    ES_Time_t  count of number of system ticks that have occurred.
  Description
     wrapper for access to SysTickCounter, needed to move increment of tick
     counter to this module to keep the timer ticking during blocking code
@@ -122,11 +197,49 @@ void SysTickIntHandler(void)
  Author
     Ed Carryer, 10/27/14 13:55
 ****************************************************************************/
-uint16_t _HW_GetTickCount(void)
+ES_Time_t _HW_GetTickCount(void)
 {
    return (SysTickCounter);
 }
 
+/****************************************************************************
+ Function
+    _HW_CycleCounterInit()
+ Parameters
+    none
+ Returns
+    none
+ Description
+    enables the free running cycle counter read by _HW_GetCycleCount
+ Notes
+    this is the DWT CYCCNT register. The host port (Host/ES_HostPort.c)
+    derives the count from clock_gettime instead
+****************************************************************************/
+void _HW_CycleCounterInit(void)
+{
+  HWREG(DEMCR_REG) |= DEMCR_TRCENA;           // turn on the DWT unit
+  HWREG(DWT_CYCCNT_REG) = 0;
+  HWREG(DWT_CTRL_REG) |= DWT_CTRL_CYCCNTENA;  // start the cycle counter
+}
+
+/****************************************************************************
+ Function
+    _HW_GetCycleCount()
+ Parameters
+    none
+ Returns
+    uint32_t   free running count of CPU cycles
+ Description
+    used by the profiler to time run functions and event latency
+ Notes
+    the count wraps every 107 seconds at 40MHz, so only differences of less
+    than that are meaningful
+****************************************************************************/
+uint32_t _HW_GetCycleCount(void)
+{
+  return HWREG(DWT_CYCCNT_REG);
+}
+
 /****************************************************************************
  Function
      _HW_Process_Pending_Ints
@@ -145,19 +258,225 @@ uint16_t _HW_GetTickCount(void)
      run function is called and even when there are no queues with events.
      This routine could be expanded to process any other interrupt sources
      that you would like to use to post events to the framework services.
+     With ES_USE_PREEMPTION a PendSV can call this again from the middle of
+     itself, so only the outermost call does the work, going round again if
+     an inner one was turned away. Preemption is held off while it posts, so
+     that all of the timeouts for one tick are posted before any run
  Author
      J. Edward Carryer, 08/13/13 13:27
 ****************************************************************************/
 bool _HW_Process_Pending_Ints( void )
 {
-   while (TickCount > 0)
+#ifdef ES_USE_PREEMPTION
+   static bool Busy;
+   static bool Again;
+   bool Done;
+
+   EnterCritical();
+   if ( Busy ){
+      Again = true;   // leave it to the outer call
+      ExitCritical();
+      return true;
+   }
+   Busy = true;
+   ExitCritical();
+   ES_SchedLock();
+   do{
+      ProcessPending();
+      EnterCritical();
+      Done = !Again;
+      Again = false;
+      Busy = !Done;
+      ExitCritical();
+   }while ( !Done );
+   ES_SchedUnlock();
+#else
+   ProcessPending();
+#endif
+   return true; // always return true to allow loop test in ES_Run to proceed
+}
+
+// the body of _HW_Process_Pending_Ints: runs the tick response for each tick
+// and posts the events that the interrupt responses left
+static void ProcessPending( void )
+{
+   uint16_t NumTicks;
+
+#ifdef ES_USE_RECORD
+   // take all of the ticks at once, so the number can be recorded
+   EnterCritical();
+   NumTicks = TickCount;
+   TickCount = 0;
+   ExitCritical();
+   NumTicks = ES_INPUT_TICKS(NumTicks);
+   ES_Timer_CatchUp(NumTicks);
+   ES_ShortTimerPostPending();
+#else
+   // take the ticks that have built up all together, going round again for
+   // any that come in while the timeouts are posted
+   for (;;)
    {
+      EnterCritical();
+      NumTicks = TickCount;
+      TickCount = 0;
+      ExitCritical();
+      if (NumTicks == 0)
+         break;
       /* call the framework tick response to actually run the timers */
-      ES_Timer_Tick_Resp();  
-      TickCount--;
+      ES_Timer_CatchUp(NumTicks);
    }
-   return true; // always return true to allow loop test in ES_Run to proceed
+#endif
+#ifdef ES_USE_ISR_CHANNELS
+   ES_ChannelDrain(); // post the events that interrupt responses left
+#endif
+}
+
+/****************************************************************************
+ Function
+     _HW_Idle
+ Parameters
+     none
+ Returns
+     none
+ Description
+     called by ES_Run when all of the queues are empty and none of the event
+     checkers found anything to do
+ Notes
+     nothing to do on this port, the event checkers need to be polled. The
+     host port uses this to move its virtual clock on to the next interrupt.
+     With ES_USE_TICKLESS it stretches the tick over the ticks on which no
+     timer is due, up to ES_TICKLESS_MAX_TICKS, and sleeps until the tick
+     or another interrupt. Interrupts are off from the last check for work
+     until the sleep, so that one arriving in between still wakes it. An
+     interrupt response that posts straight to a queue, rather than through
+     a channel, is only seen when the sleep ends.
+     With ES_USE_BASEPRI the interrupts are turned off with PRIMASK here,
+     not with a critical region, as an interrupt masked by BASEPRI would
+     not wake the sleep
+****************************************************************************/
+void _HW_Idle( void )
+{
+#ifdef ES_USE_TICKLESS
+   uint32_t SleepTicks;
+   uint32_t Left = 0;
+#ifdef ES_USE_BASEPRI
+   uint32_t Primask = CPUgetPRIMASK_cpsid();
+#else
+   EnterCritical();
+#endif
+   if ( !WorkPending() ){
+      SleepTicks = ES_Timer_IdleTicks( ES_TICKLESS_MAX_TICKS - 1 ) + 1;
+      if ( SleepTicks > MAX_SYSTICK_RELOAD / TickPeriod )
+         SleepTicks = MAX_SYSTICK_RELOAD / TickPeriod;
+      // the tick may have come while the timers were being looked at, and
+      // then the sleep is only until it is taken
+      if ( (SleepTicks > 1) && !StretchTick( SleepTicks, &Left ) )
+         SleepTicks = 1;
+      WAIT_FOR_INTERRUPT();
+      if ( SleepTicks > 1 )
+         ShrinkTick( SleepTicks, Left );
+   }
+#ifdef ES_USE_BASEPRI
+   CPUsetPRIMASK(Primask);   // the interrupt that woke it is taken here
+#else
+   ExitCritical();   // the interrupt that woke it is taken here
+#endif
+#endif
+}
+
+#ifdef ES_USE_TICKLESS
+// true if a tick or an interrupt response is waiting to be dealt with
+static bool WorkPending( void )
+{
+   if ( (TickCount != 0) ||
+        ((HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PEND_SYST) != 0) )
+      return true;
+#ifdef ES_USE_ISR_CHANNELS
+   return ES_ChannelsPending();
+#else
+   return false;
+#endif
+}
+
+/****************************************************************************
+ Function
+     StretchTick
+ Parameters
+     uint32_t SleepTicks, the ticks that the next tick interrupt is to end
+     uint32_t * pLeft, where to put the cycles left in the current tick
+ Returns
+     bool, false if the current tick has already ended, in which case the
+     tick is left as it was
+ Description
+     reloads SysTick so that its next interrupt comes at the end of
+     SleepTicks ticks rather than one
+ Notes
+     called with interrupts off. The few cycles that SysTick is stopped for
+     are lost, so the tick runs very slightly slow while tickless.
+     The tick may end between the check for work in _HW_Idle and stopping
+     SysTick here. Its interrupt would then count SleepTicks for the one
+     tick, so that is checked for once SysTick is stopped
+****************************************************************************/
+static bool StretchTick( uint32_t SleepTicks, uint32_t * pLeft )
+{
+   uint32_t Left;
+
+   HWREG(NVIC_ST_CTRL) &= ~NVIC_ST_CTRL_ENABLE;
+   if ( (HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PEND_SYST) != 0 ){
+      HWREG(NVIC_ST_CTRL) |= NVIC_ST_CTRL_ENABLE;
+      return false;
+   }
+   Left = HWREG(NVIC_ST_CURRENT);
+   HWREG(NVIC_ST_RELOAD) = Left + (SleepTicks - 1) * TickPeriod - 1;
+   HWREG(NVIC_ST_CURRENT) = 0;    // start the count from the new reload
+   TickStep = SleepTicks;
+   HWREG(NVIC_ST_CTRL) |= NVIC_ST_CTRL_ENABLE;
+   *pLeft = Left;
+   return true;
+}
+
+/****************************************************************************
+ Function
+     ShrinkTick
+ Parameters
+     uint32_t SleepTicks, the ticks that the tick was stretched over
+     uint32_t Left, the cycles that were left in the tick when it was
+ Returns
+     None.
+ Description
+     puts the tick back to its normal period, in step with the ticks that
+     went by. If the stretched tick has not come, the ticks that did go by
+     are counted here instead
+ Notes
+     called with interrupts off, straight after the sleep
+****************************************************************************/
+static void ShrinkTick( uint32_t SleepTicks, uint32_t Left )
+{
+   uint32_t Stretched = Left + (SleepTicks - 1) * TickPeriod;
+   uint32_t Into;     // cycles into the current normal tick
+   uint32_t Ticks;
+
+   HWREG(NVIC_ST_CTRL) &= ~NVIC_ST_CTRL_ENABLE;
+   if ( (HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PEND_SYST) != 0 ){
+      // it came, and its interrupt, still to be taken, counts the ticks
+      Into = Stretched - 1 - HWREG(NVIC_ST_CURRENT);
+   }else{
+      // woken early: count the ticks that have gone by
+      Into = (TickPeriod - Left) + (Stretched - 1 - HWREG(NVIC_ST_CURRENT));
+      Ticks = Into / TickPeriod;
+      Into %= TickPeriod;
+      TickCount += Ticks;
+      SysTickCounter += Ticks;
+      TickStep = 1;
+   }
+   if ( Into >= TickPeriod - 1 )   // too close to the end to reload for
+      Into = TickPeriod - 2;
+   HWREG(NVIC_ST_RELOAD) = TickPeriod - Into - 1;
+   HWREG(NVIC_ST_CURRENT) = 0;
+   HWREG(NVIC_ST_CTRL) |= NVIC_ST_CTRL_ENABLE;
+   HWREG(NVIC_ST_RELOAD) = TickPeriod - 1;   // from the tick after this one
 }
+#endif
 
 /****************************************************************************
  Function
@@ -232,6 +551,26 @@ void CPUsetFAULTMASK(uint32_t newFAULTMASK)
 	__asm("    msr    faultmask, r0	;	Store newFAULTMASK in FAULTMASK\n");
 	//	  "    bx     lr			;	Return from function\n");
 }
+
+#ifdef ES_USE_BASEPRI
+uint32_t CPUgetBASEPRI_raise(uint32_t newBASEPRI)
+{
+    __asm("    mrs     r1, basepri	;	Store BASEPRI in r1\n"
+          "    msr     basepri_max, r0	;	Raise BASEPRI, never lower it\n"
+          "    mov     r0, r1		;	Return BASEPRI in r0\n"
+          "    bx      lr			;	Return from function\n");
+
+    /* Used to satisfy compiler. Actual return in r0 */
+	return 0;
+}
+
+void CPUsetBASEPRI(uint32_t newBASEPRI)
+{
+	// Set the BASEPRI register to passed in parameter
+	__asm("    msr    basepri, r0	;	Store newBASEPRI in BASEPRI\n"
+		  "    bx     lr			;	Return from function\n");
+}
+#endif
 #endif
 
 #if defined(rvmdk) || defined(__ARMCC_VERSION)
@@ -272,4 +611,157 @@ inline void CPUsetFAULTMASK(uint32_t newFAULTMASK)
     msr     FAULTMASK, newFAULTMASK	  // Store newFAULTMASK in FAULTMASK
   }
 }
+
+#ifdef ES_USE_BASEPRI
+// BASEPRI_MAX only takes the new value if it masks more than the old one, so
+// a nested region, or one entered from an interrupt response, never lowers it
+inline uint32_t CPUgetBASEPRI_raise(uint32_t newBASEPRI)
+{
+  uint32_t r0;
+  __asm
+  {
+    mrs     r0, BASEPRI;	          // Store BASEPRI in r0
+    msr     BASEPRI_MAX, newBASEPRI // Raise BASEPRI to newBASEPRI
+  }
+  return r0;
+}
+
+inline void CPUsetBASEPRI(uint32_t newBASEPRI)
+{
+  __asm
+  {
+    msr     BASEPRI, newBASEPRI		  // Store newBASEPRI in BASEPRI
+  }
+}
+#endif
+#endif
+
+#ifdef ES_USE_PREEMPTION
+/****************************************************************************
+ Function
+     _HW_InInterrupt
+ Parameters
+     none
+ Returns
+     bool true if called from an interrupt (or fault) response
+ Description
+     tests the active exception number in the NVIC
+ Notes
+     the thread level code run by PendSVActivate counts as not in an
+     interrupt, as it runs in Thread mode
+****************************************************************************/
+bool _HW_InInterrupt(void)
+{
+  return (HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_VEC_ACT_M) != 0;
+}
+
+/****************************************************************************
+ Function
+     _HW_PendPreempt
+ Parameters
+     none
+ Returns
+     none
+ Description
+     pends PendSV, which runs ES_PreemptActivate once the interrupt responses
+     are done
+ Notes
+
+****************************************************************************/
+void _HW_PendPreempt(void)
+{
+  HWREG(NVIC_INT_CTRL) = NVIC_INT_CTRL_PEND_SV;
+}
+
+/****************************************************************************
+ Function
+     PendSVActivate
+ Parameters
+     none
+ Returns
+     none
+ Description
+     the Thread mode code that PendSVIntHandler returns into. It is entered
+     with interrupts off and must return with them off
+ Notes
+     runs on the stack of whatever PendSV preempted, on top of it
+****************************************************************************/
+void PendSVActivate(void)
+{
+  IntMasterEnable();
+  ES_PreemptActivate();
+  IntMasterDisable();
+}
+
+/*
+   The PendSV trampoline, in the style of a single stack run to completion
+   kernel. ES_PreemptActivate has to run in Thread mode, at the level of the
+   code that was preempted, so that any interrupt can preempt it in turn.
+   PendSVIntHandler gets there by returning from the exception through a
+   made up exception frame whose return address is PendSVActivate and whose
+   LR is PreemptReturn. PreemptReturn can not simply return to the preempted
+   code, as only an exception return restores the registers that PendSV
+   saved, so it pends an NMI, and NmiSR throws away its own frame and
+   returns from the exception that PendSV took.
+   With the FPU, PendSV saves its EXC_RETURN, which says whether the
+   preempted code's frame holds the FP registers, and PreemptReturn clears
+   CONTROL.FPCA so that the NMI frame never does.
+   PendSVIntHandler and NmiSR replace the weak defaults in startup_rvmdk.S
+*/
+#if defined(rvmdk) || defined(__ARMCC_VERSION)
+__asm void PreemptReturn(void)
+{
+#ifdef __TARGET_FPU_VFP
+    MRS     r0,CONTROL
+    BIC     r0,r0,#4          ; clear FPCA, the NMI frame is a basic one
+    MSR     CONTROL,r0
+    ISB
+#endif
+    LDR     r0,=0xE000ED04    ; NVIC_INT_CTRL
+    MOV     r1,#1
+    LSL     r1,r1,#31         ; NMI_SET
+    STR     r1,[r0]
+    B       .                 ; the NMI comes in here
+}
+
+__asm void PendSVIntHandler(void)
+{
+    IMPORT  PendSVActivate
+    IMPORT  PreemptReturn
+
+    CPSID   i
+    ; clear any PendSV that an interrupt set while this one was starting
+    LDR     r3,=0xE000ED04    ; NVIC_INT_CTRL
+    MOV     r1,#1
+    LSL     r1,r1,#27         ; UNPEND_SV
+    STR     r1,[r3]
+#ifdef __TARGET_FPU_VFP
+    PUSH    {r0,lr}           ; keep EXC_RETURN, r0 keeps the stack aligned
+#endif
+    MOV     r3,#1
+    LSL     r3,r3,#24         ; xPSR with only the Thumb bit set
+    LDR     r2,=PendSVActivate
+    SUB     r2,r2,#1          ; the PC, without the Thumb bit
+    LDR     r1,=PreemptReturn ; the LR
+    SUB     sp,sp,#8*4        ; room for the made up frame
+    ADD     r0,sp,#5*4
+    STM     r0!,{r1-r3}       ; fill in its LR, PC & xPSR
+    MOV     r0,#6
+    MVN     r0,r0             ; 0xFFFFFFF9, return to Thread mode on the MSP
+    BX      r0
+}
+
+__asm void NmiSR(void)
+{
+    ADD     sp,sp,#8*4        ; throw away the NMI's own frame
+    CPSIE   i
+#ifdef __TARGET_FPU_VFP
+    POP     {r0,pc}           ; return from PendSV with its EXC_RETURN
+#else
+    BX      lr                ; return from PendSV, the frames are the same
+#endif
+}
+#else
+#error "the PendSV trampoline is only written for the Keil (armcc) tools"
 #endif
+#endif /* ES_USE_PREEMPTION */
@@ -16,10 +16,17 @@
 #include "ES_Configure.h"
 #include "ES_Queue.h"
 #include "ES_Port.h"
+#include <string.h>
 
 /*----------------------------- Module Defines ----------------------------*/
-unsigned int _PRIMASK_temp;
+// the mask saved by the outermost EnterCritical, and the regions entered
+uint32_t _CriticalSave;
+uint8_t _CriticalDepth;
 //unsigned int _FAULTMASK_temp;
+
+// with ES_USE_SPSC_QUEUE, ES_SpscQueue.c provides the queue functions instead
+#ifndef ES_USE_SPSC_QUEUE
+
 // QueueSize is max number of entries in the queue
 // CurrentIndex is the 'read-from' index,
 // actually CurrentIndex + sizeof(EF_Queue_t)
@@ -32,6 +39,10 @@ typedef struct {  uint8_t QueueSize;
 typedef ES_Queue_t * pQueue_t;
 
 /*---------------------------- Module Functions ---------------------------*/
+static void CopyToRing( ES_Event * pBlock, uint8_t Index,
+                        const ES_Event * pEvents, uint8_t NumEvents );
+static void CopyFromRing( ES_Event * pBlock, uint8_t Index,
+                          ES_Event * pEvents, uint8_t NumEvents );
 
 /*---------------------------- Module Variables ---------------------------*/
 
@@ -55,7 +66,7 @@ typedef ES_Queue_t * pQueue_t;
  Author
    J. Edward Carryer, 08/09/11, 18:40
 ****************************************************************************/
-uint8_t ES_InitQueue( ES_Event * pBlock, uint8_t BlockSize )
+ES_QueueIndex_t ES_InitQueue( ES_Event * pBlock, ES_QueueIndex_t BlockSize )
 {
    pQueue_t pThisQueue;
    // initialize the Queue by setting up initial values for elements
@@ -102,6 +113,36 @@ bool ES_EnQueueFIFO( ES_Event * pBlock, ES_Event Event2Add )
       return(false);
 }
 
+/****************************************************************************
+ Function
+   ES_EnQueueFIFOInCritical
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event Event2Add : event to be added to the Queue
+ Returns
+   bool : true if the add was successful, false if not
+ Description
+   the same as ES_EnQueueFIFO, but for use inside a region that the caller
+   has already protected with EnterCritical/ExitCritical
+ Notes
+   ES_EnQueueFIFO could be called from inside the region, as the regions
+   nest, but this lets ES_Publish fill several queues while interrupts go
+   off just once
+****************************************************************************/
+bool ES_EnQueueFIFOInCritical( ES_Event * pBlock, ES_Event Event2Add )
+{
+   pQueue_t pThisQueue;
+   pThisQueue = (pQueue_t)pBlock;
+   if ( pThisQueue->NumEntries < pThisQueue->QueueSize)
+   {
+      pBlock[ 1 + ((pThisQueue->CurrentIndex + pThisQueue->NumEntries)
+               % pThisQueue->QueueSize)] = Event2Add;
+      pThisQueue->NumEntries++;
+      return(true);
+   }else
+      return(false);
+}
+
 /****************************************************************************
  Function
    ES_EnQueueLIFO
@@ -142,6 +183,153 @@ bool ES_EnQueueLIFO( ES_Event * pBlock, ES_Event Event2Add )
       return(false);
 }
 
+/****************************************************************************
+ Function
+   ES_EnQueuePolicy
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event Event2Add : event to be added to the Queue
+   ES_QueuePolicy_t Policy : what to do if the Queue is full
+   ES_Event * pLost : used to return the event that made room for Event2Add
+ Returns
+   bool : true if Event2Add is now in the Queue, false if not
+ Description
+   adds Event2Add at the end of the Queue if there is room. If there is not:
+     ES_QUEUE_REJECT           fails, as ES_EnQueueFIFO does
+     ES_QUEUE_DROP_OLDEST      removes the next event to be dequeued
+     ES_QUEUE_OVERWRITE_NEWEST overwrites the last event enqueued
+     ES_QUEUE_COALESCE         fails, unless the next rule applies
+   With ES_QUEUE_COALESCE, an event of the same EventType that is still
+   waiting is overwritten in place by Event2Add whether or not the Queue is
+   full. An event that is removed or overwritten is copied to *pLost, which
+   is set to ES_NO_EVENT if none was.
+ Notes
+   a coalesced event keeps its place in the Queue, so a stream of them can
+   never hold up the other events. The caller decides which event types
+   may be coalesced
+****************************************************************************/
+bool ES_EnQueuePolicy( ES_Event * pBlock, ES_Event Event2Add,
+                       ES_QueuePolicy_t Policy, ES_Event * pLost )
+{
+   pQueue_t pThisQueue;
+   uint8_t i;
+   uint8_t Index;
+   bool ReturnVal = true;
+
+   pThisQueue = (pQueue_t)pBlock;
+   pLost->EventType = ES_NO_EVENT;
+   pLost->EventParam = 0;
+   EnterCritical();   // save interrupt state, turn ints off
+   // Index ends up at the entry to coalesce with, or at the end of the Queue
+   Index = pThisQueue->CurrentIndex;
+   if ( Policy == ES_QUEUE_COALESCE ){
+      for ( i = 0; i < pThisQueue->NumEntries; i++ ){
+         if ( pBlock[ 1 + Index ].EventType == Event2Add.EventType )
+            break;
+         if ( ++Index >= pThisQueue->QueueSize )
+            Index = 0;
+      }
+   }else{
+      i = pThisQueue->NumEntries;
+      Index = (uint8_t)((Index + i) % pThisQueue->QueueSize);
+   }
+   if ( i < pThisQueue->NumEntries ){   // found one to coalesce with
+      *pLost = pBlock[ 1 + Index ];
+      pBlock[ 1 + Index ] = Event2Add;
+   }else if ( pThisQueue->NumEntries < pThisQueue->QueueSize ){
+      pBlock[ 1 + Index ] = Event2Add;
+      pThisQueue->NumEntries++;
+   }else if ( Policy == ES_QUEUE_DROP_OLDEST ){
+      // when full, the end of the Queue is where the oldest entry is
+      *pLost = pBlock[ 1 + Index ];
+      pBlock[ 1 + Index ] = Event2Add;
+      if ( ++pThisQueue->CurrentIndex >= pThisQueue->QueueSize )
+         pThisQueue->CurrentIndex = 0;
+   }else if ( Policy == ES_QUEUE_OVERWRITE_NEWEST ){
+      Index = (Index == 0) ? pThisQueue->QueueSize - 1 : Index - 1;
+      *pLost = pBlock[ 1 + Index ];
+      pBlock[ 1 + Index ] = Event2Add;
+   }else
+      ReturnVal = false;
+   ExitCritical();  // restore saved interrupt state
+   return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueBatch
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   const ES_Event * pEvents : the events to be added, oldest first
+   ES_QueueIndex_t NumEvents : how many events there are at pEvents
+ Returns
+   bool : true if the events were added, false if there was not room for all
+          of them, in which case none are added
+ Description
+   adds NumEvents events to the end of the Queue, in order, as NumEvents calls
+   to ES_EnQueueFIFO would, but with one test for room, one critical region
+   and at most two block copies (either side of the wrap)
+ Notes
+
+****************************************************************************/
+bool ES_EnQueueBatch( ES_Event * pBlock, const ES_Event * pEvents,
+                      ES_QueueIndex_t NumEvents )
+{
+   pQueue_t pThisQueue;
+   uint16_t Index;
+   bool ReturnVal = false;
+
+   pThisQueue = (pQueue_t)pBlock;
+   EnterCritical();   // save interrupt state, turn ints off
+   if ( NumEvents <= pThisQueue->QueueSize - pThisQueue->NumEntries ){
+      Index = pThisQueue->CurrentIndex + pThisQueue->NumEntries;
+      if ( Index >= pThisQueue->QueueSize )
+         Index -= pThisQueue->QueueSize;
+      CopyToRing( pBlock, (uint8_t)Index, pEvents, NumEvents );
+      pThisQueue->NumEntries += NumEvents;
+      ReturnVal = true;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueBatchLIFO
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   const ES_Event * pEvents : the events to be added
+   ES_QueueIndex_t NumEvents : how many events there are at pEvents
+ Returns
+   bool : true if the events were added, false if there was not room for all
+          of them, in which case none are added
+ Description
+   adds NumEvents events at the extraction point, keeping their order, so
+   that pEvents[0] is the next event to be removed by a DeQueue operation
+ Notes
+   this puts back events taken by ES_DeQueueBatch and not yet used
+****************************************************************************/
+bool ES_EnQueueBatchLIFO( ES_Event * pBlock, const ES_Event * pEvents,
+                          ES_QueueIndex_t NumEvents )
+{
+   pQueue_t pThisQueue;
+   bool ReturnVal = false;
+
+   pThisQueue = (pQueue_t)pBlock;
+   EnterCritical();   // save interrupt state, turn ints off
+   if ( NumEvents <= pThisQueue->QueueSize - pThisQueue->NumEntries ){
+      // back the index up by NumEvents, wrapping if needed
+      if ( pThisQueue->CurrentIndex < NumEvents )
+         pThisQueue->CurrentIndex += pThisQueue->QueueSize - NumEvents;
+      else
+         pThisQueue->CurrentIndex -= NumEvents;
+      CopyToRing( pBlock, pThisQueue->CurrentIndex, pEvents, NumEvents );
+      pThisQueue->NumEntries += NumEvents;
+      ReturnVal = true;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return ReturnVal;
+}
 
 /****************************************************************************
  Function
@@ -159,7 +347,7 @@ bool ES_EnQueueLIFO( ES_Event * pBlock, ES_Event Event2Add )
  Author
    J. Edward Carryer, 08/09/11, 19:11
 ****************************************************************************/
-uint8_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent )
+ES_QueueIndex_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent )
 {
    pQueue_t pThisQueue;
    uint8_t NumLeft;
@@ -185,6 +373,45 @@ uint8_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent )
    return NumLeft;
 }
 
+/****************************************************************************
+ Function
+   ES_DeQueueBatch
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event * pEvents : where to put the events pulled from the Queue
+   ES_QueueIndex_t MaxEvents : the most events to pull
+ Returns
+   ES_QueueIndex_t : the number of events pulled, 0 if the Queue was empty
+ Description
+   pulls up to MaxEvents events from the Queue, oldest first, with one
+   critical region and at most two block copies
+ Notes
+
+****************************************************************************/
+ES_QueueIndex_t ES_DeQueueBatch( ES_Event * pBlock, ES_Event * pEvents,
+                                 ES_QueueIndex_t MaxEvents )
+{
+   pQueue_t pThisQueue;
+   uint8_t NumTaken;
+   uint16_t Index;
+
+   pThisQueue = (pQueue_t)pBlock;
+   if ( pThisQueue->NumEntries == 0 )
+      return 0;
+   EnterCritical();   // save interrupt state, turn ints off
+   NumTaken = pThisQueue->NumEntries;
+   if ( NumTaken > MaxEvents )
+      NumTaken = MaxEvents;
+   CopyFromRing( pBlock, pThisQueue->CurrentIndex, pEvents, NumTaken );
+   Index = pThisQueue->CurrentIndex + NumTaken;
+   if ( Index >= pThisQueue->QueueSize )
+      Index -= pThisQueue->QueueSize;
+   pThisQueue->CurrentIndex = (uint8_t)Index;
+   pThisQueue->NumEntries -= NumTaken;
+   ExitCritical();  // restore saved interrupt state
+   return NumTaken;
+}
+
 /****************************************************************************
  Function
    ES_IsQueueEmpty
@@ -207,6 +434,26 @@ bool ES_IsQueueEmpty( ES_Event * pBlock )
    return(pThisQueue->NumEntries == 0);
 }
 
+/****************************************************************************
+ Function
+   ES_QueueDepth
+ Parameters
+   unsigned char * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   uint8_t : the number of entries currently in the Queue
+ Description
+   see above
+ Notes
+   used by the profiler to track queue high-water marks
+****************************************************************************/
+ES_QueueIndex_t ES_QueueDepth( ES_Event * pBlock )
+{
+   pQueue_t pThisQueue;
+
+   pThisQueue = (pQueue_t)pBlock;
+   return(pThisQueue->NumEntries);
+}
+
 #if 0
 /****************************************************************************
  Function
@@ -238,73 +485,219 @@ void QueueFlushQueue( uint8_t * pBlock )
 /***************************************************************************
  private functions
  ***************************************************************************/
+/****************************************************************************
+ Function
+   CopyToRing
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   uint8_t Index : the entry to copy the first event into
+   const ES_Event * pEvents : the events to copy
+   uint8_t NumEvents : how many events to copy, no more than will fit
+ Returns
+   nothing
+ Description
+   copies the events into consecutive entries from Index, wrapping round to
+   the first entry if they run past the last one
+ Notes
+   does not change the Queue header
+****************************************************************************/
+static void CopyToRing( ES_Event * pBlock, uint8_t Index,
+                        const ES_Event * pEvents, uint8_t NumEvents )
+{
+   uint8_t NumBeforeWrap;
+
+   NumBeforeWrap = ((pQueue_t)pBlock)->QueueSize - Index;
+   if ( NumBeforeWrap > NumEvents )
+      NumBeforeWrap = NumEvents;
+   memcpy( &pBlock[ 1 + Index ], pEvents, NumBeforeWrap * sizeof(ES_Event) );
+   memcpy( &pBlock[ 1 ], &pEvents[ NumBeforeWrap ],
+           (NumEvents - NumBeforeWrap) * sizeof(ES_Event) );
+}
+
+/****************************************************************************
+ Function
+   CopyFromRing
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   uint8_t Index : the entry to copy the first event from
+   ES_Event * pEvents : where to copy the events to
+   uint8_t NumEvents : how many events to copy, no more than are there
+ Returns
+   nothing
+ Description
+   the reverse of CopyToRing
+ Notes
+   does not change the Queue header
+****************************************************************************/
+static void CopyFromRing( ES_Event * pBlock, uint8_t Index,
+                          ES_Event * pEvents, uint8_t NumEvents )
+{
+   uint8_t NumBeforeWrap;
+
+   NumBeforeWrap = ((pQueue_t)pBlock)->QueueSize - Index;
+   if ( NumBeforeWrap > NumEvents )
+      NumBeforeWrap = NumEvents;
+   memcpy( pEvents, &pBlock[ 1 + Index ], NumBeforeWrap * sizeof(ES_Event) );
+   memcpy( &pEvents[ NumBeforeWrap ], &pBlock[ 1 ],
+           (NumEvents - NumBeforeWrap) * sizeof(ES_Event) );
+}
+
 #ifdef TEST
 
 #include <stdio.h>
 #include "ES_General.h"
 
+// counts and reports a check that fails, without stopping the run
+#define CHECK(_cond_) \
+  if ( !(_cond_) ){ \
+    printf("line %d failed: %s\n\r", __LINE__, #_cond_); \
+    Errors++; \
+  }
+
 static ES_Event TestQueue[3+1];
 volatile  uint8_t NumLeft; // for debugging visibility
 
-void main(void){
+#ifdef ES_HOST
+// the simulated PRIMASK and BASEPRI for EnterCritical/ExitCritical
+uint32_t CPUgetPRIMASK_cpsid( void ) { return 0; }
+void CPUsetPRIMASK( uint32_t newPRIMASK ) { }
+#ifdef ES_USE_BASEPRI
+uint32_t CPUgetBASEPRI_raise( uint32_t newBASEPRI ) { return 0; }
+void CPUsetBASEPRI( uint32_t newBASEPRI ) { }
+#endif
+#endif
+
+int main(void){
   ES_Event MyEvent;
-  bool bReturn;
-  
+  ES_Event Lost;
+  ES_Event Batch[3];
+  uint16_t Errors = 0;
+
+  puts("Testing the event queue\n\r");
   ES_InitQueue( TestQueue, ARRAY_SIZE(TestQueue) );
   MyEvent.EventType = 0;
   MyEvent.EventParam = 1;
-  bReturn = ES_EnQueueFIFO( TestQueue, MyEvent );
-  bReturn +=1; // keep that sily optimizer away
-  
+  CHECK( ES_EnQueueFIFO( TestQueue, MyEvent ) );
+
     // Try stuffing one on using the LIFO rule
   MyEvent.EventType = 10;
   MyEvent.EventParam = 11;
-  bReturn = ES_EnQueueLIFO( TestQueue, MyEvent );
-  bReturn +=1; // keep that sily optimizer away
-  
+  CHECK( ES_EnQueueLIFO( TestQueue, MyEvent ) );
+
   // at this point, the events in the queue should be 11,0
   // so pull off the 11, leaving 1 entry
   NumLeft = ES_DeQueue( TestQueue, &MyEvent);
-  if ( NumLeft != 1)
-    bReturn = 0;  
+  CHECK( (NumLeft == 1) && (MyEvent.EventParam == 11) );
 
   MyEvent.EventType = 2;
   MyEvent.EventParam = 3;
-  bReturn = ES_EnQueueFIFO( TestQueue, MyEvent );
-  bReturn +=1; // keep that sily optimizer away
-  
+  CHECK( ES_EnQueueFIFO( TestQueue, MyEvent ) );
+
   MyEvent.EventType = 4;
   MyEvent.EventParam = 5;
-  bReturn = ES_EnQueueFIFO( TestQueue, MyEvent );
-  bReturn +=1; // keep that sily optimizer away
-  
+  CHECK( ES_EnQueueFIFO( TestQueue, MyEvent ) );
+
   // queue is now full so this one should fail
   MyEvent.EventType = 6;
   MyEvent.EventParam = 7;
-  bReturn = ES_EnQueueFIFO( TestQueue, MyEvent );
-  bReturn +=1; // keep that sily optimizer away
-  
+  CHECK( !ES_EnQueueFIFO( TestQueue, MyEvent ) );
+
   // at this point, the events in the queue should be 0,2,4
   // so pull off the 0, leaving 2 entries
   NumLeft = ES_DeQueue( TestQueue, &MyEvent);
-  if ( NumLeft != 2)
-    bReturn = 0;  
+  CHECK( (NumLeft == 2) && (MyEvent.EventParam == 1) );
   // Try stuffing one on using the LIFO rule
   MyEvent.EventType = 8;
   MyEvent.EventParam = 9;
-  bReturn = ES_EnQueueLIFO( TestQueue, MyEvent );
-  bReturn +=1; // keep that sily optimizer away
-  
+  CHECK( ES_EnQueueLIFO( TestQueue, MyEvent ) );
+
   // at this point, the events in the queue should be 8,2,4
   // so pull off the 8, leaving 2 entries
   NumLeft = ES_DeQueue( TestQueue, &MyEvent);
+  CHECK( (NumLeft == 2) && (MyEvent.EventParam == 9) );
+
+  // a newer type 4 event should replace the one waiting, leaving 2 entries
+  MyEvent.EventType = 4;
+  MyEvent.EventParam = 13;
+  CHECK( ES_EnQueuePolicy( TestQueue, MyEvent, ES_QUEUE_COALESCE, &Lost ) );
+  CHECK( (Lost.EventType == 4) && (Lost.EventParam == 5) &&
+         (ES_QueueDepth( TestQueue ) == 2) );
+
+  // with no type 6 waiting, this one is added at the end: 2,13,15
+  MyEvent.EventType = 6;
+  MyEvent.EventParam = 15;
+  CHECK( ES_EnQueuePolicy( TestQueue, MyEvent, ES_QUEUE_COALESCE, &Lost ) );
+  CHECK( (Lost.EventType == ES_NO_EVENT) &&
+         (ES_QueueDepth( TestQueue ) == 3) );
+
+  // now full, with no type 10 waiting, so this one has nowhere to go
+  MyEvent.EventType = 10;
+  MyEvent.EventParam = 16;
+  CHECK( !ES_EnQueuePolicy( TestQueue, MyEvent, ES_QUEUE_COALESCE, &Lost ) );
+  CHECK( (Lost.EventType == ES_NO_EVENT) &&
+         (ES_QueueDepth( TestQueue ) == 3) );
+
+  // the queue is full, so the reject policy turns the 17 away
+  MyEvent.EventType = 8;
+  MyEvent.EventParam = 17;
+  CHECK( !ES_EnQueuePolicy( TestQueue, MyEvent, ES_QUEUE_REJECT, &Lost ) );
+  CHECK( (Lost.EventType == ES_NO_EVENT) &&
+         (ES_QueueDepth( TestQueue ) == 3) );
+
+  // but dropping the 2 makes room for it: 13,15,17
+  CHECK( ES_EnQueuePolicy( TestQueue, MyEvent, ES_QUEUE_DROP_OLDEST, &Lost ) );
+  CHECK( (Lost.EventType == 2) && (Lost.EventParam == 3) &&
+         (ES_QueueDepth( TestQueue ) == 3) );
+
+  // and replace the 17: 13,15,19
+  MyEvent.EventParam = 19;
+  CHECK( ES_EnQueuePolicy( TestQueue, MyEvent, ES_QUEUE_OVERWRITE_NEWEST,
+                           &Lost ) );
+  CHECK( (Lost.EventType == 8) && (Lost.EventParam == 17) &&
+         (ES_QueueDepth( TestQueue ) == 3) );
+  NumLeft = ES_DeQueue( TestQueue, &MyEvent);
+  CHECK( (NumLeft == 2) && (MyEvent.EventParam == 13) );
+
+  // 15,19 leaves room for one more, so a batch of two must not go in at all
+  Batch[0].EventType = 10;
+  Batch[0].EventParam = 21;
+  Batch[1].EventType = 12;
+  Batch[1].EventParam = 23;
+  CHECK( !ES_EnQueueBatch( TestQueue, Batch, 2 ) );
+  CHECK( ES_QueueDepth( TestQueue ) == 2 );
+  // but a batch of one does: 15,19,21
+  CHECK( ES_EnQueueBatch( TestQueue, Batch, 1 ) );
+  CHECK( ES_QueueDepth( TestQueue ) == 3 );
+
+  // take two, then put them back in front of the 21, in the same order
+  CHECK( (ES_DeQueueBatch( TestQueue, Batch, 2 ) == 2) &&
+         (Batch[0].EventParam == 15) && (Batch[1].EventParam == 19) );
+  CHECK( ES_EnQueueBatchLIFO( TestQueue, Batch, 2 ) );
+  // full again, so a LIFO batch must not go in either
+  CHECK( !ES_EnQueueBatchLIFO( TestQueue, Batch, 1 ) );
+  CHECK( ES_QueueDepth( TestQueue ) == 3 );
+
+  // the 15 is in the first slot, so taking it and adding one more leaves
+  // 19,21,23 running from the second slot round to the first
+  NumLeft = ES_DeQueue( TestQueue, &MyEvent);
+  CHECK( (NumLeft == 2) && (MyEvent.EventParam == 15) );
+  Batch[0].EventType = 14;
+  Batch[0].EventParam = 23;
+  CHECK( ES_EnQueueBatch( TestQueue, Batch, 1 ) );
+
+  // asking for more than are there takes the lot, across the wrap
+  Batch[0].EventParam = Batch[1].EventParam = Batch[2].EventParam = 0;
+  CHECK( (ES_DeQueueBatch( TestQueue, Batch, 4 ) == 3) &&
+         (Batch[0].EventParam == 19) && (Batch[1].EventParam == 21) &&
+         (Batch[2].EventParam == 23) && ES_IsQueueEmpty( TestQueue ) );
   NumLeft += 3; //to keep the compiler from optimizing away the last save
-  
-  while(1)
-    ;
+
+  printf("%u errors\n\r", Errors);
+  return (Errors == 0) ? 0 : 1;
 }
 
 #endif
+#endif /* ES_USE_SPSC_QUEUE */
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
 
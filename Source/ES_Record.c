@@ -0,0 +1,639 @@
+/****************************************************************************
+ Module
+     ES_Record.c
+
+ Description
+     This is a module implementing a deterministic record and replay of the
+     external inputs to the framework. In capture mode every input is logged,
+     in the order that the framework sees it, to a compact binary stream in
+     RAM which ES_RecordDump sends to the console. In replay mode (the host
+     build, see Host/ES_HostPort.c) the inputs are taken from such a stream
+     instead of from the hardware, so the run repeats event for event.
+
+ Notes
+     The inputs are: the number of framework ticks taken in each call of
+     _HW_Process_Pending_Ints, the short timer expirations (which are
+     deferred to _HW_Process_Pending_Ints in this build, as the ticks already
+     are), the keys seen by Check4Keystroke, the reset button state seen by
+     CheckButtonEvents and every ADC_MultiRead. With the interrupts acting
+     only at _HW_Process_Pending_Ints, everything else that the services do
+     follows from these, so it is enough to replay the inputs in the same
+     order and on the same pass through ES_Run.
+     Each call of _HW_Process_Pending_Ints marks a new pass. Passes with no
+     inputs are run together into one PASS record. Ticks, timeouts, keys and
+     button changes are only logged when they happen. ADC reads are logged
+     every time, as the channels that changed and their change from the last
+     read, and identical reads are run together.
+     All of the hooks are called from the foreground, never from interrupt
+     responses, so no critical regions are needed here.
+     When the capture buffer fills, capture stops and the dump is marked as
+     truncated; the replay then ends where the capture did.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_LookupTables.h"
+#include "ES_Port.h"
+#include "ES_Record.h"
+
+#ifdef ES_USE_RECORD
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+// each record starts with a byte holding the kind in the top 3 bits and a
+// small value in the bottom 5. Counts too big for the small value are sent
+// as a small value of 0 followed by a variable length number
+#define KIND_SHIFT 5
+#define SMALL_MASK 0x1F
+#define SMALL_MAX 31
+
+#define REC_PASS      0   // small/varint: number of passes
+#define REC_TICKS     1   // small/varint: number of ticks taken
+#define REC_SHORT     2   // small: mask of short timers that expired
+#define REC_KEY       3   // followed by the key
+#define REC_BUTTON    4   // small: new button state
+#define REC_ADC       5   // small: changed channels, then a varint each
+#define REC_ADC_SAME  6   // small: number of reads equal to the last one
+#define REC_END       7
+
+#define MAX_CHANNELS 4
+// the longest record, an ADC read with all 4 channels changed by 12 bits
+#define MAX_RECORD_BYTES (1 + MAX_CHANNELS * 3)
+// room kept for the PASS and END records that close the stream
+#define CLOSING_BYTES 7
+
+#define NO_RECORD 0xFFFFFFFF
+#define BUTTON_UNKNOWN 0xFF
+
+#define RECORD_VERSION 1
+#define FLAG_TRUNCATED BIT0HI
+static const char DumpHeader[] = "ESRC";
+static const char DumpTrailer[] = "END!";
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct {
+  uint8_t  Kind;
+  uint8_t  Small;
+  uint32_t Count;   // passes, ticks or equal reads still to be consumed
+  int32_t  Delta[MAX_CHANNELS];   // changes to the channels of a REC_ADC
+} Record_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static void FlushPasses( void );
+static bool StartRecord( uint8_t Kind, uint8_t Small );
+static void PutCount( uint8_t Kind, uint32_t Count );
+static void PutVarint( uint32_t Value );
+static uint8_t EncodeCount( uint8_t Kind, uint32_t Count, uint8_t *pBytes );
+
+static void ReadNext( void );
+static uint32_t GetVarint( void );
+static void Consume( void );
+static void EndReplay( const char *pWhy );
+static void PutBytes( void (*pPutByte)(unsigned char), const char *pBytes,
+                      uint8_t NumBytes );
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_RecordMode_t Mode = ES_RECORD_OFF;
+static uint32_t PassCount;
+
+// capture
+static uint8_t Stream[ES_RECORD_SIZE];
+static uint32_t StreamLength;
+static uint32_t PendingPasses;
+static uint32_t LastSameRun;    // index of a REC_ADC_SAME that can grow
+static uint32_t LastADC[MAX_CHANNELS];
+static uint8_t LastButton;
+static bool Truncated;
+
+// replay
+static const uint8_t *pReplay;
+static uint32_t ReplayLength;
+static uint32_t ReplayIndex;
+static Record_t Next;
+static bool ReplayButton;
+static bool Ended;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_RecordInit
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     starts a fresh capture, unless a replay has already been set up
+ Notes
+     called by ES_Initialize before the services are initialized, so that
+     the inputs that they read are captured too
+****************************************************************************/
+void ES_RecordInit( void )
+{
+  uint8_t i;
+
+  PassCount = 0;
+  if ( Mode == ES_RECORD_REPLAY )
+    return;
+  Mode = ES_RECORD_CAPTURE;
+  StreamLength = 0;
+  PendingPasses = 0;
+  LastSameRun = NO_RECORD;
+  for ( i = 0; i < MAX_CHANNELS; i++ )
+    LastADC[i] = 0;
+  LastButton = BUTTON_UNKNOWN;
+  Truncated = false;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordStartReplay
+ Parameters
+     const uint8_t *pStream, the bytes of a dump, which may have other
+       console text before it
+     uint32_t Length, how many bytes there are at pStream
+ Returns
+     bool, false if no complete dump could be found
+ Description
+     switches the inputs over to the recorded stream
+ Notes
+     call before ES_Initialize. The stream must stay in place until the
+     replay ends
+****************************************************************************/
+bool ES_RecordStartReplay( const uint8_t *pStream, uint32_t Length )
+{
+  uint32_t Start;
+  uint32_t BodyLength;
+  const uint8_t *pHeader;
+  uint8_t i;
+
+  for ( Start = 0; Start + 10 <= Length; Start++ ){
+    pHeader = &pStream[Start];
+    if ( (pHeader[0] != DumpHeader[0]) || (pHeader[1] != DumpHeader[1]) ||
+         (pHeader[2] != DumpHeader[2]) || (pHeader[3] != DumpHeader[3]) )
+      continue;
+    if ( pHeader[4] != RECORD_VERSION )
+      return false;
+    BodyLength = pHeader[6] | ((uint32_t)pHeader[7] << 8) |
+                 ((uint32_t)pHeader[8] << 16) | ((uint32_t)pHeader[9] << 24);
+    if ( Start + 10 + BodyLength > Length )
+      return false;
+    pReplay = &pHeader[10];
+    ReplayLength = BodyLength;
+    ReplayIndex = 0;
+    for ( i = 0; i < MAX_CHANNELS; i++ )
+      LastADC[i] = 0;
+    ReplayButton = false;
+    Ended = false;
+    Mode = ES_RECORD_REPLAY;
+    ReadNext();
+    return true;
+  }
+  return false;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordGetMode
+ Parameters
+     None.
+ Returns
+     ES_RecordMode_t, whether inputs are being captured or replayed
+****************************************************************************/
+ES_RecordMode_t ES_RecordGetMode( void )
+{
+  return Mode;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordReplayEnded
+ Parameters
+     None.
+ Returns
+     bool, true once a replay has used up its stream (or diverged from it)
+****************************************************************************/
+bool ES_RecordReplayEnded( void )
+{
+  return Ended;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordDump
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     sends the stream captured so far to the console
+ Notes
+     capture carries on afterwards, so a later dump holds all of this one
+****************************************************************************/
+void ES_RecordDump( void )
+{
+  ES_RecordDumpTo( TERMIO_PutChar );
+}
+
+/****************************************************************************
+ Function
+     ES_RecordDumpTo
+ Parameters
+     void (*pPutByte)(unsigned char), called with each byte of the dump
+ Returns
+     None.
+ Description
+     writes out the stream captured so far, closed off with the passes
+     since the last input and an END record
+ Notes
+     The dump is "ESRC", version, flags (bit 0 set if the capture buffer
+     filled), the stream length (32 bits, LSB first), the stream and then
+     "END!". At 115200 baud it takes about 1mS per 11 bytes.
+****************************************************************************/
+void ES_RecordDumpTo( void (*pPutByte)(unsigned char) )
+{
+  uint8_t Closing[CLOSING_BYTES];
+  uint8_t NumClosing = 0;
+  uint32_t Length;
+  uint32_t i;
+
+  if ( PendingPasses > 0 )
+    NumClosing = EncodeCount( REC_PASS, PendingPasses, Closing );
+  Closing[NumClosing++] = REC_END << KIND_SHIFT;
+  Length = StreamLength + NumClosing;
+
+  PutBytes( pPutByte, DumpHeader, 4 );
+  pPutByte( RECORD_VERSION );
+  pPutByte( Truncated ? FLAG_TRUNCATED : 0 );
+  for ( i = 0; i < 4; i++ )
+    pPutByte( (unsigned char)(Length >> (8 * i)) );
+  for ( i = 0; i < StreamLength; i++ )
+    pPutByte( Stream[i] );
+  for ( i = 0; i < NumClosing; i++ )
+    pPutByte( Closing[i] );
+  PutBytes( pPutByte, DumpTrailer, 4 );
+}
+
+/****************************************************************************
+ Function
+     ES_RecordTicks
+ Parameters
+     uint16_t LiveTicks, the ticks waiting to be taken
+ Returns
+     uint16_t, the number of ticks to run the timers for
+ Description
+     marks the start of a pass through ES_Run and logs or replays the
+     ticks taken on it
+ Notes
+     called by _HW_Process_Pending_Ints. In replay the live ticks are
+     dropped, the recorded ones drive the timers
+****************************************************************************/
+uint16_t ES_RecordTicks( uint16_t LiveTicks )
+{
+  uint16_t Ticks;
+
+  PassCount++;
+  if ( Mode == ES_RECORD_CAPTURE ){
+    PendingPasses++;
+    if ( LiveTicks > 0 ){
+      FlushPasses();
+      if ( StartRecord( REC_TICKS, 0 ) )
+        PutCount( REC_TICKS, LiveTicks );
+    }
+    return LiveTicks;
+  }
+  if ( Mode != ES_RECORD_REPLAY )
+    return LiveTicks;
+
+  // every input from the last pass should have been used by now
+  if ( Next.Kind == REC_END ){
+    EndReplay( "complete" );
+    return 0;
+  }
+  if ( Next.Kind != REC_PASS ){
+    EndReplay( "diverged" );
+    return 0;
+  }
+  Consume();
+  if ( Next.Kind != REC_TICKS )
+    return 0;
+  Ticks = Next.Count;
+  Consume();
+  return Ticks;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordShortTimeouts
+ Parameters
+     uint8_t LiveMask, the short timers that have expired, bit n set for
+       short timer n
+ Returns
+     uint8_t, the short timer timeouts to post
+****************************************************************************/
+uint8_t ES_RecordShortTimeouts( uint8_t LiveMask )
+{
+  uint8_t Mask;
+
+  if ( Mode == ES_RECORD_CAPTURE ){
+    if ( LiveMask != 0 ){
+      FlushPasses();
+      StartRecord( REC_SHORT, LiveMask );
+    }
+    return LiveMask;
+  }
+  if ( Mode != ES_RECORD_REPLAY )
+    return LiveMask;
+  if ( Next.Kind != REC_SHORT )
+    return 0;
+  Mask = Next.Small;
+  Consume();
+  return Mask;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordKeyReady
+ Parameters
+     bool LiveReady, true if a key is waiting
+ Returns
+     bool, true if a key should be read
+ Notes
+     the key itself is logged when it is read, by ES_RecordKey
+****************************************************************************/
+bool ES_RecordKeyReady( bool LiveReady )
+{
+  if ( Mode == ES_RECORD_REPLAY )
+    return ( Next.Kind == REC_KEY );
+  return LiveReady;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordKey
+ Parameters
+     char LiveKey, the key read from the console
+ Returns
+     char, the key to use
+****************************************************************************/
+char ES_RecordKey( char LiveKey )
+{
+  char Key;
+
+  if ( Mode == ES_RECORD_CAPTURE ){
+    FlushPasses();
+    if ( StartRecord( REC_KEY, 0 ) )
+      Stream[StreamLength++] = LiveKey;
+    return LiveKey;
+  }
+  if ( Mode != ES_RECORD_REPLAY )
+    return LiveKey;
+  if ( Next.Kind != REC_KEY ){
+    EndReplay( "diverged" );
+    return 0;
+  }
+  Key = (char)Next.Count;
+  Consume();
+  return Key;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordButton
+ Parameters
+     bool LiveState, the state of the reset button input
+ Returns
+     bool, the button state to use
+ Notes
+     only changes of state are logged
+****************************************************************************/
+bool ES_RecordButton( bool LiveState )
+{
+  if ( Mode == ES_RECORD_CAPTURE ){
+    if ( LiveState != LastButton ){
+      FlushPasses();
+      if ( StartRecord( REC_BUTTON, LiveState ) )
+        LastButton = LiveState;
+    }
+    return LiveState;
+  }
+  if ( Mode != ES_RECORD_REPLAY )
+    return LiveState;
+  if ( Next.Kind == REC_BUTTON ){
+    ReplayButton = (Next.Small != 0);
+    Consume();
+  }
+  return ReplayButton;
+}
+
+/****************************************************************************
+ Function
+     ES_RecordADC
+ Parameters
+     uint32_t Data[], the conversion results from ADC_MultiRead
+     uint8_t NumChannels, how many of them there are
+ Returns
+     None.
+ Description
+     logs the read or, in replay, replaces the results with the recorded ones
+****************************************************************************/
+void ES_RecordADC( uint32_t Data[], uint8_t NumChannels )
+{
+  uint8_t Changed = 0;
+  uint8_t i;
+  int32_t Delta;
+
+  if ( NumChannels > MAX_CHANNELS )
+    NumChannels = MAX_CHANNELS;
+
+  if ( Mode == ES_RECORD_CAPTURE ){
+    for ( i = 0; i < NumChannels; i++ ){
+      if ( Data[i] != LastADC[i] )
+        Changed |= BitNum2SetMask[i];
+    }
+    if ( Changed == 0 ){
+      // run it together with the last read if nothing came in between
+      if ( (PendingPasses == 0) && (LastSameRun != NO_RECORD) &&
+           ((Stream[LastSameRun] & SMALL_MASK) < SMALL_MAX) ){
+        Stream[LastSameRun]++;
+        return;
+      }
+      FlushPasses();
+      if ( StartRecord( REC_ADC_SAME, 1 ) )
+        LastSameRun = StreamLength - 1;
+      return;
+    }
+    FlushPasses();
+    if ( !StartRecord( REC_ADC, Changed ) )
+      return;
+    for ( i = 0; i < NumChannels; i++ ){
+      if ( Changed & BitNum2SetMask[i] ){
+        Delta = (int32_t)(Data[i] - LastADC[i]);
+        // zig-zag the sign into bit 0 so small changes take one byte
+        PutVarint( ((uint32_t)Delta << 1) ^ (uint32_t)(Delta >> 31) );
+        LastADC[i] = Data[i];
+      }
+    }
+    return;
+  }
+  if ( Mode != ES_RECORD_REPLAY )
+    return;
+
+  if ( Next.Kind == REC_ADC ){
+    for ( i = 0; i < MAX_CHANNELS; i++ )
+      LastADC[i] += Next.Delta[i];
+  }else if ( Next.Kind != REC_ADC_SAME ){
+    EndReplay( "diverged" );
+    return;
+  }
+  for ( i = 0; i < NumChannels; i++ )
+    Data[i] = LastADC[i];
+  Consume();
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+// capture side
+static void FlushPasses( void )
+{
+  if ( PendingPasses == 0 )
+    return;
+  if ( StartRecord( REC_PASS, 0 ) )
+    PutCount( REC_PASS, PendingPasses );
+  PendingPasses = 0;
+}
+
+// writes the first byte of a record, if there is room for the whole record
+static bool StartRecord( uint8_t Kind, uint8_t Small )
+{
+  if ( Truncated )
+    return false;
+  if ( StreamLength + MAX_RECORD_BYTES + CLOSING_BYTES > ES_RECORD_SIZE ){
+    Truncated = true;
+    return false;
+  }
+  Stream[StreamLength++] = (Kind << KIND_SHIFT) | Small;
+  LastSameRun = NO_RECORD;
+  return true;
+}
+
+// fills in the count of a record that StartRecord began with a small of 0
+static void PutCount( uint8_t Kind, uint32_t Count )
+{
+  StreamLength--;
+  StreamLength += EncodeCount( Kind, Count, &Stream[StreamLength] );
+}
+
+static void PutVarint( uint32_t Value )
+{
+  while ( Value > 0x7F ){
+    Stream[StreamLength++] = (Value & 0x7F) | BIT7HI;
+    Value >>= 7;
+  }
+  Stream[StreamLength++] = Value;
+}
+
+static uint8_t EncodeCount( uint8_t Kind, uint32_t Count, uint8_t *pBytes )
+{
+  uint8_t NumBytes = 1;
+
+  if ( Count <= SMALL_MAX ){
+    pBytes[0] = (Kind << KIND_SHIFT) | Count;
+    return NumBytes;
+  }
+  pBytes[0] = Kind << KIND_SHIFT;
+  while ( Count > 0x7F ){
+    pBytes[NumBytes++] = (Count & 0x7F) | BIT7HI;
+    Count >>= 7;
+  }
+  pBytes[NumBytes++] = Count;
+  return NumBytes;
+}
+
+// replay side
+static void ReadNext( void )
+{
+  uint8_t Byte;
+  uint8_t i;
+  uint32_t Zigzag;
+
+  if ( ReplayIndex >= ReplayLength ){
+    Next.Kind = REC_END;
+    return;
+  }
+  Byte = pReplay[ReplayIndex++];
+  Next.Kind = Byte >> KIND_SHIFT;
+  Next.Small = Byte & SMALL_MASK;
+  Next.Count = Next.Small;
+  switch ( Next.Kind ){
+    case REC_PASS:
+    case REC_TICKS:
+      if ( Next.Small == 0 )
+        Next.Count = GetVarint();
+      break;
+    case REC_KEY:
+      Next.Count = (ReplayIndex < ReplayLength) ? pReplay[ReplayIndex++] : 0;
+      break;
+    case REC_ADC:
+      for ( i = 0; i < MAX_CHANNELS; i++ ){
+        Next.Delta[i] = 0;
+        if ( Next.Small & BitNum2SetMask[i] ){
+          Zigzag = GetVarint();
+          Next.Delta[i] = (int32_t)(Zigzag >> 1) ^ -(int32_t)(Zigzag & 1);
+        }
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static uint32_t GetVarint( void )
+{
+  uint32_t Value = 0;
+  uint8_t Shift = 0;
+  uint8_t Byte;
+
+  do{
+    if ( ReplayIndex >= ReplayLength )
+      return Value;
+    Byte = pReplay[ReplayIndex++];
+    Value |= (uint32_t)(Byte & 0x7F) << Shift;
+    Shift += 7;
+  }while ( Byte & BIT7HI );
+  return Value;
+}
+
+// uses up one pass or read of a run, or the whole of any other record
+static void Consume( void )
+{
+  if ( ((Next.Kind == REC_PASS) || (Next.Kind == REC_ADC_SAME)) &&
+       (--Next.Count > 0) )
+    return;
+  ReadNext();
+}
+
+static void EndReplay( const char *pWhy )
+{
+  printf("\r\nES_Record: replay %s on pass %lu\r\n", pWhy,
+         (unsigned long)PassCount);
+  Ended = true;
+  Mode = ES_RECORD_OFF;
+}
+
+static void PutBytes( void (*pPutByte)(unsigned char), const char *pBytes,
+                      uint8_t NumBytes )
+{
+  while ( NumBytes-- > 0 )
+    pPutByte( *pBytes++ );
+}
+
+#endif /* ES_USE_RECORD */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
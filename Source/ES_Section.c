@@ -0,0 +1,159 @@
+/****************************************************************************
+ Module
+     ES_Section.c
+
+ Description
+     This is a module implementing a profiler for named sections of code.
+     Each section in SECTION_LIST keeps the number of times that it was run
+     and the least, most and total cycles that it took, from ES_Cycles.
+
+ Notes
+     ES_SECTION_BEGIN reads the cycle count into a local and ES_SECTION_END
+     hands the difference to ES_SectionAdd, so a pass costs two reads of the
+     count and one call, which is all that ends up in MinCycles for an empty
+     section. ES_SectionAdd updates the stats in a critical region, so
+     sections may also be timed in interrupt responses, but with
+     ES_USE_BASEPRI not in one above ES_CRITICAL_PRIORITY.
+     Passes longer than the 107 second wrap of the count are not timed
+     correctly.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include <stdio.h>
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_Section.h"
+
+#ifdef ES_USE_SECTIONS
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+#define SECTION_NAME(_name_) #_name_,
+
+/*------------------------------ Module Types -----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+
+/*---------------------------- Module Variables ---------------------------*/
+static const char * const SectionNames[] = { SECTION_LIST(SECTION_NAME) };
+static ES_SectionStats_t Sections[ES_NUM_SECTIONS];
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_SectionAdd
+ Parameters
+     ES_SectionId_t : the section that was run, ES_SECTION_<name>
+     uint32_t : the cycles that it took
+ Returns
+     None
+ Description
+     adds one pass of the section to its stats
+ Notes
+     called by ES_SECTION_END
+****************************************************************************/
+void ES_SectionAdd( ES_SectionId_t WhichSection, uint32_t Cycles )
+{
+  ES_SectionStats_t *pStats = &Sections[WhichSection];
+
+  EnterCritical();
+  if ( (pStats->NumPasses == 0) || (Cycles < pStats->MinCycles) )
+    pStats->MinCycles = Cycles;
+  if ( Cycles > pStats->MaxCycles )
+    pStats->MaxCycles = Cycles;
+  pStats->TotalCycles += Cycles;
+  pStats->NumPasses++;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_GetSectionStats
+ Parameters
+     ES_SectionId_t : the section to report on
+     ES_SectionStats_t * : where to put a copy of its stats
+ Returns
+     bool : false if WhichSection is out of range
+ Description
+     copies out the stats for one section
+ Notes
+
+****************************************************************************/
+bool ES_GetSectionStats( ES_SectionId_t WhichSection,
+                         ES_SectionStats_t *pStats )
+{
+  if ( WhichSection >= ES_NUM_SECTIONS )
+    return false;
+  EnterCritical();
+  *pStats = Sections[WhichSection];
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_ClearSections
+ Parameters
+     None
+ Returns
+     None
+ Description
+     zeros the stats for all of the sections
+ Notes
+
+****************************************************************************/
+void ES_ClearSections( void )
+{
+  uint8_t i;
+
+  for ( i = 0; i < ES_NUM_SECTIONS; i++ ){
+    EnterCritical();
+    Sections[i] = (ES_SectionStats_t){ 0 };
+    ExitCritical();
+  }
+}
+
+/****************************************************************************
+ Function
+     ES_DumpSections
+ Parameters
+     None
+ Returns
+     None
+ Description
+     prints the stats for all of the sections to the console, one line per
+     section, in cycles of the CPU clock, with the mean in uS as well
+ Notes
+     This uses printf, so call it from a run function, not from an
+     interrupt response
+****************************************************************************/
+void ES_DumpSections( void )
+{
+  uint8_t i;
+  ES_SectionStats_t ThisSection;
+  uint32_t MeanCycles;
+  uint32_t MeanTenths;   // of a uS
+
+  printf("\r\nSection                  Passes   MinCyc  MeanCyc   MaxCyc"
+         "    MeanuS\r\n");
+  for ( i = 0; i < ES_NUM_SECTIONS; i++ ){
+    ES_GetSectionStats( (ES_SectionId_t)i, &ThisSection );
+    MeanCycles = 0;
+    if ( ThisSection.NumPasses != 0 )
+      MeanCycles = (uint32_t)(ThisSection.TotalCycles /
+                                                  ThisSection.NumPasses);
+    MeanTenths = (uint32_t)(((uint64_t)MeanCycles * 10 + ES_CYCLES_PER_uS / 2)
+                            / ES_CYCLES_PER_uS);
+    printf("%-22s %8lu %8lu %8lu %8lu %7lu.%lu\r\n", SectionNames[i],
+           (unsigned long)ThisSection.NumPasses,
+           (unsigned long)ThisSection.MinCycles, (unsigned long)MeanCycles,
+           (unsigned long)ThisSection.MaxCycles,
+           (unsigned long)(MeanTenths / 10), (unsigned long)(MeanTenths % 10));
+  }
+}
+#endif /* ES_USE_SECTIONS */
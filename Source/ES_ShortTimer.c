@@ -4,26 +4,38 @@
    ES_ShortTimer.c
 
  Revision
-   1.0.1
+   2.0.0
 
  Description
-   This is a library to provide for the creation of short time-outs 
-   (shorter than the resolution of the ES_Timer library). 
+   This is a library to provide for the creation of short time-outs
+   (shorter than the resolution of the ES_Timer library). Up to
+   ES_NUM_SHORT_TIMERS timers, to the uS, each posting ES_SHORT_TIMEOUT to
+   its own service, all share one hardware timer.
 
  Notes
    This module uses the Tiva Peripheral Driver Library functions and
    the ability that it provides to 'hook' a function into an interrupt
    response routine without modifying the vector table directly.
-   Uses timers A & B on 16/32 bit Timer Module 5
-   
+   Uses timer A of 16/32 bit Timer Module 5 as a single 32 bit timer that
+   counts up at the 40MHz system clock and wraps round every 107 seconds.
+   The running timers are kept in a list in the order that they are due,
+   and the match register holds the count at which the first is due. The
+   match interrupt posts the timeouts of every timer that is due and moves
+   the match on to the next one. Counts are compared by their difference,
+   so the wrap does no harm to timeouts of up to half of it.
+   A timer started too close to its timeout for the match to catch it pends
+   the match interrupt instead, so that every timeout is posted from the
+   interrupt response, whether straight to the service, through the
+   ShortTimer channel or through the input recorder.
+
  History
  When           Who     What/Why
  -------------- ---     --------
  10/11/15 10:30 jec     first pass
  10/11/15 18:10 jec     converted to post events to the framework
- 
+
 ****************************************************************************/
-// the common headers for I/O, C99 types 
+// the common headers for I/O, C99 types
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -50,124 +62,250 @@
 // the framework headers
 #include "ES_Framework.h"
 #include "ES_Configure.h"
+#include "ES_ServiceHeaders.h"
+
+#if ES_NUM_SHORT_TIMERS > 32
+#error "ES_NUM_SHORT_TIMERS must be no more than 32"
+#endif
+#if defined(ES_USE_RECORD) && (ES_NUM_SHORT_TIMERS > 5)
+#error "ES_USE_RECORD logs the short timeouts as a 5 bit mask"
+#endif
 
+// module level defines
 
-// module level functions
+// the timer counts the 40MHz clock
+#define CYCLES_PER_uS 40
+// the longest timeout, half the wrap of the count
+#define MAX_MICROS (0x7FFFFFFFUL / CYCLES_PER_uS)
+// a timer due this close to the count is taken as due now, as the count
+// could pass the match before the match register was written
+#define MIN_LEAD (2 * CYCLES_PER_uS)
+#define NONE ES_SHORT_TIMER_NONE
 
-// define for the timer pre-scaler. this sets the resolution of the
-// timing functions
-// the current values are based on a 40mHz clock rate to give 1uS resolution
-#define PRE_1uS 40
+// module level types
+
+typedef struct {
+  uint32_t Due;             // the count at which it times out
+  ES_ShortTimer_t Next;     // the timer due after it, while running
+  uint8_t Service;          // the service to post its timeouts to
+  bool Running;
+} ShortTimer_t;
+
+// module level functions
 
 void ShortTimerAHandler(void);
-void ShortTimerBHandler(void);
+static void HardwareInit(void);
+static bool IsDue(ES_ShortTimer_t Which, uint32_t Now);
+static void Link(ES_ShortTimer_t Which);
+static void Unlink(ES_ShortTimer_t Which);
+#if defined(ES_USE_ISR_CHANNELS) && !defined(ES_USE_RECORD)
+static void ChannelShortTimeout(ES_ShortTimer_t Which);
+#else
+static void PostShortTimeout(ES_ShortTimer_t Which);
+#endif
 
 // module level variables
 
-static uint8_t Timer_A_Priority = SHORT_TIMER_UNUSED;
-static uint8_t Timer_B_Priority = SHORT_TIMER_UNUSED;
+static ShortTimer_t Timers[ES_NUM_SHORT_TIMERS];
+static uint8_t NumTimers;
+// the first of the running timers to be due
+static ES_ShortTimer_t Head = NONE;
+#ifdef ES_USE_RECORD
+// timeouts waiting for ES_ShortTimerPostPending, a bit for each timer
+static volatile uint32_t PendingTimeouts;
+#endif
 
 //******************************
-// ES_ShortTimerInit()
-// Initialize the timer subsystem and log the services to which the timeout
-// messages will be posted
+// ES_ShortTimerCreate()
+// Set up a new short timer that posts its timeouts to WhichService, and
+// start the hardware timer when the first one is made. Returns
+// ES_SHORT_TIMER_NONE when the service does not exist or all
+// ES_NUM_SHORT_TIMERS have been made. Call it from the service init
 //******************************
-void ES_ShortTimerInit(uint8_t TimeAPrio, uint8_t TimeBPrio){
-#ifdef DEBUG
-// set up I/O lines for debugging
-  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
-  GPIOPinTypeGPIOOutput(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1);
-// start with the lines low
-  GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_0 | GPIO_PIN_1, BIT0LO & BIT1LO);  
-#endif  
-
-// enable the clock to the timer module  
-  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER5); 
-// configure as 2 16 bit timers  
-  TimerConfigure(TIMER5_BASE, TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_ONE_SHOT | 
-                 TIMER_CFG_B_ONE_SHOT);
-// set prescale to get 1uS resolution  
-  TimerPrescaleSet(TIMER5_BASE, TIMER_BOTH, PRE_1uS);
-// log the service to which the timeout will be posted
-  Timer_A_Priority = TimeAPrio;
-  Timer_B_Priority = TimeAPrio;
-      
+ES_ShortTimer_t ES_ShortTimerCreate(uint8_t WhichService){
+  if ((WhichService >= NUM_SERVICES) || (NumTimers >= ES_NUM_SHORT_TIMERS))
+    return ES_SHORT_TIMER_NONE;
+  if (NumTimers == 0)
+    HardwareInit();
+  Timers[NumTimers].Service = WhichService;
+  Timers[NumTimers].Running = false;
+  return NumTimers++;
 }
 
-void ES_ShortTimerStart( uint32_t Which, uint16_t TimeoutValue){
-  if ((Which != TIMER_A) && (Which != TIMER_B))
-    return;
-  // for very short delays. just immediatly post. There is 10us of overhead
-  if( TimeoutValue < 11){
-    if(Which == TIMER_A){
-      ShortTimerAHandler();
-    }else{
-      ShortTimerBHandler();
-    }
-  }
-  TimerLoadSet(TIMER5_BASE, Which, TimeoutValue);
-  
-  if(Which == TIMER_A)
-  { // local enable
-    TimerIntEnable(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
-    // NVIC Enable
-    IntEnable(INT_TIMER5A_TM4C123);
-  }else{
-    // local enable
-    TimerIntEnable(TIMER5_BASE, TIMER_TIMB_TIMEOUT);
-    // NVIC Enable
-    IntEnable(INT_TIMER5B_TM4C123);
+//******************************
+// ES_ShortTimerStart()
+// (Re)start the timer to post a timeout Micros uS from now. Returns false
+// if the timer does not exist or Micros is over MAX_MICROS (53 seconds)
+//******************************
+bool ES_ShortTimerStart(ES_ShortTimer_t Which, uint32_t Micros){
+  if ((Which >= NumTimers) || (Micros > MAX_MICROS))
+    return false;
+  EnterCritical();
+  if (Timers[Which].Running)
+    Unlink(Which);
+  Timers[Which].Due = TimerValueGet(TIMER5_BASE, TIMER_A) +
+                      Micros * CYCLES_PER_uS;
+  Link(Which);
+  if (Head == Which){
+    TimerMatchSet(TIMER5_BASE, TIMER_A, Timers[Which].Due);
+    // for very short delays, leave it to the interrupt response at once
+    if (IsDue(Which, TimerValueGet(TIMER5_BASE, TIMER_A)))
+      IntPendSet(INT_TIMER5A_TM4C123);
   }
-  
-  TimerEnable(TIMER5_BASE, Which);
+  ExitCritical();
+  return true;
+}
 
-#ifdef DEBUG
-// raise I/O line to show we started
-  if( Which == TIMER_A)
-    GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0HI);
-  else
-    GPIOPinWrite(GPIO_PORTB_BASE, BIT1HI, BIT1HI);    
-#endif
-  return;
+//******************************
+// ES_ShortTimerStop()
+// Stop the timer, if it is running. The match may still come, and then
+// finds nothing due. Returns false if the timer does not exist
+//******************************
+bool ES_ShortTimerStop(ES_ShortTimer_t Which){
+  if (Which >= NumTimers)
+    return false;
+  EnterCritical();
+  if (Timers[Which].Running)
+    Unlink(Which);
+  ExitCritical();
+  return true;
 }
 
+//******************************
+// ES_ShortTimerIsRunning()
+// true if the timer exists and has not yet timed out
+//******************************
+bool ES_ShortTimerIsRunning(ES_ShortTimer_t Which){
+  return (Which < NumTimers) && Timers[Which].Running;
+}
+
+// the match interrupt response: post every timer that is due and set the
+// match for the next, going round again if that is due by the time it is set
 void ShortTimerAHandler(void){
-  ES_Event ThisEvent;
+  ES_ShortTimer_t Which;
 
 // start by clearing the source of the interrupt
-    TimerIntClear(TIMER5_BASE, TIMER_TIMA_TIMEOUT);
+  TimerIntClear(TIMER5_BASE, TIMER_TIMA_MATCH);
 #ifdef DEBUG
-// lower I/O line to show we arrived
-  GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0LO);  
+// raise I/O line to show we arrived
+  GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0HI);
 #endif
- 
-// post the timeout for this timer  
-  ThisEvent.EventType = ES_SHORT_TIMEOUT;
-  ThisEvent.EventParam = TIMER_A;
-// protect against timer that was not correctly initialized  
-  if (Timer_A_Priority != SHORT_TIMER_UNUSED)
-  {
-    ES_PostToService( Timer_A_Priority, ThisEvent);
+  do {
+    while ((Head != NONE) &&
+           IsDue(Head, TimerValueGet(TIMER5_BASE, TIMER_A))){
+      Which = Head;
+      Unlink(Which);
+#if defined(ES_USE_RECORD)
+// leave the post to ES_ShortTimerPostPending, so it can be recorded
+      PendingTimeouts |= (1UL << Which);
+#elif defined(ES_USE_ISR_CHANNELS)
+// leave the post to _HW_Process_Pending_Ints, without turning ints off
+      ChannelShortTimeout(Which);
+#else
+      PostShortTimeout(Which);
+#endif
+    }
+    if (Head == NONE)
+      break;
+    TimerMatchSet(TIMER5_BASE, TIMER_A, Timers[Head].Due);
+  } while (IsDue(Head, TimerValueGet(TIMER5_BASE, TIMER_A)));
+#ifdef DEBUG
+// lower I/O line to show we are done
+  GPIOPinWrite(GPIO_PORTB_BASE, BIT0HI, BIT0LO);
+#endif
+}
+
+#ifdef ES_USE_RECORD
+// called from _HW_Process_Pending_Ints to post the timeouts that have
+// occurred since the last call, through the input recorder
+void ES_ShortTimerPostPending(void){
+  uint32_t Timeouts;
+  ES_ShortTimer_t Which;
+
+  EnterCritical();
+  Timeouts = PendingTimeouts;
+  PendingTimeouts = 0;
+  ExitCritical();
+  Timeouts = ES_INPUT_SHORT_TIMEOUTS((uint8_t)Timeouts);
+  for (Which = 0; Timeouts != 0; Which++, Timeouts >>= 1){
+    if (Timeouts & BIT0HI)
+      PostShortTimeout(Which);
   }
 }
+#endif
+
+// set up timer A of Timer 5 as a 32 bit count up timer with a match
+// interrupt, and start it counting
+static void HardwareInit(void){
+#ifdef DEBUG
+// set up I/O line for debugging
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
+  GPIOPinTypeGPIOOutput(GPIO_PORTB_BASE, GPIO_PIN_0);
+// start with the line low
+  GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_0, BIT0LO);
+#endif
+
+// enable the clock to the timer module
+  SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER5);
+// configure as a 32 bit timer counting up from 0 to all 1s and round again
+  TimerConfigure(TIMER5_BASE, TIMER_CFG_PERIODIC_UP);
+  TimerLoadSet(TIMER5_BASE, TIMER_A, 0xFFFFFFFF);
+// TimerConfigure leaves the match interrupt off, TAMIE lets it through
+  HWREG(TIMER5_BASE + TIMER_O_TAMR) |= TIMER_TAMR_TAMIE;
+// local enable
+  TimerIntEnable(TIMER5_BASE, TIMER_TIMA_MATCH);
+// NVIC Enable
+  IntEnable(INT_TIMER5A_TM4C123);
+  TimerEnable(TIMER5_BASE, TIMER_A);
+}
+
+// true if the timer is due at the count Now, or too close to be caught by
+// the match
+static bool IsDue(ES_ShortTimer_t Which, uint32_t Now){
+  return (int32_t)(Timers[Which].Due - Now) <= MIN_LEAD;
+}
+
+// put a stopped timer into the running list after those due before it or
+// at the same count. Call with interrupts off
+static void Link(ES_ShortTimer_t Which){
+  ES_ShortTimer_t *pNext = &Head;
 
-void ShortTimerBHandler(void){
+  while ((*pNext != NONE) &&
+         ((int32_t)(Timers[*pNext].Due - Timers[Which].Due) <= 0))
+    pNext = &Timers[*pNext].Next;
+  Timers[Which].Next = *pNext;
+  *pNext = Which;
+  Timers[Which].Running = true;
+}
+
+// take a running timer out of the list. Call with interrupts off
+static void Unlink(ES_ShortTimer_t Which){
+  ES_ShortTimer_t *pNext = &Head;
+
+  while (*pNext != Which)
+    pNext = &Timers[*pNext].Next;
+  *pNext = Timers[Which].Next;
+  Timers[Which].Running = false;
+}
+
+#if !defined(ES_USE_ISR_CHANNELS) || defined(ES_USE_RECORD)
+static void PostShortTimeout(ES_ShortTimer_t Which){
   ES_Event ThisEvent;
 
-// start by clearing the source of the interrupt
-    TimerIntClear(TIMER5_BASE, TIMER_TIMB_TIMEOUT);
-#ifdef DEBUG
-// lower I/O line to show we arrived
-  GPIOPinWrite(GPIO_PORTB_BASE, BIT1HI, BIT1LO);    
-#endif 
-  
-// post the timeout for this timer  
+// post the timeout for this timer
   ThisEvent.EventType = ES_SHORT_TIMEOUT;
-  ThisEvent.EventParam = TIMER_B;
-// protect against timer that was not correctly initialized  
-  if (Timer_B_Priority != SHORT_TIMER_UNUSED)
-  {
-    ES_PostToService( Timer_B_Priority, ThisEvent);
-  }
-  
+  ThisEvent.EventParam = Which;
+  ES_PostToService( Timers[Which].Service, ThisEvent);
 }
+
+#else
+// the interrupt response version of PostShortTimeout, through the short
+// timer channel
+static void ChannelShortTimeout(ES_ShortTimer_t Which){
+  ES_Event ThisEvent;
+
+  ThisEvent.EventType = ES_SHORT_TIMEOUT;
+  ThisEvent.EventParam = Which;
+  ES_ChannelPost( ES_CHANNEL_ShortTimer, Timers[Which].Service, ThisEvent);
+}
+#endif
@@ -0,0 +1,484 @@
+/****************************************************************************
+ Module
+     ES_SpscQueue.c
+
+ Description
+     This is a module implementing the ES_Queue functions (ES_Queue.h) as
+     lock-free single producer, single consumer rings, for use in place of
+     ES_Queue.c when ES_USE_SPSC_QUEUE is defined.
+
+ Notes
+     The queue header takes the first ES_QUEUE_HEADER_SLOTS entries of the
+     block and the ring is the largest power of 2 that fits in the rest, so
+     a block declared with ES_QUEUE_BLOCK_SIZE(n) holds at least n events.
+     Head counts the events taken out and Tail the events put in. Both run
+     freely and wrap at 65536: their difference is the number waiting and
+     an entry is found by masking, so there is no % on any path and the
+     capacity is limited only by the 16 bit counts (32768).
+     Only the producer writes Tail and only the consumer writes Head, so
+     ES_EnQueueFIFO, ES_EnQueueBatch, ES_DeQueue and ES_DeQueueBatch need
+     no critical region when each side is a single thread of control, for
+     example an interrupt response feeding a run function. A memory barrier
+     orders the entries against the count that publishes them.
+     ES_EnQueueLIFO, ES_EnQueueBatchLIFO and ES_EnQueuePolicy also move
+     Head, or rewrite entries that the consumer may be reading, so they use
+     a critical region and are only safe when the consumer runs at the same
+     level as the caller. That is the case for the framework's queues, where
+     every post comes from thread level (ES_USE_ISR_CHANNELS), which is why
+     this option needs ES_USE_ISR_CHANNELS and can not be used with
+     ES_USE_PREEMPTION.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_Queue.h"
+#include <string.h>
+
+#ifdef ES_USE_SPSC_QUEUE
+
+#ifndef ES_USE_ISR_CHANNELS
+#error "ES_USE_SPSC_QUEUE needs ES_USE_ISR_CHANNELS, so that all posts come from thread level"
+#endif
+#ifdef ES_USE_PREEMPTION
+#error "ES_USE_SPSC_QUEUE can not be used with ES_USE_PREEMPTION, where posts nest"
+#endif
+
+/*----------------------------- Module Defines ----------------------------*/
+// Mask is the ring size - 1, Head and Tail are the free running counts of
+// events taken out and put in
+typedef struct {  uint16_t Mask;
+                  volatile uint16_t Head;
+                  volatile uint16_t Tail;
+} ES_SpscQueue_t;
+
+typedef ES_SpscQueue_t * pSpscQueue_t;
+
+// a negative array size stops the build if the header outgrows its slots
+typedef char ES_SpscHeaderCheck_t[(sizeof(ES_SpscQueue_t) <=
+                          ES_QUEUE_HEADER_SLOTS * sizeof(ES_Event)) ? 1 : -1];
+
+// the ring starts after the header slots
+#define ENTRY(_block_, _count_) \
+  ((_block_)[ ES_QUEUE_HEADER_SLOTS + \
+             ((_count_) & ((pSpscQueue_t)(_block_))->Mask) ])
+
+/*---------------------------- Module Functions ---------------------------*/
+static void CopyToRing( ES_Event * pBlock, uint16_t Count,
+                        const ES_Event * pEvents, uint16_t NumEvents );
+static void CopyFromRing( ES_Event * pBlock, uint16_t Count,
+                          ES_Event * pEvents, uint16_t NumEvents );
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+   ES_InitQueue
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory to use for the Queue
+   ES_QueueIndex_t BlockSize: size of the block pointed to by pBlock
+ Returns
+   max number of entries in the created queue
+ Description
+   sets up the queue header in the first ES_QUEUE_HEADER_SLOTS entries of
+   the block and uses the largest power of 2 entries that fit after it
+ Notes
+   declare the block with ES_QUEUE_BLOCK_SIZE(n) entries to get room for at
+   least n events
+****************************************************************************/
+ES_QueueIndex_t ES_InitQueue( ES_Event * pBlock, ES_QueueIndex_t BlockSize )
+{
+   pSpscQueue_t pThisQueue;
+   uint16_t Size = 1;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   while ( (Size < 0x8000u) &&
+           ((uint32_t)Size * 2 + ES_QUEUE_HEADER_SLOTS <= BlockSize) )
+      Size *= 2;
+   pThisQueue->Mask = Size - 1;
+   pThisQueue->Head = 0;
+   pThisQueue->Tail = 0;
+   return(Size);
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueFIFO
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event Event2Add : event to be added to the Queue
+ Returns
+   bool : true if the add was successful, false if not
+ Description
+   if it will fit, adds Event2Add to the Queue
+ Notes
+   the producer side of the ring, no critical region
+****************************************************************************/
+bool ES_EnQueueFIFO( ES_Event * pBlock, ES_Event Event2Add )
+{
+   pSpscQueue_t pThisQueue;
+   uint16_t Tail;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   Tail = pThisQueue->Tail;
+   if ( (uint16_t)(Tail - pThisQueue->Head) > pThisQueue->Mask )
+      return(false);
+   ENTRY(pBlock, Tail) = Event2Add;
+   ES_MEMORY_BARRIER();  // the entry must be there before the count says so
+   pThisQueue->Tail = Tail + 1;
+   return(true);
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueFIFOInCritical
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event Event2Add : event to be added to the Queue
+ Returns
+   bool : true if the add was successful, false if not
+ Description
+   the same as ES_EnQueueFIFO, which has no critical region of its own
+ Notes
+
+****************************************************************************/
+bool ES_EnQueueFIFOInCritical( ES_Event * pBlock, ES_Event Event2Add )
+{
+   return ES_EnQueueFIFO( pBlock, Event2Add );
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueLIFO
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event Event2Add : event to be added to the Queue
+ Returns
+   bool : true if the add was successful, false if not
+ Description
+   if it will fit, adds Event2Add to the Queue at the extraction point, making
+   it the next event to be removed by a DeQueue operation
+ Notes
+   this moves Head, the consumer's count, so it must not be used while the
+   consumer may be in ES_DeQueue
+****************************************************************************/
+bool ES_EnQueueLIFO( ES_Event * pBlock, ES_Event Event2Add )
+{
+   pSpscQueue_t pThisQueue;
+   bool ReturnVal = false;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   EnterCritical();   // save interrupt state, turn ints off
+   if ( (uint16_t)(pThisQueue->Tail - pThisQueue->Head) <= pThisQueue->Mask ){
+      ENTRY(pBlock, pThisQueue->Head - 1) = Event2Add;
+      pThisQueue->Head--;
+      ReturnVal = true;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueuePolicy
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event Event2Add : event to be added to the Queue
+   ES_QueuePolicy_t Policy : what to do if the Queue is full
+   ES_Event * pLost : used to return the event that made room for Event2Add
+ Returns
+   bool : true if Event2Add is now in the Queue, false if not
+ Description
+   as ES_EnQueuePolicy in ES_Queue.c
+ Notes
+   dropping the oldest event moves Head, and coalescing rewrites an entry
+   the consumer may be about to read, so this must not be used while the
+   consumer may be in ES_DeQueue
+****************************************************************************/
+bool ES_EnQueuePolicy( ES_Event * pBlock, ES_Event Event2Add,
+                       ES_QueuePolicy_t Policy, ES_Event * pLost )
+{
+   pSpscQueue_t pThisQueue;
+   uint16_t Count;
+   bool ReturnVal = true;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   pLost->EventType = ES_NO_EVENT;
+   pLost->EventParam = 0;
+   EnterCritical();   // save interrupt state, turn ints off
+   Count = pThisQueue->Tail;   // past the end, unless a match is found
+   if ( Policy == ES_QUEUE_COALESCE ){
+      for ( Count = pThisQueue->Head; Count != pThisQueue->Tail; Count++ ){
+         if ( ENTRY(pBlock, Count).EventType == Event2Add.EventType )
+            break;
+      }
+   }
+   if ( Count != pThisQueue->Tail ){   // found one to coalesce with
+      *pLost = ENTRY(pBlock, Count);
+      ENTRY(pBlock, Count) = Event2Add;
+   }else if ( (uint16_t)(pThisQueue->Tail - pThisQueue->Head) <=
+                                                         pThisQueue->Mask ){
+      ENTRY(pBlock, pThisQueue->Tail) = Event2Add;
+      pThisQueue->Tail++;
+   }else if ( Policy == ES_QUEUE_DROP_OLDEST ){
+      *pLost = ENTRY(pBlock, pThisQueue->Head);
+      pThisQueue->Head++;
+      ENTRY(pBlock, pThisQueue->Tail) = Event2Add;
+      pThisQueue->Tail++;
+   }else if ( Policy == ES_QUEUE_OVERWRITE_NEWEST ){
+      *pLost = ENTRY(pBlock, pThisQueue->Tail - 1);
+      ENTRY(pBlock, pThisQueue->Tail - 1) = Event2Add;
+   }else
+      ReturnVal = false;
+   ExitCritical();  // restore saved interrupt state
+   return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueBatch
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   const ES_Event * pEvents : the events to be added, oldest first
+   ES_QueueIndex_t NumEvents : how many events there are at pEvents
+ Returns
+   bool : true if the events were added, false if there was not room for all
+          of them, in which case none are added
+ Description
+   as ES_EnQueueBatch in ES_Queue.c
+ Notes
+   the producer side of the ring, no critical region. The consumer sees
+   all of the events at once, when Tail moves
+****************************************************************************/
+bool ES_EnQueueBatch( ES_Event * pBlock, const ES_Event * pEvents,
+                      ES_QueueIndex_t NumEvents )
+{
+   pSpscQueue_t pThisQueue;
+   uint16_t Tail;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   Tail = pThisQueue->Tail;
+   if ( NumEvents > (uint16_t)(pThisQueue->Mask + 1 -
+                               (uint16_t)(Tail - pThisQueue->Head)) )
+      return(false);
+   CopyToRing( pBlock, Tail, pEvents, NumEvents );
+   ES_MEMORY_BARRIER();  // the entries must be there before the count says so
+   pThisQueue->Tail = Tail + NumEvents;
+   return(true);
+}
+
+/****************************************************************************
+ Function
+   ES_EnQueueBatchLIFO
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   const ES_Event * pEvents : the events to be added
+   ES_QueueIndex_t NumEvents : how many events there are at pEvents
+ Returns
+   bool : true if the events were added, false if there was not room for all
+          of them, in which case none are added
+ Description
+   as ES_EnQueueBatchLIFO in ES_Queue.c
+ Notes
+   this moves Head, the consumer's count, so it must not be used while the
+   consumer may be in ES_DeQueue
+****************************************************************************/
+bool ES_EnQueueBatchLIFO( ES_Event * pBlock, const ES_Event * pEvents,
+                          ES_QueueIndex_t NumEvents )
+{
+   pSpscQueue_t pThisQueue;
+   bool ReturnVal = false;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   EnterCritical();   // save interrupt state, turn ints off
+   if ( NumEvents <= (uint16_t)(pThisQueue->Mask + 1 -
+                     (uint16_t)(pThisQueue->Tail - pThisQueue->Head)) ){
+      CopyToRing( pBlock, (uint16_t)(pThisQueue->Head - NumEvents), pEvents,
+                  NumEvents );
+      pThisQueue->Head -= NumEvents;
+      ReturnVal = true;
+   }
+   ExitCritical();  // restore saved interrupt state
+   return ReturnVal;
+}
+
+/****************************************************************************
+ Function
+   ES_DeQueue
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event * pReturnEvent : used to return the event pulled from the queue
+ Returns
+   The number of entries remaining in the Queue
+ Description
+   pulls next available entry from Queue, ES_NO_EVENT if Queue was empty and
+   copies it to *pReturnEvent.
+ Notes
+   the consumer side of the ring, no critical region
+****************************************************************************/
+ES_QueueIndex_t ES_DeQueue( ES_Event * pBlock, ES_Event * pReturnEvent )
+{
+   pSpscQueue_t pThisQueue;
+   uint16_t Head;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   Head = pThisQueue->Head;
+   if ( Head == pThisQueue->Tail ){ // no items left in the queue
+      (*pReturnEvent).EventType = ES_NO_EVENT;
+      (*pReturnEvent).EventParam = 0;
+      return 0;
+   }
+   ES_MEMORY_BARRIER();  // read the entry only after seeing the count
+   *pReturnEvent = ENTRY(pBlock, Head);
+   ES_MEMORY_BARRIER();  // and finish reading it before giving it back
+   pThisQueue->Head = ++Head;
+   return (uint16_t)(pThisQueue->Tail - Head);
+}
+
+/****************************************************************************
+ Function
+   ES_DeQueueBatch
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   ES_Event * pEvents : where to put the events pulled from the Queue
+   ES_QueueIndex_t MaxEvents : the most events to pull
+ Returns
+   ES_QueueIndex_t : the number of events pulled, 0 if the Queue was empty
+ Description
+   as ES_DeQueueBatch in ES_Queue.c
+ Notes
+   the consumer side of the ring, no critical region
+****************************************************************************/
+ES_QueueIndex_t ES_DeQueueBatch( ES_Event * pBlock, ES_Event * pEvents,
+                                 ES_QueueIndex_t MaxEvents )
+{
+   pSpscQueue_t pThisQueue;
+   uint16_t Head;
+   uint16_t NumTaken;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   Head = pThisQueue->Head;
+   NumTaken = (uint16_t)(pThisQueue->Tail - Head);
+   if ( NumTaken == 0 )
+      return 0;
+   if ( NumTaken > MaxEvents )
+      NumTaken = MaxEvents;
+   ES_MEMORY_BARRIER();  // read the entries only after seeing the count
+   CopyFromRing( pBlock, Head, pEvents, NumTaken );
+   ES_MEMORY_BARRIER();  // and finish reading them before giving them back
+   pThisQueue->Head = Head + NumTaken;
+   return NumTaken;
+}
+
+/****************************************************************************
+ Function
+   ES_IsQueueEmpty
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   bool : true if Queue is empty
+ Description
+   see above
+ Notes
+
+****************************************************************************/
+bool ES_IsQueueEmpty( ES_Event * pBlock )
+{
+   pSpscQueue_t pThisQueue;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   return(pThisQueue->Head == pThisQueue->Tail);
+}
+
+/****************************************************************************
+ Function
+   ES_QueueDepth
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+ Returns
+   ES_QueueIndex_t : the number of entries currently in the Queue
+ Description
+   see above
+ Notes
+
+****************************************************************************/
+ES_QueueIndex_t ES_QueueDepth( ES_Event * pBlock )
+{
+   pSpscQueue_t pThisQueue;
+
+   pThisQueue = (pSpscQueue_t)pBlock;
+   return (uint16_t)(pThisQueue->Tail - pThisQueue->Head);
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+   CopyToRing
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   uint16_t Count : the count of the entry to copy the first event into
+   const ES_Event * pEvents : the events to copy
+   uint16_t NumEvents : how many events to copy, no more than will fit
+ Returns
+   nothing
+ Description
+   copies the events into the ring from the entry for Count on, in at most
+   two pieces either side of the end of the ring
+ Notes
+   does not change the counts
+****************************************************************************/
+static void CopyToRing( ES_Event * pBlock, uint16_t Count,
+                        const ES_Event * pEvents, uint16_t NumEvents )
+{
+   uint16_t Index;
+   uint16_t NumBeforeWrap;
+
+   Index = Count & ((pSpscQueue_t)pBlock)->Mask;
+   NumBeforeWrap = ((pSpscQueue_t)pBlock)->Mask + 1 - Index;
+   if ( NumBeforeWrap > NumEvents )
+      NumBeforeWrap = NumEvents;
+   memcpy( &pBlock[ ES_QUEUE_HEADER_SLOTS + Index ], pEvents,
+           NumBeforeWrap * sizeof(ES_Event) );
+   memcpy( &pBlock[ ES_QUEUE_HEADER_SLOTS ], &pEvents[ NumBeforeWrap ],
+           (NumEvents - NumBeforeWrap) * sizeof(ES_Event) );
+}
+
+/****************************************************************************
+ Function
+   CopyFromRing
+ Parameters
+   ES_Event * pBlock : pointer to the block of memory in use as the Queue
+   uint16_t Count : the count of the entry to copy the first event from
+   ES_Event * pEvents : where to copy the events to
+   uint16_t NumEvents : how many events to copy, no more than are there
+ Returns
+   nothing
+ Description
+   the reverse of CopyToRing
+ Notes
+   does not change the counts
+****************************************************************************/
+static void CopyFromRing( ES_Event * pBlock, uint16_t Count,
+                          ES_Event * pEvents, uint16_t NumEvents )
+{
+   uint16_t Index;
+   uint16_t NumBeforeWrap;
+
+   Index = Count & ((pSpscQueue_t)pBlock)->Mask;
+   NumBeforeWrap = ((pSpscQueue_t)pBlock)->Mask + 1 - Index;
+   if ( NumBeforeWrap > NumEvents )
+      NumBeforeWrap = NumEvents;
+   memcpy( pEvents, &pBlock[ ES_QUEUE_HEADER_SLOTS + Index ],
+           NumBeforeWrap * sizeof(ES_Event) );
+   memcpy( &pEvents[ NumBeforeWrap ], &pBlock[ ES_QUEUE_HEADER_SLOTS ],
+           (NumEvents - NumBeforeWrap) * sizeof(ES_Event) );
+}
+
+#endif /* ES_USE_SPSC_QUEUE */
+/*------------------------------ End of file ------------------------------*/
@@ -0,0 +1,407 @@
+/****************************************************************************
+ Module
+     ES_TimerWheel.c
+
+ Description
+     This is a module implementing a hierarchical timer wheel, so that the
+     cost of a tick does not grow with the number of timers running. It
+     runs the ES_Timers timers when ES_USE_TIMER_WHEEL is defined.
+
+ Notes
+     The wheel has LEVELS levels of SLOTS slots, each slot a doubly linked
+     list of timers. Level 0 has one slot per tick and holds the timers due
+     within the next SLOTS ticks. Each level above has slots SLOTS times as
+     long as the level below, so 6 levels of 64 cover every 32 bit time.
+     A timer goes into the lowest level whose span covers its time left.
+     When the tick count reaches the start of a slot on a level above 0,
+     the timers in that slot are shared out to the levels below, so each
+     timer is moved at most LEVELS-1 times before it expires, and starting,
+     stopping and expiring a timer are all constant time.
+     The timers are numbered, and the lists link them by number rather
+     than by pointer to keep the wheel small.
+     ES_WheelTick runs at thread level, from the framework tick response.
+     ES_WheelStart and ES_WheelStop change the lists inside a short
+     critical region, so that a preempting service can not tear them.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_TimerWheel.h"
+
+#ifdef ES_USE_TIMER_WHEEL
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+#if ES_WHEEL_TIMERS < MAX_NUM_TIMERS
+#error "ES_WHEEL_TIMERS must be at least MAX_NUM_TIMERS"
+#endif
+#if ES_WHEEL_TIMERS >= 0xFFFF
+#error "ES_WHEEL_TIMERS must be less than 65535"
+#endif
+
+#define SLOT_BITS   6
+#define SLOTS       (1u << SLOT_BITS)
+#define SLOT_MASK   (SLOTS - 1)
+#define LEVELS      6
+// the timers due on this tick are moved to a list of their own, after the
+// lists of the wheel, while their expiry functions are called
+#define WORK_LIST   (LEVELS * SLOTS)
+#define NUM_LISTS   (WORK_LIST + 1)
+// the end of a list, and the list of a stopped timer
+#define NONE        0xFFFF
+
+/*------------------------------ Module Types -----------------------------*/
+typedef struct {
+  uint32_t Expiry;          // the tick on which it expires
+  ES_WheelIndex_t Next;     // the timers either side of it in its list
+  ES_WheelIndex_t Prev;
+  uint16_t List;            // the list that it is in, NONE if stopped
+} WheelTimer_t;
+
+/*---------------------------- Module Functions ---------------------------*/
+static void Insert( ES_WheelIndex_t Which );
+static void Remove( ES_WheelIndex_t Which );
+static uint8_t Cascade( uint8_t Level );
+static bool CascadeDue( uint32_t Tick );
+
+/*---------------------------- Module Variables ---------------------------*/
+static WheelTimer_t Timers[ES_WHEEL_TIMERS];
+static ES_WheelIndex_t ListHead[NUM_LISTS];
+// the next tick to be processed
+static uint32_t Now;
+static ES_WheelExpiryFunc_t *pExpiryFunc;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_WheelInit
+ Parameters
+     ES_WheelExpiryFunc_t * pExpired, the function to call as each timer
+     expires
+ Returns
+     None.
+ Description
+     empties the wheel, stopping all of the timers
+ Notes
+     called from ES_Timer_Init, before any of the services start timers
+****************************************************************************/
+void ES_WheelInit( ES_WheelExpiryFunc_t *pExpired )
+{
+  ES_WheelIndex_t i;
+
+  for ( i = 0; i < ARRAY_SIZE(ListHead); i++ )
+    ListHead[i] = NONE;
+  for ( i = 0; i < ARRAY_SIZE(Timers); i++ )
+    Timers[i].List = NONE;
+  Now = 0;
+  pExpiryFunc = pExpired;
+}
+
+/****************************************************************************
+ Function
+     ES_WheelStart
+ Parameters
+     ES_WheelIndex_t Which, the timer to start
+     uint32_t Ticks, the number of ticks until it expires
+ Returns
+     false if the timer does not exist or Ticks is 0, true otherwise
+ Description
+     (re)starts the timer so that it expires on the Ticks'th tick from now.
+     A running timer starts again from the new time.
+ Notes
+     None.
+****************************************************************************/
+bool ES_WheelStart( ES_WheelIndex_t Which, uint32_t Ticks )
+{
+  if ( (Which >= ARRAY_SIZE(Timers)) || (Ticks == 0) )
+    return false;
+  EnterCritical();
+  if ( Timers[Which].List != NONE )
+    Remove( Which );
+  Timers[Which].Expiry = Now + Ticks - 1;
+  Insert( Which );
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_WheelStop
+ Parameters
+     ES_WheelIndex_t Which, the timer to stop
+ Returns
+     false if the timer does not exist, true otherwise
+ Description
+     stops the timer, if it is running, without calling its expiry function
+ Notes
+     a timer stopped by the expiry function of another timer that expires
+     on the same tick does not expire
+****************************************************************************/
+bool ES_WheelStop( ES_WheelIndex_t Which )
+{
+  if ( Which >= ARRAY_SIZE(Timers) )
+    return false;
+  EnterCritical();
+  if ( Timers[Which].List != NONE )
+    Remove( Which );
+  ExitCritical();
+  return true;
+}
+
+/****************************************************************************
+ Function
+     ES_WheelIsRunning
+ Parameters
+     ES_WheelIndex_t Which, the timer to test
+ Returns
+     true if the timer exists and is running
+ Description
+     see above
+ Notes
+     a timer has stopped by the time its expiry function is called
+****************************************************************************/
+bool ES_WheelIsRunning( ES_WheelIndex_t Which )
+{
+  return (Which < ARRAY_SIZE(Timers)) && (Timers[Which].List != NONE);
+}
+
+/****************************************************************************
+ Function
+     ES_WheelRemaining
+ Parameters
+     ES_WheelIndex_t Which, the timer to read
+ Returns
+     the number of ticks until the timer expires, 0 if it is not running
+ Description
+     see above
+ Notes
+     None.
+****************************************************************************/
+uint32_t ES_WheelRemaining( ES_WheelIndex_t Which )
+{
+  if ( !ES_WheelIsRunning( Which ) )
+    return 0;
+  return Timers[Which].Expiry - Now + 1;
+}
+
+/****************************************************************************
+ Function
+     ES_WheelIdleTicks
+ Parameters
+     uint32_t Max, the most ticks to look ahead
+ Returns
+     the number of ticks, up to Max, that ES_WheelTick would have nothing
+     to do on, starting from the next one
+ Description
+     looks along level 0 for the next timer due, stopping also at the start
+     of a round that brings timers down from the levels above
+ Notes
+     for the tickless idle, which runs these ticks all at once after a
+     single stretched tick interrupt, and for ES_WheelSkip. It takes up to
+     Max steps, so call it only when there is nothing else to do.
+****************************************************************************/
+uint32_t ES_WheelIdleTicks( uint32_t Max )
+{
+  uint32_t Tick = Now;
+  uint32_t Idle;
+
+  for ( Idle = 0; Idle < Max; Idle++, Tick++ ){
+    if ( ((Tick & SLOT_MASK) == 0) && CascadeDue( Tick ) )
+      break;
+    if ( ListHead[Tick & SLOT_MASK] != NONE )
+      break;
+  }
+  return Idle;
+}
+
+/****************************************************************************
+ Function
+     ES_WheelSkip
+ Parameters
+     uint32_t Max, the most ticks to skip
+ Returns
+     the number of ticks skipped
+ Description
+     processes, all at once, the ticks coming up that ES_WheelTick would
+     have nothing to do on, up to Max of them
+ Notes
+     for catching up with ticks that have built up. Each one would only
+     move Now on, so stepping over them together leaves the wheel just as
+     ticking them one at a time would.
+****************************************************************************/
+uint32_t ES_WheelSkip( uint32_t Max )
+{
+  uint32_t Skipped = ES_WheelIdleTicks( Max );
+
+  Now += Skipped;
+  return Skipped;
+}
+
+/****************************************************************************
+ Function
+     ES_WheelTick
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     processes one tick: shares out the timers of any higher level slots
+     that start on this tick, then stops each of the timers due on this
+     tick and calls the expiry function for it
+ Notes
+     the expiry function may start or stop any timer, including itself and
+     the others due on this tick. A timer started from it counts from the
+     next tick.
+****************************************************************************/
+void ES_WheelTick( void )
+{
+  ES_WheelIndex_t Which;
+  uint8_t Level;
+  uint16_t List;
+
+  List = Now & SLOT_MASK;
+  // at the start of each level 0 round, bring down the timers from the
+  // slot that starts now on level 1, and so on up while those start too
+  if ( List == 0 ){
+    for ( Level = 1; (Level < LEVELS) && (Cascade( Level ) == 0); Level++ )
+      ;
+  }
+  Which = ListHead[List];
+  ListHead[List] = NONE;
+  ListHead[WORK_LIST] = Which;
+  for ( ; Which != NONE; Which = Timers[Which].Next )
+    Timers[Which].List = WORK_LIST;
+  Now++;
+  while ( (Which = ListHead[WORK_LIST]) != NONE ){
+    Remove( Which );
+    pExpiryFunc( Which );
+  }
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     Insert
+ Parameters
+     ES_WheelIndex_t Which, a stopped timer with its Expiry set
+ Returns
+     None.
+ Description
+     puts the timer at the front of the slot that covers its Expiry, on the
+     lowest level that spans the time left
+ Notes
+     None.
+****************************************************************************/
+static void Insert( ES_WheelIndex_t Which )
+{
+  WheelTimer_t *pTimer = &Timers[Which];
+  uint32_t TimeLeft = pTimer->Expiry - Now;
+  uint8_t Level = 0;
+  uint16_t List;
+
+  while ( (Level < LEVELS - 1) &&
+          (TimeLeft >= ((uint32_t)1 << (SLOT_BITS * (Level + 1)))) )
+    Level++;
+  List = Level * SLOTS +
+         ((pTimer->Expiry >> (SLOT_BITS * Level)) & SLOT_MASK);
+  pTimer->List = List;
+  pTimer->Prev = NONE;
+  pTimer->Next = ListHead[List];
+  if ( ListHead[List] != NONE )
+    Timers[ListHead[List]].Prev = Which;
+  ListHead[List] = Which;
+}
+
+/****************************************************************************
+ Function
+     Remove
+ Parameters
+     ES_WheelIndex_t Which, a running timer
+ Returns
+     None.
+ Description
+     takes the timer out of its list and marks it as stopped
+ Notes
+     None.
+****************************************************************************/
+static void Remove( ES_WheelIndex_t Which )
+{
+  WheelTimer_t *pTimer = &Timers[Which];
+
+  if ( pTimer->Prev == NONE )
+    ListHead[pTimer->List] = pTimer->Next;
+  else
+    Timers[pTimer->Prev].Next = pTimer->Next;
+  if ( pTimer->Next != NONE )
+    Timers[pTimer->Next].Prev = pTimer->Prev;
+  pTimer->List = NONE;
+}
+
+/****************************************************************************
+ Function
+     Cascade
+ Parameters
+     uint8_t Level, the level to take the timers from, 1 or more
+ Returns
+     uint8_t, the slot on that level that starts now
+ Description
+     moves the timers in the slot that starts now down to the levels below,
+     where they now fit
+ Notes
+     a return of 0 means that the slot on the level above starts now too
+****************************************************************************/
+static uint8_t Cascade( uint8_t Level )
+{
+  uint8_t Slot;
+  uint16_t List;
+  ES_WheelIndex_t Which;
+  ES_WheelIndex_t Next;
+
+  Slot = (uint8_t)((Now >> (SLOT_BITS * Level)) & SLOT_MASK);
+  List = Level * SLOTS + Slot;
+  Which = ListHead[List];
+  ListHead[List] = NONE;
+  for ( ; Which != NONE; Which = Next ){
+    Next = Timers[Which].Next;
+    Insert( Which );
+  }
+  return Slot;
+}
+
+/****************************************************************************
+ Function
+     CascadeDue
+ Parameters
+     uint32_t Tick, a tick that starts a level 0 round
+ Returns
+     true if ES_WheelTick will bring any timers down on that tick
+ Description
+     checks the slots that Cascade would empty on that tick
+ Notes
+     None.
+****************************************************************************/
+static bool CascadeDue( uint32_t Tick )
+{
+  uint8_t Level;
+  uint8_t Slot;
+
+  for ( Level = 1; Level < LEVELS; Level++ ){
+    Slot = (uint8_t)((Tick >> (SLOT_BITS * Level)) & SLOT_MASK);
+    if ( ListHead[Level * SLOTS + Slot] != NONE )
+      return true;
+    if ( Slot != 0 )  // the levels above do not start a slot on this tick
+      break;
+  }
+  return false;
+}
+
+#endif /* ES_USE_TIMER_WHEEL */
+/*------------------------------ End of file ------------------------------*/
@@ -3,12 +3,29 @@
      ES_Timers.c
 
  Description
-     This is a module implementing  8 16 bit timers all using the RTI
-     timebase
+     This is a module implementing MAX_NUM_TIMERS 32 bit timers all using
+     the RTI timebase
 
  Notes
      Everything is done in terms of RTI Ticks, which can change from
      application to application.
+     With ES_USE_TIMER_WHEEL the timers run on the timer wheel in
+     ES_TimerWheel.c, so a tick costs the same however many of them are
+     active, otherwise every active timer is decremented on every tick.
+     A periodic timer is reloaded on the tick that it expires, before its
+     timeout is posted, so its period runs from when it came due rather
+     than from when its service got round to the timeout, and does not
+     drift. The lateness of each periodic timeout is kept for
+     ES_Timer_GetJitter.
+     Ticks that build up while a run function holds them off are taken
+     together by ES_Timer_CatchUp, which steps straight over those on which
+     nothing comes due and runs the rest in order.
+     With ES_USE_PREEMPTION the tick response can run in the middle of any
+     run function, so the functions that set, start and stop the timers
+     change them in a critical region.
+     With ES_NUM_TIMER_HANDLES, services can also create timers at run time
+     from a static pool. These are the wheel timers after the numbered ones,
+     and either post to a service or call a function from the tick response.
 
  History
  When           Who     What/Why
@@ -50,47 +67,93 @@
 #include "ES_LookupTables.h"
 #include "ES_Timers.h"
 #include "ES_Port.h"
+#ifdef ES_USE_TIMER_WHEEL
+#include "ES_TimerWheel.h"
+#endif
 /*--------------------------- External Variables --------------------------*/
 
 /*----------------------------- Module Defines ----------------------------*/
+#if defined(ES_USE_TICKLESS) && !defined(ES_USE_TIMER_WHEEL)
+#error "ES_USE_TICKLESS needs ES_USE_TIMER_WHEEL"
+#endif
+#ifdef ES_NUM_TIMER_HANDLES
+#ifndef ES_USE_TIMER_WHEEL
+#error "ES_NUM_TIMER_HANDLES needs ES_USE_TIMER_WHEEL"
+#endif
+#if ES_WHEEL_TIMERS < (MAX_NUM_TIMERS + ES_NUM_TIMER_HANDLES)
+#error "ES_WHEEL_TIMERS must be at least MAX_NUM_TIMERS + ES_NUM_TIMER_HANDLES"
+#endif
+#endif
 
 /*------------------------------ Module Types -----------------------------*/
 
 /*
    the size of Tflag sets the number of timers, uint8 = 8, uint16 = 16 ...)
-   to add more timers, you will need to change the data type and modify
-   the initialization of TMR_TimerArray and TMR_MaskArray
+   it is now the shared ES_BitFlags_t from ES_LookupTables.h, so to add more
+   timers raise MAX_NUM_TIMERS in ES_Configure.h and define the extra
+   TIMERn_RESP_FUNC entries there
 */
 
-typedef uint16_t Tflag_t;
+typedef ES_BitFlags_t Tflag_t;
 
-typedef uint16_t Timer_t; // sets size of timers to 16 bits
+typedef uint32_t Timer_t; // sets size of timers to 32 bits
+
+#ifdef ES_NUM_TIMER_HANDLES
+// a timer from the pool for ES_TimerCreate
+typedef struct {
+  ES_TimerCallback_t *pCallback; // the function to call, NULL to post
+  Timer_t Period;                // 0 for a one shot timer
+  uint8_t Service;               // the service to post to
+  bool InUse;
+} HandleTimer_t;
+#endif
 
 
 /*---------------------------- Module Functions ---------------------------*/
+#ifdef ES_USE_TIMER_WHEEL
+static void TimerExpired( ES_WheelIndex_t Which );
+#endif
+static void LogJitter( uint8_t Num );
+static uint32_t SkipIdle( uint32_t Max );
+#ifdef ES_NUM_TIMER_HANDLES
+static ES_TimerHandle_t CreateHandle( ES_TimerCallback_t *pCallback,
+                                      uint8_t WhichService );
+static HandleTimer_t *FindHandle( ES_TimerHandle_t Timer );
+static void HandleExpired( ES_TimerHandle_t Timer );
+#endif
 
 /*---------------------------- Module Variables ---------------------------*/
-static Timer_t TMR_TimerArray[sizeof(Tflag_t)*BITS_PER_BYTE]=
-                                            { 0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0, 
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0,
-                                              0x0 };
+// static, so all of the timers start out cleared. With the timer wheel
+// this holds the time set on each timer, or the time left on a stopped one,
+// and the wheel does the counting
+static Timer_t TMR_TimerArray[MAX_NUM_TIMERS];
 
+#ifndef ES_USE_TIMER_WHEEL
 static Tflag_t TMR_ActiveFlags;
+#else
+// the timers that the wheel has expired on this tick, still to be posted
+static Tflag_t TMR_ExpiredFlags;
+#endif
+// the period of each periodic timer, 0 for a one shot timer
+static Timer_t TMR_Period[MAX_NUM_TIMERS];
+static ES_TimerJitter_t TMR_Jitter[MAX_NUM_TIMERS];
+
+#ifdef ES_NUM_TIMER_HANDLES
+// static, so all of the handles start out free
+static HandleTimer_t TMR_Handles[ES_NUM_TIMER_HANDLES];
+#endif
+
+static ES_TimerCatchUp_t CatchUpStats;
+// a count of the timeouts posted, so that ES_Timer_CatchUp can tell which
+// of its ticks posted any
+static uint16_t NumPosted;
+
+// the ticks taken by ES_Timer_Tick_Resp. Periodic timers come due on these
+// ticks, and with ES_USE_RECORD it is the time seen by the framework, so
+// that the time only moves when the recorded ticks are processed
+static ES_Time_t TicksTaken;
 
-static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] = 
+static pPostFunc const Timer2PostFunc[MAX_NUM_TIMERS] = 
                                             { TIMER0_RESP_FUNC,
                                               TIMER1_RESP_FUNC,
                                               TIMER2_RESP_FUNC,
@@ -98,8 +161,9 @@ static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] =
                                               TIMER4_RESP_FUNC,
                                               TIMER5_RESP_FUNC,
                                               TIMER6_RESP_FUNC,
-                                              TIMER7_RESP_FUNC, 
-                                              TIMER8_RESP_FUNC,
+                                              TIMER7_RESP_FUNC
+#if MAX_NUM_TIMERS > 8
+                                             ,TIMER8_RESP_FUNC,
                                               TIMER9_RESP_FUNC,
                                               TIMER10_RESP_FUNC,
                                               TIMER11_RESP_FUNC,
@@ -107,6 +171,59 @@ static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] =
                                               TIMER13_RESP_FUNC,
                                               TIMER14_RESP_FUNC,
                                               TIMER15_RESP_FUNC
+#endif
+#if MAX_NUM_TIMERS > 16
+                                             ,TIMER16_RESP_FUNC,
+                                              TIMER17_RESP_FUNC,
+                                              TIMER18_RESP_FUNC,
+                                              TIMER19_RESP_FUNC,
+                                              TIMER20_RESP_FUNC,
+                                              TIMER21_RESP_FUNC,
+                                              TIMER22_RESP_FUNC,
+                                              TIMER23_RESP_FUNC,
+                                              TIMER24_RESP_FUNC,
+                                              TIMER25_RESP_FUNC,
+                                              TIMER26_RESP_FUNC,
+                                              TIMER27_RESP_FUNC,
+                                              TIMER28_RESP_FUNC,
+                                              TIMER29_RESP_FUNC,
+                                              TIMER30_RESP_FUNC,
+                                              TIMER31_RESP_FUNC
+#endif
+#if MAX_NUM_TIMERS > 32
+                                             ,TIMER32_RESP_FUNC,
+                                              TIMER33_RESP_FUNC,
+                                              TIMER34_RESP_FUNC,
+                                              TIMER35_RESP_FUNC,
+                                              TIMER36_RESP_FUNC,
+                                              TIMER37_RESP_FUNC,
+                                              TIMER38_RESP_FUNC,
+                                              TIMER39_RESP_FUNC,
+                                              TIMER40_RESP_FUNC,
+                                              TIMER41_RESP_FUNC,
+                                              TIMER42_RESP_FUNC,
+                                              TIMER43_RESP_FUNC,
+                                              TIMER44_RESP_FUNC,
+                                              TIMER45_RESP_FUNC,
+                                              TIMER46_RESP_FUNC,
+                                              TIMER47_RESP_FUNC,
+                                              TIMER48_RESP_FUNC,
+                                              TIMER49_RESP_FUNC,
+                                              TIMER50_RESP_FUNC,
+                                              TIMER51_RESP_FUNC,
+                                              TIMER52_RESP_FUNC,
+                                              TIMER53_RESP_FUNC,
+                                              TIMER54_RESP_FUNC,
+                                              TIMER55_RESP_FUNC,
+                                              TIMER56_RESP_FUNC,
+                                              TIMER57_RESP_FUNC,
+                                              TIMER58_RESP_FUNC,
+                                              TIMER59_RESP_FUNC,
+                                              TIMER60_RESP_FUNC,
+                                              TIMER61_RESP_FUNC,
+                                              TIMER62_RESP_FUNC,
+                                              TIMER63_RESP_FUNC
+#endif
                                               };
   
 
@@ -129,6 +246,16 @@ static pPostFunc const Timer2PostFunc[sizeof(Tflag_t)*BITS_PER_BYTE] =
 ****************************************************************************/
 void ES_Timer_Init(TimerRate_t Rate)
 {
+#ifdef ES_USE_TIMER_WHEEL
+   static bool WheelReady = false;
+
+   // services may call this again from their init functions, which must
+   // not stop the timers that have already been started
+   if( !WheelReady ){
+      ES_WheelInit(TimerExpired);
+      WheelReady = true;
+   }
+#endif
    // call the hardware init routine
    _HW_Timer_Init(Rate);
 }
@@ -149,7 +276,7 @@ void ES_Timer_Init(TimerRate_t Rate)
  Author
      J. Edward Carryer, 02/24/97 17:11
 ****************************************************************************/
-ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
+ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint32_t NewTime)
 {
    /* tried to set a timer that doesn't exist */
    if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
@@ -157,7 +284,14 @@ ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
        (Timer2PostFunc[Num] == TIMER_UNUSED) ||
        (NewTime == 0) ) /* no time being set */
       return ES_Timer_ERR;  
+   EnterCritical();
    TMR_TimerArray[Num] = NewTime;
+#ifdef ES_USE_TIMER_WHEEL
+   /* an active timer carries on counting from the new time */
+   if( ES_WheelIsRunning(Num) )
+      ES_WheelStart(Num, NewTime);
+#endif
+   ExitCritical();
    return ES_Timer_OK;
 }
 
@@ -178,13 +312,25 @@ ES_TimerReturn_t ES_Timer_SetTimer(uint8_t Num, uint16_t NewTime)
 ****************************************************************************/
 ES_TimerReturn_t ES_Timer_StartTimer(uint8_t Num)
 {
+   ES_TimerReturn_t ReturnVal = ES_Timer_OK;
+
    /* tried to set a timer that doesn't exist */
-   if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
-       /* tried to set a timer with no time on it */
-       (TMR_TimerArray[Num] == 0) )
+   if( Num >= ARRAY_SIZE(TMR_TimerArray) )
       return ES_Timer_ERR;  
-   TMR_ActiveFlags |= BitNum2SetMask[Num]; /* set timer as active */
-   return ES_Timer_OK;
+   EnterCritical();
+   /* tried to set a timer with no time on it */
+   if( TMR_TimerArray[Num] == 0 )
+      ReturnVal = ES_Timer_ERR;
+#ifndef ES_USE_TIMER_WHEEL
+   else
+      TMR_ActiveFlags |= BitNum2SetMask[Num]; /* set timer as active */
+#else
+   /* an active timer just carries on */
+   else if( !ES_WheelIsRunning(Num) )
+      ES_WheelStart(Num, TMR_TimerArray[Num]);
+#endif
+   ExitCritical();
+   return ReturnVal;
 }
 
 /****************************************************************************
@@ -206,7 +352,17 @@ ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
 {
    if( Num >= ARRAY_SIZE(TMR_TimerArray) )
       return ES_Timer_ERR;  /* tried to set a timer that doesn't exist */
+   EnterCritical();
+#ifndef ES_USE_TIMER_WHEEL
    TMR_ActiveFlags &= BitNum2ClrMask[Num]; /* set timer as inactive */
+#else
+   /* keep the time left, for ES_Timer_StartTimer to carry on from */
+   if( ES_WheelIsRunning(Num) ){
+      TMR_TimerArray[Num] = ES_WheelRemaining(Num);
+      ES_WheelStop(Num);
+   }
+#endif
+   ExitCritical();
    return ES_Timer_OK;
 }
 
@@ -226,7 +382,7 @@ ES_TimerReturn_t ES_Timer_StopTimer(uint8_t Num)
  Author
      J. Edward Carryer, 02/24/97 14:51
 ****************************************************************************/
-ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
+ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint32_t NewTime)
 {
    /* tried to set a timer that doesn't exist */
    if( (Num >= ARRAY_SIZE(TMR_TimerArray)) ||
@@ -235,11 +391,47 @@ ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
        /* tried to set a timer without putting any time on it */
        (NewTime == 0) )
       return ES_Timer_ERR;  
+   EnterCritical();
+   TMR_Period[Num] = 0; /* a one shot timer */
    TMR_TimerArray[Num] = NewTime;
+#ifndef ES_USE_TIMER_WHEEL
    TMR_ActiveFlags |= BitNum2SetMask[Num]; /* set timer as active */
+#else
+   ES_WheelStart(Num, NewTime);
+#endif
+   ExitCritical();
    return ES_Timer_OK;
 }
 
+/****************************************************************************
+ Function
+     ES_Timer_InitPeriodic
+ Parameters
+     unsigned char Num, the number of the timer to start
+     unsigned int Period, the number of ticks between timeouts
+ Returns
+     ES_Timer_ERR if the requested timer does not exist, ES_Timer_OK otherwise.
+ Description
+     starts the chosen timer so that it times out every Period ticks until
+     it is stopped, with no need to start it again from each timeout.
+ Notes
+     ES_Timer_StopTimer and ES_Timer_StartTimer pause and resume it,
+     ES_Timer_SetTimer changes the time to the next timeout only, and
+     ES_Timer_InitTimer turns it back into a one shot timer.
+****************************************************************************/
+ES_TimerReturn_t ES_Timer_InitPeriodic(uint8_t Num, uint32_t Period)
+{
+   ES_TimerReturn_t ReturnVal;
+
+   // so that the tick can not see it as a one shot timer in between
+   EnterCritical();
+   ReturnVal = ES_Timer_InitTimer(Num, Period);
+   if( ReturnVal == ES_Timer_OK )
+      TMR_Period[Num] = Period;
+   ExitCritical();
+   return ReturnVal;
+}
+
 
 /****************************************************************************
  Function
@@ -254,13 +446,252 @@ ES_TimerReturn_t ES_Timer_InitTimer(uint8_t Num, uint16_t NewTime)
  Notes
      this functionality is ancient, though this implementation in the library
      is new.
+     With ES_USE_RECORD this counts the ticks processed rather than those
+     that have occurred, so that it replays exactly.
+     The count is 32 bits and wraps, so compare times with the ES_TIME_
+     macros in ES_Timers.h rather than with < and >.
  Author
      J. Edward Carryer, 06/01/04 08:04
 ****************************************************************************/
-uint16_t ES_Timer_GetTime(void)
+ES_Time_t ES_Timer_GetTime(void)
 {
+#ifdef ES_USE_RECORD
+   return (TicksTaken);
+#else
    return (_HW_GetTickCount());
+#endif
+}
+
+#ifdef ES_USE_TICKLESS
+/****************************************************************************
+ Function
+     ES_Timer_IdleTicks
+ Parameters
+     uint32_t Max, the most ticks to look ahead
+ Returns
+     the number of ticks coming up, at most Max, on which no timer expires
+ Description
+     lets the port's tickless idle sleep through the ticks with nothing to
+     do, with one stretched tick interrupt at the end of them
+ Notes
+     called by _HW_Idle with interrupts off
+****************************************************************************/
+uint32_t ES_Timer_IdleTicks(uint32_t Max)
+{
+   return ES_WheelIdleTicks(Max);
+}
+#endif
+
+/****************************************************************************
+ Function
+     ES_Timer_GetJitter
+ Parameters
+     unsigned char Num, the number of the timer
+     ES_TimerJitter_t * pStats, where to copy its stats
+ Returns
+     false if the timer does not exist, true otherwise
+ Description
+     copies out the lateness of the periodic timeouts from the timer
+ Notes
+     a timeout is late when the ticks are processed after they occur, as
+     when a run function takes longer than a tick. The time that the
+     timeout then waits in the service's queue is not counted here, that
+     is in the ES_USE_PROFILER stats.
+****************************************************************************/
+bool ES_Timer_GetJitter(uint8_t Num, ES_TimerJitter_t *pStats)
+{
+   if( Num >= ARRAY_SIZE(TMR_Jitter) )
+      return false;
+   EnterCritical();
+   *pStats = TMR_Jitter[Num];
+   ExitCritical();
+   return true;
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_ClearJitter
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     clears the jitter stats for all of the timers
+ Notes
+     None.
+****************************************************************************/
+void ES_Timer_ClearJitter(void)
+{
+   uint8_t i;
+
+   EnterCritical();
+   for( i = 0; i < ARRAY_SIZE(TMR_Jitter); i++ ){
+      TMR_Jitter[i].NumExpiries = 0;
+      TMR_Jitter[i].TotalLate = 0;
+      TMR_Jitter[i].MaxLate = 0;
+      TMR_Jitter[i].NumOverruns = 0;
+   }
+   ExitCritical();
+}
+
+#ifdef ES_NUM_TIMER_HANDLES
+/****************************************************************************
+ Function
+     ES_TimerCreate
+ Parameters
+     uint8_t WhichService, the priority of the service to post to
+ Returns
+     ES_TimerHandle_t, the new timer, ES_TIMER_NO_HANDLE if the service does
+     not exist or the pool is empty
+ Description
+     takes a stopped timer from the pool that posts ES_TIMEOUT, with the
+     handle as the EventParam, to the service when it expires
+ Notes
+     None.
+****************************************************************************/
+ES_TimerHandle_t ES_TimerCreate(uint8_t WhichService)
+{
+   if( WhichService >= NUM_SERVICES )
+      return ES_TIMER_NO_HANDLE;
+   return CreateHandle(NULL, WhichService);
+}
+
+/****************************************************************************
+ Function
+     ES_TimerCreateCallback
+ Parameters
+     ES_TimerCallback_t * pCallback, the function to call when it expires
+ Returns
+     ES_TimerHandle_t, the new timer, ES_TIMER_NO_HANDLE if the pool is
+     empty
+ Description
+     takes a stopped timer from the pool that calls the function, with the
+     handle, when it expires
+ Notes
+     The function is called from the tick response, between run functions,
+     or with ES_USE_PREEMPTION, in the middle of any lower priority one. It
+     should be short, as the cost of the tick grows with it, and anything
+     that it shares with a run function must be safe to change there.
+****************************************************************************/
+ES_TimerHandle_t ES_TimerCreateCallback(ES_TimerCallback_t *pCallback)
+{
+   if( pCallback == NULL )
+      return ES_TIMER_NO_HANDLE;
+   return CreateHandle(pCallback, 0);
+}
+
+/****************************************************************************
+ Function
+     ES_TimerDelete
+ Parameters
+     ES_TimerHandle_t Timer, the timer to give back to the pool
+ Returns
+     ES_Timer_ERR if the timer does not exist, ES_Timer_OK otherwise.
+ Description
+     stops the timer and frees it for ES_TimerCreate to use again
+ Notes
+     a timeout that it has already posted stays in the service's queue
+****************************************************************************/
+ES_TimerReturn_t ES_TimerDelete(ES_TimerHandle_t Timer)
+{
+   HandleTimer_t *pTimer = FindHandle(Timer);
+
+   if( pTimer == NULL )
+      return ES_Timer_ERR;
+   ES_WheelStop(Timer);
+   pTimer->InUse = false;
+   return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_TimerStart
+ Parameters
+     ES_TimerHandle_t Timer, the timer to start
+     unsigned int Ticks, the number of ticks until it expires
+ Returns
+     ES_Timer_ERR if the timer does not exist or Ticks is 0, ES_Timer_OK
+     otherwise.
+ Description
+     (re)starts the timer as a one shot timer. A running timer starts again
+     from the new time.
+ Notes
+     None.
+****************************************************************************/
+ES_TimerReturn_t ES_TimerStart(ES_TimerHandle_t Timer, uint32_t Ticks)
+{
+   HandleTimer_t *pTimer = FindHandle(Timer);
+
+   if( (pTimer == NULL) || (Ticks == 0) )
+      return ES_Timer_ERR;
+   pTimer->Period = 0;
+   ES_WheelStart(Timer, Ticks);
+   return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_TimerStartPeriodic
+ Parameters
+     ES_TimerHandle_t Timer, the timer to start
+     unsigned int Period, the number of ticks between expiries
+ Returns
+     ES_Timer_ERR if the timer does not exist or Period is 0, ES_Timer_OK
+     otherwise.
+ Description
+     (re)starts the timer so that it expires every Period ticks until it
+     is stopped, reloading from when it came due as ES_Timer_InitPeriodic
+ Notes
+     None.
+****************************************************************************/
+ES_TimerReturn_t ES_TimerStartPeriodic(ES_TimerHandle_t Timer, uint32_t Period)
+{
+   HandleTimer_t *pTimer = FindHandle(Timer);
+
+   if( (pTimer == NULL) || (Period == 0) )
+      return ES_Timer_ERR;
+   pTimer->Period = Period;
+   ES_WheelStart(Timer, Period);
+   return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_TimerStop
+ Parameters
+     ES_TimerHandle_t Timer, the timer to stop
+ Returns
+     ES_Timer_ERR if the timer does not exist, ES_Timer_OK otherwise.
+ Description
+     stops the timer, if it is running, keeping it for a later start
+ Notes
+     None.
+****************************************************************************/
+ES_TimerReturn_t ES_TimerStop(ES_TimerHandle_t Timer)
+{
+   if( FindHandle(Timer) == NULL )
+      return ES_Timer_ERR;
+   ES_WheelStop(Timer);
+   return ES_Timer_OK;
+}
+
+/****************************************************************************
+ Function
+     ES_TimerIsRunning
+ Parameters
+     ES_TimerHandle_t Timer, the timer to test
+ Returns
+     true if the timer exists and is running
+ Description
+     see above
+ Notes
+     None.
+****************************************************************************/
+bool ES_TimerIsRunning(ES_TimerHandle_t Timer)
+{
+   return (FindHandle(Timer) != NULL) && ES_WheelIsRunning(Timer);
 }
+#endif /* ES_NUM_TIMER_HANDLES */
 
 /****************************************************************************
  Function
@@ -276,17 +707,46 @@ uint16_t ES_Timer_GetTime(void)
      decrementing each active timers count, if the count goes to 0, it
      will post an event to the corresponding SM and clear the active flag to
      prevent further counting.
+     With the timer wheel, the wheel finds the timers that expire and they
+     are posted here, highest numbered first as above.
+     A periodic timer is reloaded rather than stopped, and its lateness
+     noted as it is posted.
  Notes
-     Called from _Timer_Int_Resp in ES_Port.c.
+     Called from _Timer_Int_Resp in ES_Port.c. Now called by
+     ES_Timer_CatchUp, for each tick on which something comes due.
  Author
      J. Edward Carryer, 02/24/97 15:06
 ****************************************************************************/
+#ifdef ES_USE_TIMER_WHEEL
+void ES_Timer_Tick_Resp(void)
+{
+	static uint8_t NextTimer2Process;
+	static ES_Event NewEvent;
+
+	TicksTaken++;
+	ES_WheelTick();
+	while (TMR_ExpiredFlags != 0)
+	{
+		NextTimer2Process = ES_GetMSBitSet(TMR_ExpiredFlags);
+		TMR_ExpiredFlags &= BitNum2ClrMask[NextTimer2Process];
+		if (TMR_Period[NextTimer2Process] != 0)
+			LogJitter(NextTimer2Process);
+		NewEvent.EventType = ES_TIMEOUT;
+		NewEvent.EventParam = NextTimer2Process;
+		ES_TRACE(ES_TRACE_TIMEOUT, NextTimer2Process, NewEvent);
+		/* post the timeout event to the right Service */
+		Timer2PostFunc[NextTimer2Process](NewEvent);
+		NumPosted++;
+	}
+}
+#else
 void ES_Timer_Tick_Resp(void)
 {
 	static Tflag_t NeedsProcessing;
 	static uint8_t NextTimer2Process;
 	static ES_Event NewEvent;
 
+	TicksTaken++;
 	if (TMR_ActiveFlags != 0) /* if !=0 , then at least 1 timer is active */
 	{
 		// start by getting a list of all the active timers
@@ -297,12 +757,18 @@ void ES_Timer_Tick_Resp(void)
 			/* decrement that timer, check if timed out */
 			if(--TMR_TimerArray[NextTimer2Process] == 0)
 			{
+				/* reload a periodic timer, or stop counting */
+				if (TMR_Period[NextTimer2Process] != 0){
+					TMR_TimerArray[NextTimer2Process] = TMR_Period[NextTimer2Process];
+					LogJitter(NextTimer2Process);
+				}else
+					TMR_ActiveFlags &= BitNum2ClrMask[NextTimer2Process];
 				NewEvent.EventType = ES_TIMEOUT;
 				NewEvent.EventParam = NextTimer2Process;
+				ES_TRACE(ES_TRACE_TIMEOUT, NextTimer2Process, NewEvent);
 				/* post the timeout event to the right Service */
 				Timer2PostFunc[NextTimer2Process](NewEvent);
-				/* and stop counting */
-				TMR_ActiveFlags &= BitNum2ClrMask[NextTimer2Process];
+				NumPosted++;
 			}
 			// mark off the active timer that we just processed
 			NeedsProcessing &= BitNum2ClrMask[NextTimer2Process];
@@ -310,6 +776,290 @@ void ES_Timer_Tick_Resp(void)
       
 	}
 }
+#endif
+
+/****************************************************************************
+ Function
+     ES_Timer_CatchUp
+ Parameters
+     uint16_t NumTicks, the ticks that have occurred since the last call
+ Returns
+     None.
+ Description
+     takes all of the ticks at once. The ticks on which nothing comes due
+     are stepped over together, and ES_Timer_Tick_Resp is only run for the
+     others, so the timeouts are still posted in the order they came due.
+     Notes how many ticks it took and how late the timeouts were posted.
+ Notes
+     called from _HW_Process_Pending_Ints in ES_Port.c with the ticks that
+     have built up, in place of calling ES_Timer_Tick_Resp for each one
+****************************************************************************/
+void ES_Timer_CatchUp(uint16_t NumTicks)
+{
+   ES_Time_t End = TicksTaken + NumTicks;
+   ES_Time_t Late;
+   uint16_t Posted;
+   uint32_t Skipped;
+
+   if( NumTicks > 1 ){
+      CatchUpStats.NumPasses++;
+      if( NumTicks > CatchUpStats.MaxDepth )
+         CatchUpStats.MaxDepth = NumTicks;
+   }
+   while( NumTicks > 0 ){
+      Skipped = SkipIdle(NumTicks);
+      TicksTaken += Skipped;
+      NumTicks -= Skipped;
+      if( NumTicks > 0 ){
+         Posted = NumPosted;
+         ES_Timer_Tick_Resp();
+         NumTicks--;
+         Late = End - TicksTaken;
+         if( (Late != 0) && (NumPosted != Posted) ){
+            CatchUpStats.NumLate += (uint16_t)(NumPosted - Posted);
+            if( Late > CatchUpStats.MaxLate )
+               CatchUpStats.MaxLate = Late;
+         }
+      }
+   }
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_GetCatchUp
+ Parameters
+     ES_TimerCatchUp_t * pStats, where to copy the stats
+ Returns
+     None.
+ Description
+     copies out the stats kept by ES_Timer_CatchUp
+ Notes
+     MaxLate is the tick latency that matters after a long run function:
+     how long the timeouts due during it were held back
+****************************************************************************/
+void ES_Timer_GetCatchUp(ES_TimerCatchUp_t *pStats)
+{
+   EnterCritical();
+   *pStats = CatchUpStats;
+   ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_Timer_ClearCatchUp
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     clears the stats kept by ES_Timer_CatchUp
+ Notes
+     None.
+****************************************************************************/
+void ES_Timer_ClearCatchUp(void)
+{
+   EnterCritical();
+   CatchUpStats.NumPasses = 0;
+   CatchUpStats.MaxDepth = 0;
+   CatchUpStats.NumLate = 0;
+   CatchUpStats.MaxLate = 0;
+   ExitCritical();
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+/****************************************************************************
+ Function
+     SkipIdle
+ Parameters
+     uint32_t Max, the most ticks to skip
+ Returns
+     uint32_t, the number of ticks skipped
+ Description
+     moves every timer on by the ticks coming up, up to Max, on which
+     none of them comes due
+ Notes
+     the wheel does this without looking at the timers. Otherwise the
+     active timers are all brought down to 1 tick to go, or by Max if
+     that is sooner
+****************************************************************************/
+static uint32_t SkipIdle( uint32_t Max )
+{
+#ifdef ES_USE_TIMER_WHEEL
+   return ES_WheelSkip(Max);
+#else
+   Tflag_t Active = TMR_ActiveFlags;
+   uint32_t Skip = Max;
+   uint8_t Num;
+
+   while( Active != 0 ){
+      Num = ES_GetMSBitSet(Active);
+      if( TMR_TimerArray[Num] - 1 < Skip )
+         Skip = TMR_TimerArray[Num] - 1;
+      Active &= BitNum2ClrMask[Num];
+   }
+   if( Skip != 0 ){
+      Active = TMR_ActiveFlags;
+      while( Active != 0 ){
+         Num = ES_GetMSBitSet(Active);
+         TMR_TimerArray[Num] -= Skip;
+         Active &= BitNum2ClrMask[Num];
+      }
+   }
+   return Skip;
+#endif
+}
+
+/****************************************************************************
+ Function
+     LogJitter
+ Parameters
+     uint8_t Num, the periodic timer that is being posted
+ Returns
+     None.
+ Description
+     adds the lateness of this timeout, the ticks that have occurred since
+     the one being processed, to the timer's stats
+ Notes
+     None.
+****************************************************************************/
+static void LogJitter( uint8_t Num )
+{
+   ES_TimerJitter_t *pStats = &TMR_Jitter[Num];
+   ES_Time_t Late = _HW_GetTickCount() - TicksTaken;
+
+   pStats->NumExpiries++;
+   pStats->TotalLate += Late;
+   if( Late > pStats->MaxLate )
+      pStats->MaxLate = Late;
+   if( Late >= TMR_Period[Num] )
+      pStats->NumOverruns++;
+}
+
+#ifdef ES_USE_TIMER_WHEEL
+/****************************************************************************
+ Function
+     TimerExpired
+ Parameters
+     ES_WheelIndex_t Which, the timer that the wheel has just expired
+ Returns
+     None.
+ Description
+     the wheel's expiry function. Notes the timer for ES_Timer_Tick_Resp to
+     post, once the wheel has found all of the timers expiring on this tick
+ Notes
+     the timers from ES_TimerCreate are dealt with straight away
+****************************************************************************/
+static void TimerExpired( ES_WheelIndex_t Which )
+{
+   if( Which < ARRAY_SIZE(TMR_TimerArray) ){
+      /* a periodic timer starts again from this tick, a one shot timer is
+         left as a timer counted down to 0 would be */
+      TMR_TimerArray[Which] = TMR_Period[Which];
+      if( TMR_Period[Which] != 0 )
+         ES_WheelStart(Which, TMR_Period[Which]);
+      TMR_ExpiredFlags |= BitNum2SetMask[Which];
+   }
+#ifdef ES_NUM_TIMER_HANDLES
+   else
+      HandleExpired(Which);
+#endif
+}
+
+#ifdef ES_NUM_TIMER_HANDLES
+/****************************************************************************
+ Function
+     CreateHandle
+ Parameters
+     ES_TimerCallback_t * pCallback, the function to call, NULL to post
+     uint8_t WhichService, the service to post to
+ Returns
+     ES_TimerHandle_t, the timer taken from the pool, ES_TIMER_NO_HANDLE if
+     it is empty
+ Description
+     takes the first free timer from the pool
+ Notes
+     services at different priorities may create timers at once with
+     ES_USE_PREEMPTION, so the search is a critical region
+****************************************************************************/
+static ES_TimerHandle_t CreateHandle( ES_TimerCallback_t *pCallback,
+                                      uint8_t WhichService )
+{
+   ES_TimerHandle_t Found = ES_TIMER_NO_HANDLE;
+   uint8_t i;
+
+   EnterCritical();
+   for( i = 0; i < ARRAY_SIZE(TMR_Handles); i++ ){
+      if( !TMR_Handles[i].InUse ){
+         TMR_Handles[i].InUse = true;
+         TMR_Handles[i].pCallback = pCallback;
+         TMR_Handles[i].Service = WhichService;
+         TMR_Handles[i].Period = 0;
+         Found = MAX_NUM_TIMERS + i;
+         break;
+      }
+   }
+   ExitCritical();
+   return Found;
+}
+
+/****************************************************************************
+ Function
+     FindHandle
+ Parameters
+     ES_TimerHandle_t Timer, a handle from ES_TimerCreate
+ Returns
+     HandleTimer_t *, the timer, NULL if it is not in use
+ Description
+     see above
+ Notes
+     None.
+****************************************************************************/
+static HandleTimer_t *FindHandle( ES_TimerHandle_t Timer )
+{
+   HandleTimer_t *pTimer;
+
+   if( (Timer < MAX_NUM_TIMERS) ||
+       (Timer >= MAX_NUM_TIMERS + ARRAY_SIZE(TMR_Handles)) )
+      return NULL;
+   pTimer = &TMR_Handles[Timer - MAX_NUM_TIMERS];
+   return pTimer->InUse ? pTimer : NULL;
+}
+
+/****************************************************************************
+ Function
+     HandleExpired
+ Parameters
+     ES_TimerHandle_t Timer, the created timer that has just expired
+ Returns
+     None.
+ Description
+     restarts it if it is periodic, then calls its function or posts its
+     timeout
+ Notes
+     None.
+****************************************************************************/
+static void HandleExpired( ES_TimerHandle_t Timer )
+{
+   HandleTimer_t *pTimer = FindHandle(Timer);
+   ES_Event NewEvent;
+
+   if( pTimer == NULL )
+      return;
+   if( pTimer->Period != 0 )
+      ES_WheelStart(Timer, pTimer->Period);
+   NewEvent.EventType = ES_TIMEOUT;
+   NewEvent.EventParam = Timer;
+   ES_TRACE(ES_TRACE_TIMEOUT, (uint8_t)Timer, NewEvent);
+   if( pTimer->pCallback != NULL )
+      pTimer->pCallback(Timer);
+   else
+      ES_PostToService(pTimer->Service, NewEvent);
+   NumPosted++;
+}
+#endif /* ES_NUM_TIMER_HANDLES */
+#endif
 /*------------------------------- Footnotes -------------------------------*/
 /*------------------------------ End of file ------------------------------*/
 
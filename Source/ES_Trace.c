@@ -0,0 +1,185 @@
+/****************************************************************************
+ Module
+     ES_Trace.c
+
+ Description
+     This is a module implementing a binary trace of the event flow through
+     the framework. Records are written to a RAM ring buffer and are drained
+     to the console in bulk by ES_TraceDump.
+
+ Notes
+     The framework calls ES_TraceRecord (through the ES_TRACE macro) on every
+     post, every dispatch in ES_Run and every timer expiration, so this must
+     stay cheap: no formatting is done until the buffer is dumped, and the
+     decoding is done on the host by Tools/es_trace_decode.py.
+     When the buffer fills, the oldest records are overwritten, so a dump
+     always shows the most recent ES_TRACE_SIZE records.
+
+ History
+ When           Who     What/Why
+ -------------- ---     --------
+****************************************************************************/
+
+/*----------------------------- Include Files -----------------------------*/
+#include "ES_Configure.h"
+#include "ES_General.h"
+#include "ES_Port.h"
+#include "ES_Timers.h"
+#include "ES_Trace.h"
+
+#ifdef ES_USE_TRACE
+/*--------------------------- External Variables --------------------------*/
+
+/*----------------------------- Module Defines ----------------------------*/
+#if (ES_TRACE_SIZE & (ES_TRACE_SIZE - 1)) != 0
+#error "ES_TRACE_SIZE must be a power of 2"
+#endif
+
+#define TRACE_INDEX_MASK (ES_TRACE_SIZE - 1)
+
+// the dump is framed by these so that the host tool can find it among the
+// console text
+#define TRACE_VERSION 1
+static const char DumpHeader[] = "ESTR";
+static const char DumpTrailer[] = "END!";
+
+/*------------------------------ Module Types -----------------------------*/
+
+/*---------------------------- Module Functions ---------------------------*/
+static void PutBytes( const char *pBytes, uint8_t NumBytes );
+static void PutWord( uint16_t Word );
+
+/*---------------------------- Module Variables ---------------------------*/
+static ES_TraceRec_t TraceBuffer[ES_TRACE_SIZE];
+static uint16_t NextEntry;    // where the next record goes
+static uint16_t NumEntries;   // how many valid records, up to ES_TRACE_SIZE
+static uint16_t NumLost;      // records overwritten since the last dump
+static uint8_t NextSeq;
+static bool Paused;
+
+/*------------------------------ Module Code ------------------------------*/
+/****************************************************************************
+ Function
+     ES_TraceRecord
+ Parameters
+     uint8_t Kind, one of ES_TraceKind_t
+     uint8_t Service, the service priority, timer number or 0xFF
+     uint8_t EventType, the event type
+     uint16_t Param, the event parameter
+ Returns
+     None.
+ Description
+     adds one record to the trace ring buffer, overwriting the oldest if
+     the buffer is full
+ Notes
+     May be called from interrupt responses, but not from inside a region
+     protected by EnterCritical/ExitCritical since it uses one itself
+****************************************************************************/
+void ES_TraceRecord( uint8_t Kind, uint8_t Service, uint8_t EventType,
+                     uint16_t Param )
+{
+  ES_TraceRec_t *pRec;
+
+  if ( Paused )
+    return;
+  EnterCritical();
+  pRec = &TraceBuffer[NextEntry];
+  pRec->Tick = (uint16_t)ES_Timer_GetTime();
+  pRec->Seq = NextSeq++;
+  pRec->Kind = Kind;
+  pRec->Service = Service;
+  pRec->EventType = EventType;
+  pRec->Param = Param;
+  NextEntry = (NextEntry + 1) & TRACE_INDEX_MASK;
+  if ( NumEntries < ES_TRACE_SIZE )
+    NumEntries++;
+  else
+    NumLost++;
+  ExitCritical();
+}
+
+/****************************************************************************
+ Function
+     ES_TraceDump
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     writes the contents of the trace buffer, oldest first, to the console
+     as binary and then empties the buffer.
+ Notes
+     The dump is "ESTR", version, record size, record count (16 bits), lost
+     count (16 bits), the records and then "END!". All 16 bit values are sent
+     LSB first. Recording is paused while the dump is in progress, which takes
+     about 1mS per 11 records at 115200 baud.
+****************************************************************************/
+void ES_TraceDump( void )
+{
+  uint16_t Index;
+  uint16_t Count;
+  ES_TraceRec_t *pRec;
+
+  Paused = true;
+  PutBytes( DumpHeader, 4 );
+  TERMIO_PutChar( TRACE_VERSION );
+  TERMIO_PutChar( sizeof(ES_TraceRec_t) );
+  PutWord( NumEntries );
+  PutWord( NumLost );
+  // the oldest record is NumEntries back from the next one to be written
+  Index = (NextEntry - NumEntries) & TRACE_INDEX_MASK;
+  for ( Count = 0; Count < NumEntries; Count++ )
+  {
+    pRec = &TraceBuffer[Index];
+    PutWord( pRec->Tick );
+    TERMIO_PutChar( pRec->Seq );
+    TERMIO_PutChar( pRec->Kind );
+    TERMIO_PutChar( pRec->Service );
+    TERMIO_PutChar( pRec->EventType );
+    PutWord( pRec->Param );
+    Index = (Index + 1) & TRACE_INDEX_MASK;
+  }
+  PutBytes( DumpTrailer, 4 );
+  ES_TraceClear();
+  Paused = false;
+}
+
+/****************************************************************************
+ Function
+     ES_TraceClear
+ Parameters
+     None.
+ Returns
+     None.
+ Description
+     empties the trace buffer and zeros the lost record count
+ Notes
+     the sequence number keeps running so that the host can tell dumps apart
+****************************************************************************/
+void ES_TraceClear( void )
+{
+  EnterCritical();
+  NextEntry = 0;
+  NumEntries = 0;
+  NumLost = 0;
+  ExitCritical();
+}
+
+/***************************************************************************
+ private functions
+ ***************************************************************************/
+static void PutBytes( const char *pBytes, uint8_t NumBytes )
+{
+  while ( NumBytes-- > 0 )
+    TERMIO_PutChar( *pBytes++ );
+}
+
+static void PutWord( uint16_t Word )
+{
+  TERMIO_PutChar( (unsigned char)(Word & 0xFF) );
+  TERMIO_PutChar( (unsigned char)(Word >> 8) );
+}
+
+#endif /* ES_USE_TRACE */
+/*------------------------------- Footnotes -------------------------------*/
+/*------------------------------ End of file ------------------------------*/
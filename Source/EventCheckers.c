@@ -26,6 +26,7 @@
 #include "ES_ServiceHeaders.h"
 #include "ES_Port.h"
 #include "EventCheckers.h"
+#include "KeyboardService.h"
 #include "KnobService.h"
 #include "ResetService.h"
 
@@ -254,6 +254,39 @@ void PostKeyboardEventGenerator( ES_Event ThisEvent ){
 		PsuedoEvent.EventType = ES_SLEEP;
 		PostResetService(PsuedoEvent);
 	}
+#ifdef ES_USE_PROFILER
+	if (ThisEvent.EventParam=='p'){
+		// dump the per-service dispatch profile, then start a fresh one
+		ES_DumpProfile();
+		ES_ClearProfile();
+	}
+#endif
+#ifdef ES_USE_WAIT_STATS
+	if (ThisEvent.EventParam=='a'){
+		// dump how long each priority waits to be dispatched, then start afresh
+		ES_DumpWaitStats();
+		ES_ClearWaitStats();
+	}
+#endif
+#ifdef ES_USE_SECTIONS
+	if (ThisEvent.EventParam=='s'){
+		// dump the code section timings, then start a fresh set
+		ES_DumpSections();
+		ES_ClearSections();
+	}
+#endif
+#ifdef ES_USE_TRACE
+	if (ThisEvent.EventParam=='d'){
+		// send the binary event trace to the console for es_trace_decode.py
+		ES_TraceDump();
+	}
+#endif
+#ifdef ES_USE_RECORD
+	if (ThisEvent.EventParam=='v'){
+		// send the input recording to the console, for replay on the host
+		ES_RecordDump();
+	}
+#endif
 	if (ThisEvent.EventParam=='c'){
 		// When the perfomance is done and the user presses reset
 		printf("LIFECYCLE_START_WELCOME_PERFORMANCE\r\n");
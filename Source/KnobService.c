@@ -37,6 +37,10 @@ static uint32_t getADCStateKnob(void);
 static uint32_t getADCDiffKnob(uint32_t CurrentADCStateKnob, uint32_t LastADCStateKnob);
 static void startKnobVibration(uint32_t Voltage);
 static void stopKnobVibration(void);
+#ifdef ES_NUM_TIMER_HANDLES
+static void startVibrationTimer(void);
+static void vibrationDone(ES_TimerHandle_t Timer);
+#endif
 
 
 /*---------------------------- Module Variables ---------------------------*/
@@ -44,6 +48,10 @@ static void stopKnobVibration(void);
 static uint8_t MyPriority;
 static KnobState_t CurrentState;
 static uint32_t LastADCStateKnob;
+#ifdef ES_NUM_TIMER_HANDLES
+// stops the vibrator straight from the tick, see vibrationDone
+static ES_TimerHandle_t VibrationTimer;
+#endif
 
 
 /*------------------------------ Module Code ------------------------------*/
@@ -81,8 +89,14 @@ bool InitKnobService ( uint8_t Priority )
 	// The knon does not vibrate on startup
 	CurrentState = KnobVibrating;
 	
-	// Intialize the KNOB_VIBRATION_TIMER
+	// Intialize the timer system and get a timer to end the vibration
 	ES_Timer_Init(ES_Timer_RATE_1mS);
+#ifdef ES_NUM_TIMER_HANDLES
+	VibrationTimer = ES_TimerCreateCallback(vibrationDone);
+	if (VibrationTimer == ES_TIMER_NO_HANDLE) {
+		return false;
+	}
+#endif
 	
 	// The Knob Serices uses port 8 on the Tiva ADC
 	// Initializing group four, initilizes port 7&8
@@ -107,7 +121,7 @@ bool InitKnobService ( uint8_t Priority )
 ****************************************************************************/
 bool PostKnobService( ES_Event ThisEvent )
 {
-	printf("Knob Service: Message posted Knob service\n\r");
+  // the queue coalesces the settings, see QUEUE_POLICY_LIST
   return ES_PostToService( MyPriority, ThisEvent);
 }
 
@@ -156,15 +170,23 @@ ES_Event RunKnobService( ES_Event ThisEvent )
 		// Exit this state when the timer stops
 		case KnobVibrating:
 			if(ThisEvent.EventType == CHANGE_KNOB_VIBRATION){
+				// Start the vibration time again
+#ifdef ES_NUM_TIMER_HANDLES
+				startVibrationTimer();
+				startKnobVibration(ThisEvent.EventParam);
+#else
 				startKnobVibration(ThisEvent.EventParam);
 				ES_Timer_StopTimer(KNOB_VIBRATION_TIMER);
 				ES_Timer_InitTimer(KNOB_VIBRATION_TIMER, VIBRATION_TIME);
+#endif
 			}
+#ifndef ES_NUM_TIMER_HANDLES
 			if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == KNOB_VIBRATION_TIMER){
 				// Move to the sleeping mode
 				CurrentState = KnobSleeping;
 				stopKnobVibration();
 			}
+#endif
 		break;
 	
 		// In this state the knob is stopped
@@ -172,9 +194,14 @@ ES_Event RunKnobService( ES_Event ThisEvent )
 		case KnobSleeping:
 			if(ThisEvent.EventType == CHANGE_KNOB_VIBRATION){
 				// Wake up and start vibrating
+#ifdef ES_NUM_TIMER_HANDLES
+				startVibrationTimer();
+				startKnobVibration(ThisEvent.EventParam);
+#else
 				startKnobVibration(ThisEvent.EventParam);
 				ES_Timer_InitTimer(KNOB_VIBRATION_TIMER, VIBRATION_TIME);
 				CurrentState = KnobVibrating;
+#endif
 			}
 		break;
 	}
@@ -237,6 +264,54 @@ void stopKnobVibration(void) {
 
 
 
+#ifdef ES_NUM_TIMER_HANDLES
+/****************************************************************************
+ Function
+    startVibrationTimer
+
+ Parameters
+   None
+
+ Returns
+   Nothing
+
+ Description
+    Starts the vibration time again and moves to the vibrating mode.
+    vibrationDone can run from the tick in the middle of the run function,
+    so both are done in a critical region, and before the knob is started
+    so that it can not be stopped again straight away
+****************************************************************************/
+static void startVibrationTimer(void) {
+	EnterCritical();
+	ES_TimerStart(VibrationTimer, VIBRATION_TIME);
+	CurrentState = KnobVibrating;
+	ExitCritical();
+}
+
+/****************************************************************************
+ Function
+    vibrationDone
+
+ Parameters
+   ES_TimerHandle_t : the vibration timer
+
+ Returns
+   Nothing
+
+ Description
+    Called from the tick when the vibration time is up. Stops the knob
+    vibrating and moves to the sleeping mode without a trip through the
+    queue
+****************************************************************************/
+static void vibrationDone(ES_TimerHandle_t Timer) {
+	CurrentState = KnobSleeping;
+	stopKnobVibration();
+}
+#endif
+
+
+
+
 /****************************************************************************
  Function
     getADCStateKnob
@@ -176,6 +176,8 @@ ES_Event RunLEDService( ES_Event ThisEvent )
 				BitCounter = 0;
 				WelcomeHex = 0xD5BB8000;
 				lightLEDWelcome(WelcomeHex);
+				// step the welcome on every quarter second
+				ES_Timer_InitPeriodic(WELCOME_LED_TIMER, QUARTER_SEC); //(timer posts to RunLEDService)
 			}
 		break;
 
@@ -194,6 +196,7 @@ ES_Event RunLEDService( ES_Event ThisEvent )
 				} else {
 					// Welcome mode is complete
 					NextMode = LEDWaiting4ADC;
+					ES_Timer_StopTimer(WELCOME_LED_TIMER);
 					printf("LEDService [Welcome Mode]: Waiting for ADC data\r\n");
 					TransitionEvent.EventType = ES_WELCOME_COMPLETE;
 					PostResetService(TransitionEvent);
@@ -307,16 +310,16 @@ void lightLED(uint32_t LEDHex) {
 	// Lower the register clock
 	//HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) &= ~(GPIO_PIN_2);
 	// Shift out data while pulsing SCLK
-	
-	printf("\r\n");
+	ES_SECTION_BEGIN(lightLED);
+	// record the pattern in the event trace rather than printing each bit
+	ES_TRACE_USER_REC(MyPriority, (uint16_t)(LEDHex >> 16));
+	ES_TRACE_USER_REC(MyPriority, (uint16_t)LEDHex);
 	for(int i=0; i < LEDBits; i++)
 	{
 		if((LEDHex & 0x80000000) == 0x80000000){
 			HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) |= GPIO_PIN_0;   
-			printf("1");
 		} else {
 			HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) &= ~(GPIO_PIN_0);
-			printf("0");
 		}
 		
 		// Pulse SCLK(PB1)
@@ -324,10 +327,10 @@ void lightLED(uint32_t LEDHex) {
 		HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) &= ~(GPIO_PIN_1);
 		LEDHex = LEDHex << 1;
 	}
-	printf("\r\n");
 	// Raise the register clock to latch the new data
 	HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) |= (GPIO_PIN_2);
 	HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) &= ~(GPIO_PIN_2);
+	ES_SECTION_END(lightLED);
 }
 
 
@@ -358,10 +361,6 @@ void lightLEDWelcome(uint32_t LEDHex) {
 	// Pulse RCLK(PB2) to latch new data
 	HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) |= (GPIO_PIN_2);
 	HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) &= ~(GPIO_PIN_2);
-	
-	
-	ES_Timer_InitTimer(WELCOME_LED_TIMER, QUARTER_SEC); //(timer posts to RunLEDService)
-	//printf("Welcome Timer Set Up.\r\n");
 }
 
 
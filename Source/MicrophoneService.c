@@ -27,6 +27,7 @@
 */
 #include "ES_Configure.h"
 #include "ES_Framework.h"
+#include "ES_ServiceHeaders.h"
 #include "ES_DeferRecall.h"
 #include "ES_ShortTimer.h"
 
@@ -50,6 +51,7 @@
 #include "kiss_fft.h"
 
 #include "ADMulti.h"
+#include "ADFrames.h"
 
 // Include services we need to post to
 #include "WatertubeService.h"
@@ -69,8 +71,21 @@
 
 #define N 128
 #define MICROPHONE_PIN 0 
+#define NUM_MIC_TUBES 6 // tubes 1 to 6 follow the microphone
+// microseconds between FFTs while the water tubes are falling behind
+#define THROTTLED_PAUSE 20000
+#ifdef MIC_USE_ADC_FRAMES
+#ifdef ES_USE_RECORD
+#error "MIC_USE_ADC_FRAMES can not be used with ES_USE_RECORD"
+#endif
+#define SAMPLING_FREQUENCY MIC_SAMPLE_RATE
+// frames dropped for the pause between FFTs while throttled
+#define THROTTLED_FRAMES \
+  (THROTTLED_PAUSE / 1000UL * MIC_SAMPLE_RATE / 1000 / ADC_FRAME_LEN)
+#else
 #define SAMPLING_PERIOD 50 // (50+150 overhead) microseconds -> 5000Hz
 #define SAMPLING_FREQUENCY 1000*1000/(SAMPLING_PERIOD+100)
+#endif
 
 /*---------------------------- Module Functions ---------------------------*/
 /* prototypes for private functions for this service. They should be functions
@@ -80,10 +95,17 @@ static void PrintAudioBuffer( void );
 static void PrintFourierBuffer( void );
 static void PrintAverageBuffer( void );
 static void PushAudioBuffer(float newValue);
+#ifdef MIC_USE_ADC_FRAMES
+static void PushAudioFrame(const uint16_t *pFrame);
+#endif
+static void StartSampling(void);
+static void SampleAgain(bool Pause);
 static void PushAverageBuffer( void );
 static float SumFourierOutputs(uint16_t Start, uint16_t End);
 static float GetWaterHeight(uint8_t WaterTubeNumber, float Sensitivity);
 static void PerformFFT(void);
+static void PostWaterHeights(float Sensitivity);
+static void WatertubeAlert(uint8_t WhichService, bool Congested);
 	
 static void TestFft(const char* title, const kiss_fft_cpx in[N], kiss_fft_cpx out[N]);
 static void RunFFTTest(void);
@@ -95,14 +117,29 @@ static float max(float a, float b);
 // with the introduction of Gen2, we need a module level Priority variable
 static uint8_t MyPriority;
 
+#ifdef MIC_USE_ADC_FRAMES
+// frames still to drop before the next FFT
+static uint8_t FramesToSkip;
+#else
+// paces the samples and the pauses between FFTs
+static ES_ShortTimer_t SampleTimer;
+#endif
+
 static uint8_t CurrentState;
 
+// set while the water tube queue is congested, see WatertubeAlert
+static bool Throttled;
+
 // We keep a buffer of N values to perform the FFT over
 // New values are pushed to the front of the array and any overflow is discarded
 // After performing the fourier transform we are left with N FourierOutput values
 static kiss_fft_cpx AudioBuffer[N];
 static kiss_fft_cpx FourierOutput[N];
 static float AverageBuffer[N/2];
+// Memory for the kiss_fft configuration (1288 bytes for N=128 on the Tiva).
+// Without this kiss_fft_alloc builds it in a local array that has gone out
+// of scope by the time it is used
+static uint32_t FFTConfigMem[1536/sizeof(uint32_t)];
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -135,8 +172,16 @@ bool InitMicrophoneService( uint8_t Priority )
 	// Run a quick test to make sure the FFT logic works correctly
 	//RunFFTTest();
 
+#ifdef MIC_USE_ADC_FRAMES
+	// Set up the timer triggered sampling, which posts a frame at a time
+	ADC_FrameInit(MyPriority);
+#else
 	// Set up the short timer for inter-command timings
-  ES_ShortTimerInit(MyPriority, SHORT_TIMER_UNUSED);
+  SampleTimer = ES_ShortTimerCreate(MyPriority);
+#endif
+
+	// Slow down if the water tubes can not keep up with us
+	ES_SetQueueAlert(ES_PRIORITY(RunWatertubeService), WatertubeAlert);
 
   // Post the initial transition event
   ThisEvent.EventType = ES_INIT;
@@ -182,7 +227,6 @@ bool PostMicrophoneService( ES_Event ThisEvent )
 ES_Event RunMicrophoneService( ES_Event ThisEvent )
 {
 	float Sensitivity = 12;
-	ES_Event WaterTubeEvent;
 	ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT;
 	uint32_t ADInput[4];
@@ -190,6 +234,12 @@ ES_Event RunMicrophoneService( ES_Event ThisEvent )
 	static uint8_t FourierCounter;
 	float intensity = 0;	
 	
+#ifdef MIC_USE_ADC_FRAMES
+	// No frames while asleep, MICROPHONE_START starts them again
+	if (ThisEvent.EventType==ES_SLEEP){
+		ADC_FrameStop();
+	}
+#endif
 	switch(CurrentState){
 		case MicrophoneInitState:
 			// This state prepares everythin for sampling
@@ -197,7 +247,7 @@ ES_Event RunMicrophoneService( ES_Event ThisEvent )
 			if (ThisEvent.EventType==MICROPHONE_START){
 				printf("Microphone: Enagaging the Microphone\r\n");
 				CurrentState = MicrophoneWaitForSample;
-				ES_ShortTimerStart(TIMER_A,SAMPLING_PERIOD);
+				StartSampling();
 			} else if (ThisEvent.EventType==ES_SLEEP){
 				// This service was commanded to sleep
 				CurrentState = MicrophoneSleepingState;
@@ -240,9 +290,26 @@ ES_Event RunMicrophoneService( ES_Event ThisEvent )
 					SampleCounter = 0;
 				} else{
 					// Sample again soon
-					ES_ShortTimerStart(TIMER_A,SAMPLING_PERIOD);
+					SampleAgain(false);
 				}
 			}
+#ifdef MIC_USE_ADC_FRAMES
+			// the queue coalesces the frames, see QUEUE_POLICY_LIST, so this is
+			// always the newest one and still good to read
+			if (ThisEvent.EventType==ADC_FRAME_READY){
+				if (FramesToSkip > 0){
+					FramesToSkip--;
+				} else {
+					// A frame holds the 64 samples for the FFT all at once
+					ES_Event CurrentEvent;
+					PushAudioFrame(ADC_FrameData(ThisEvent.EventParam));
+					CurrentState = MicrophoneFourierState;
+					CurrentEvent.EventType = MICROPHONE_SOUND_RECORDED;
+					CurrentEvent.EventParam = 0;
+					PostMicrophoneService(CurrentEvent);
+				}
+			}
+#endif
 			if (ThisEvent.EventType==ES_SLEEP){
 				// This service was commanded to sleep
 				CurrentState = MicrophoneSleepingState;
@@ -253,7 +320,7 @@ ES_Event RunMicrophoneService( ES_Event ThisEvent )
 			// In this state we are calculating new fourier values
 		  // After this state we either start sampling again, or go
 		  // to the MicrophoneWaterState
-			printf(".");
+			ES_TRACE_USER_REC(MyPriority, FourierCounter);
 			
 			if (ThisEvent.EventType==MICROPHONE_SOUND_RECORDED){
 				// Calculate the FFT.
@@ -272,9 +339,10 @@ ES_Event RunMicrophoneService( ES_Event ThisEvent )
 					PostMicrophoneService(CurrentEvent);
 					FourierCounter = 0;
 				} else {
-					// Default: Move back to the sampling state
+					// Default: Move back to the sampling state, after a pause
+					// if the water tubes are behind
 					CurrentState = MicrophoneWaitForSample;
-					ES_ShortTimerStart(TIMER_A,SAMPLING_PERIOD);
+					SampleAgain(Throttled);
 				}
 			}
 			if (ThisEvent.EventType==ES_SLEEP){
@@ -293,41 +361,8 @@ ES_Event RunMicrophoneService( ES_Event ThisEvent )
 				//PrintFourierBuffer();
 				//PrintAverageBuffer();
 					
-				// Water tube 1
-				WaterTubeEvent.EventType = CHANGE_WATER_1;
-				WaterTubeEvent.EventParam = GetWaterHeight(1, Sensitivity);
-				PostWatertubeService(WaterTubeEvent);
-				printf("Water1 = %f\r\n",GetWaterHeight(1, Sensitivity));
-
-				// Water tube 2					
-				WaterTubeEvent.EventType = CHANGE_WATER_2;
-				WaterTubeEvent.EventParam = GetWaterHeight(2, Sensitivity);
-				PostWatertubeService(WaterTubeEvent);
-				printf("Water2 = %f\r\n",GetWaterHeight(2, Sensitivity));
-				
-				// Water tube 3
-				WaterTubeEvent.EventType = CHANGE_WATER_3;
-				WaterTubeEvent.EventParam = GetWaterHeight(3, Sensitivity);
-				PostWatertubeService(WaterTubeEvent);
-				printf("Water3 = %f\r\n",GetWaterHeight(3, Sensitivity));
-				
-				// Water tube 4
-				WaterTubeEvent.EventType = CHANGE_WATER_4;
-				WaterTubeEvent.EventParam = GetWaterHeight(4, Sensitivity);
-				PostWatertubeService(WaterTubeEvent);
-				printf("Water4 = %f\r\n",GetWaterHeight(4, Sensitivity));
-				
-				// Water tube 5
-				WaterTubeEvent.EventType = CHANGE_WATER_5;
-				WaterTubeEvent.EventParam = GetWaterHeight(5, Sensitivity);
-				PostWatertubeService(WaterTubeEvent);
-				printf("Water5 = %f\r\n",GetWaterHeight(5, Sensitivity));
-				
-				// Water tube 6
-				WaterTubeEvent.EventType = CHANGE_WATER_6;
-				WaterTubeEvent.EventParam = GetWaterHeight(6, Sensitivity);
-				PostWatertubeService(WaterTubeEvent);
-				printf("Water6 = %f\r\n",GetWaterHeight(6, Sensitivity));
+				// Post the heights of water tubes 1 to 6
+				PostWaterHeights(Sensitivity);
 				
 				// Water tube 7
 				//WaterTubeEvent.EventType = CHANGE_WATER_7;
@@ -345,7 +380,7 @@ ES_Event RunMicrophoneService( ES_Event ThisEvent )
 			}
 			// Loop back around. Start sampling again
 			CurrentState = MicrophoneWaitForSample;
-			ES_ShortTimerStart(TIMER_A,SAMPLING_PERIOD);
+			SampleAgain(false);
 		break;
 			
 		case MicrophoneSleepingState:
@@ -496,6 +531,71 @@ static void PushAudioBuffer(float newValue){
 
 
 
+#ifdef MIC_USE_ADC_FRAMES
+/****************************************************************************
+ Function
+    PushAudioFrame
+
+	Description
+		Push a frame of ADC_FRAME_LEN samples, oldest first, to the audio
+		buffer, as PushAudioBuffer does one normalized sample at a time
+****************************************************************************/
+static void PushAudioFrame(const uint16_t *pFrame){
+	// Shift all items right by a frame
+	for (int k=N-1; k >= ADC_FRAME_LEN; k--){
+		AudioBuffer[k].r = AudioBuffer[k-ADC_FRAME_LEN].r;
+		AudioBuffer[k].i = 0;
+	}
+	// The newest sample goes in [0]
+	for (int k=0; k < ADC_FRAME_LEN; k++){
+		AudioBuffer[ADC_FRAME_LEN-1-k].r = (float)pFrame[k]/4096;
+		AudioBuffer[ADC_FRAME_LEN-1-k].i = 0;
+	}
+}
+#endif
+
+
+
+/****************************************************************************
+ Function
+    StartSampling
+
+	Description
+		Start taking samples, with the short timer or as frames
+****************************************************************************/
+static void StartSampling(void){
+#ifdef MIC_USE_ADC_FRAMES
+	FramesToSkip = 0;
+	ADC_FrameStart(MIC_SAMPLE_RATE);
+#else
+	ES_ShortTimerStart(SampleTimer,SAMPLING_PERIOD);
+#endif
+}
+
+
+
+/****************************************************************************
+ Function
+    SampleAgain
+
+	Parameters
+		bool Pause, true to wait THROTTLED_PAUSE first
+
+	Description
+		Ask for the next sample. The frames keep coming by themselves, so
+		then a pause just drops the frames that it covers
+****************************************************************************/
+static void SampleAgain(bool Pause){
+#ifdef MIC_USE_ADC_FRAMES
+	FramesToSkip = Pause ? THROTTLED_FRAMES : 0;
+#else
+	ES_ShortTimerStart(SampleTimer,
+					Pause ? THROTTLED_PAUSE : SAMPLING_PERIOD);
+#endif
+}
+
+
+
 /****************************************************************************
  Function
     PushAverageBuffer
@@ -507,6 +607,7 @@ static void PushAudioBuffer(float newValue){
 static void PushAverageBuffer(void){
 	float squared = 0;
 	float maximum = 0;
+	ES_SECTION_BEGIN(PushAverageBuffer);
 	// Add the squared magnitude onto the buffer [float math]
 	for (int k=1; k < N/2; k++){  
 			squared = square(FourierOutput[k].r) + square(FourierOutput[k].i);
@@ -525,6 +626,7 @@ static void PushAverageBuffer(void){
 			//printf("%i: 100*%f/%f = %f\r\n",k,AverageBuffer[k],maximum,100*AverageBuffer[k]/maximum);
 			AverageBuffer[k] = 128*AverageBuffer[k]/maximum;
 	}
+	ES_SECTION_END(PushAverageBuffer);
 }
 
 
@@ -572,10 +674,12 @@ static float SumFourierOutputs(uint16_t Start, uint16_t End){
 static void PerformFFT(void){
 	// cfg is a type defined by kiss_fourier to manage state
   kiss_fft_cfg cfg;
+  size_t ConfigSize = sizeof(FFTConfigMem);
 
 	//printf("Start Fourier Transform\r\n");
 
-	cfg = kiss_fft_alloc(N, 0, NULL, NULL);
+	ES_SECTION_BEGIN(PerformFFT);
+	cfg = kiss_fft_alloc(N, 0, FFTConfigMem, &ConfigSize);
   if (cfg != NULL)
   {
 		// Perform the transform
@@ -584,6 +688,7 @@ static void PerformFFT(void){
 		printf("FOURIER TRANSFORM FAILED?\n");
     printf("NOT ENOUGH MEMORY?\n");
   }	
+	ES_SECTION_END(PerformFFT);
 	//printf("End Fourier Transform\r\n");
 }
 
@@ -591,6 +696,75 @@ static void PerformFFT(void){
 
 
 
+/****************************************************************************
+ Function
+    PostWaterHeights
+
+ Parameters
+   float Sensitivity, the gain applied to the spectrum
+
+ Description
+   Posts the heights of water tubes 1 to NUM_MIC_TUBES to the WatertubeService.
+   With the event pool this is one WATER_HEIGHTS event carrying all of the
+   heights as floats, otherwise (or if the pool is empty) it is a batch of
+   one CHANGE_WATER_n event per tube with the height truncated to 16 bits
+****************************************************************************/
+static void PostWaterHeights(float Sensitivity){
+	ES_Event WaterTubeEvents[NUM_MIC_TUBES];
+	float Heights[NUM_MIC_TUBES];
+	uint8_t i;
+#ifdef ES_USE_EVENT_POOL
+	ES_Event WaterTubeEvent;
+	WaterHeights_t *pHeights;
+#endif
+
+	for (i=0; i<NUM_MIC_TUBES; i++){
+		Heights[i] = GetWaterHeight(i+1, Sensitivity);
+		printf("Water%u = %f\r\n",i+1,Heights[i]);
+	}
+
+#ifdef ES_USE_EVENT_POOL
+	pHeights = ES_PoolAlloc();
+	if (pHeights != NULL){
+		pHeights->NumTubes = NUM_MIC_TUBES;
+		for (i=0; i<NUM_MIC_TUBES; i++){
+			pHeights->Height[i] = Heights[i];
+		}
+		WaterTubeEvent.EventType = WATER_HEIGHTS;
+		WaterTubeEvent.EventParam = NUM_MIC_TUBES;
+		WaterTubeEvent.pPayload = pHeights;
+		PostWatertubeService(WaterTubeEvent);
+		// the queued event holds its own reference, so let go of ours
+		ES_PoolRelease(pHeights);
+		return;
+	}
+#endif
+	// all of the tubes go to the WatertubeService in one batch
+	for (i=0; i<NUM_MIC_TUBES; i++){
+		WaterTubeEvents[i].EventType = (ES_EventTyp_t)(CHANGE_WATER_1 + i);
+		WaterTubeEvents[i].EventParam = Heights[i];
+	}
+	ES_PostToServiceBatch(ES_PRIORITY(RunWatertubeService), WaterTubeEvents,
+	                      NUM_MIC_TUBES);
+}
+
+/****************************************************************************
+ Function
+    WatertubeAlert
+
+ Parameters
+   uint8_t WhichService, the service whose queue it is
+   bool Congested, true if the queue is full or losing events
+
+ Description
+   The queue alert for the WatertubeService (see ES_SetQueueAlert). While
+   the water tubes are behind, the microphone pauses between FFTs rather
+   than filling their queue with heights they will never get to
+****************************************************************************/
+static void WatertubeAlert(uint8_t WhichService, bool Congested){
+	Throttled = Congested;
+}
+
 /****************************************************************************
  Function
     RunFFTTest
@@ -25,6 +25,7 @@
 #include "driverlib/pwm.h"
 
 #include "PWM10Tiva.h"
+#include "ES_Section.h"
 
 #define MAX_NUM_CHANNELS 12
                                          
@@ -198,10 +199,12 @@ bool PWM_TIVA_SetPulseWidth( uint16_t NewPW, uint8_t channel)
 {
   if (channel > MaxConfiguredChannel) // sanity check, reasonable channel number
     return false;
+  ES_SECTION_BEGIN(PWM_TIVA_SetPulseWidth);
   // make sure that the requested PW is less than the period before updating 
   if ( NewPW < ulPeriod[channel>>1]){  
     PWMPulseWidthSet(Channel2PWM_MOD[channel], Channel2PWMconst[channel],NewPW); 
   }    
+  ES_SECTION_END(PWM_TIVA_SetPulseWidth);
   return true;
 }
 
@@ -68,7 +68,8 @@ static void resetSleep(void);
 /*---------------------------- Module Variables ---------------------------*/
 // with the introduction of Gen2, we need a module level Priority variable
 static uint8_t MyPriority;
-static uint16_t InteractionTime;
+// when the performance started, to time the passage of time water tube
+static ES_Time_t RunningSince;
 static ResetState_t CurrentState;
 static uint8_t LastButtonState;
 
@@ -100,7 +101,6 @@ bool InitializeResetService ( uint8_t Priority )
   HWREG(GPIO_PORTB_BASE+GPIO_O_DEN)|= GPIO_PIN_3;
   HWREG(GPIO_PORTB_BASE+GPIO_O_DIR)&= ~GPIO_PIN_3;
 	
-	InteractionTime = 0;
 	CurrentState = ResetInit;
 	
 	//Set up timer system
@@ -180,6 +180,7 @@ ES_Event RunResetService( ES_Event ThisEvent )
   ES_Event ReturnEvent;
   ReturnEvent.EventType = ES_NO_EVENT;
 	ES_Event PostEvent;
+	ES_Time_t Elapsed;
 
 	switch (CurrentState){
 		// Psuedo Init State
@@ -197,7 +198,11 @@ ES_Event RunResetService( ES_Event ThisEvent )
 		case ResetWelcome:
 			if (ThisEvent.EventType == ES_WELCOME_COMPLETE) {		
 				printf("ResetService: Welcome Performance is Complete\r\n");
-				ES_Timer_InitTimer(PASSAGE_OF_TIME_TIMER, HALF_SEC);
+				// The performance runs for 45 seconds on a single timer, the
+				// passage of time timer only updates the water tube
+				ES_Timer_InitPeriodic(PASSAGE_OF_TIME_TIMER, HALF_SEC);
+				ES_Timer_InitTimer(PERFORMANCE_TIMER, FORTY_FIVE_SEC);
+				RunningSince = ES_Timer_GetTime();
 				ES_Timer_StopTimer(INACTIVITY_TIMER);
 				ES_Timer_InitTimer(INACTIVITY_TIMER, THIRTY_SEC);
 				// Start the microphone sampling
@@ -205,7 +210,6 @@ ES_Event RunResetService( ES_Event ThisEvent )
 				PostMicrophoneService(PostEvent);
 				// Move to the welcome state
 				CurrentState = ResetRunning;
-				InteractionTime = 0;
 			} else if (ThisEvent.EventType == ES_RESET_BUTTON) {
 				// Reset button pressed during welcome mode
 				printf("ResetService [Welcome]: Resetting\r\n");
@@ -222,15 +226,16 @@ ES_Event RunResetService( ES_Event ThisEvent )
 		// All services are waiting for feedback
 		// Exit when the inactivity timer expires or 45 seconds is up
 		case ResetRunning:
-			if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == PASSAGE_OF_TIME_TIMER && InteractionTime < 90) {
+			if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == PASSAGE_OF_TIME_TIMER) {
 				// Normal running loop
-				printf("Reset: Interaction Time %i\r\n",InteractionTime);
-				InteractionTime++;
+				Elapsed = ES_TIME_SINCE(RunningSince);
+				if (Elapsed > FORTY_FIVE_SEC)
+					Elapsed = FORTY_FIVE_SEC;
+				printf("Reset: Interaction Time %lu\r\n",(unsigned long)(Elapsed/HALF_SEC));
 				// Increase the passage of time water tube
 				PostEvent.EventType = CHANGE_WATER_7;
-				PostEvent.EventParam = (InteractionTime/90.0*4096);
+				PostEvent.EventParam = (uint16_t)((Elapsed*4096UL)/FORTY_FIVE_SEC);
 				PostWatertubeService(PostEvent);
-				ES_Timer_InitTimer(PASSAGE_OF_TIME_TIMER, HALF_SEC);
 				// Print keyboard instructions
 				if (VERBOSE){
 					printf("Reset [waiting]: Press '1-7' or 'q-u' to trigger servos\r\n");
@@ -240,7 +245,7 @@ ES_Event RunResetService( ES_Event ThisEvent )
 					printf("Reset [waiting]: Press 'x' to trigger reset (inactivity/timeout)\r\n");
 				}
 				
-		  } else if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == PASSAGE_OF_TIME_TIMER && InteractionTime >= 90) { 
+		  } else if (ThisEvent.EventType == ES_TIMEOUT && ThisEvent.EventParam == PERFORMANCE_TIMER) { 
 				// Main timer expired. Notify all service and move to Sleeping
 				PostEvent.EventType = ES_SLEEP;
 				PostResetService(PostEvent);
@@ -284,23 +289,23 @@ ES_Event RunResetService( ES_Event ThisEvent )
  ***************************************************************************/
 
 static void resetSleep(void) {
-	// Put all the service to sleep
+	// Put all the service to sleep, the subscribers are in ES_Configure.h
 	ES_Event PostEvent;
 	PostEvent.EventType = ES_SLEEP;
-	PostLEDService(PostEvent);
-	PostWatertubeService(PostEvent);
-	PostMicrophoneService(PostEvent);
+	PostEvent.EventParam = 0;
+	ES_Publish(PostEvent);
+	ES_Timer_StopTimer(PASSAGE_OF_TIME_TIMER);
+	ES_Timer_StopTimer(PERFORMANCE_TIMER);
 	CurrentState = ResetSleeping;
 }
 
 
 static void resetWake(void){
-	// Pull all of the three services out of sleeping mode
+	// Pull all of the sleeping services out of sleeping mode
 	ES_Event PostEvent;
 	PostEvent.EventType = ES_WAKE; 
-	PostLEDService(PostEvent);
-	PostWatertubeService(PostEvent);
-	PostMicrophoneService(PostEvent);
+	PostEvent.EventParam = 0;
+	ES_Publish(PostEvent);
 	// Reset the inactivity timer
 	ES_Timer_StopTimer(INACTIVITY_TIMER);
 	ES_Timer_InitTimer(INACTIVITY_TIMER, THIRTY_SEC);
@@ -309,7 +314,7 @@ static void resetWake(void){
 
 bool getButtonState(void) {
 	uint8_t ButtonState = HWREG(GPIO_PORTB_BASE+(GPIO_O_DATA + ALL_BITS)) & BIT3HI;
-	if (ButtonState) {
+	if (ES_INPUT_BUTTON(ButtonState != 0)) {
 		return true;
 	} else {
 		return false;
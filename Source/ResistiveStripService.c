@@ -80,7 +80,7 @@ bool InitResistiveStripService( uint8_t Priority )
 	puts("Resistive Strip: Intializing\r\n");
 	
 	//Set up timer system
-	ES_Timer_InitTimer(RESISTIVE_STRIP_TIMER, SAMPLING_INTERVAL);
+	ES_Timer_InitPeriodic(RESISTIVE_STRIP_TIMER, SAMPLING_INTERVAL);
 	
 	// Sample ADC port line PE1 and use it to initialize the LastADCState variable
   LastADCState = getADCState();
@@ -155,9 +155,6 @@ ES_Event RunResistiveStripService( ES_Event ThisEvent )
 			
 		// Update the LastADC variable
 		LastADCState = CurrentADCState;
-		
-		// Start the timer again
-		ES_Timer_InitTimer(RESISTIVE_STRIP_TIMER, SAMPLING_INTERVAL);
 	
 	}
   return ReturnEvent;
@@ -56,6 +56,9 @@ static WatertubeState_t CurrentState;
 
 /*---------------------------- Private Functions ---------------------------*/
 void setWatertube(uint8_t tubeNumber,uint16_t waterHeight);
+#ifdef ES_USE_EVENT_POOL
+static void setWatertubes(const WaterHeights_t *pHeights);
+#endif
 
 /*------------------------------ Module Code ------------------------------*/
 /****************************************************************************
@@ -117,6 +120,7 @@ bool InitWatertubeService( uint8_t Priority )
 ****************************************************************************/
 bool PostWatertubeService( ES_Event ThisEvent )
 {
+  // the queue coalesces the settings, see QUEUE_POLICY_LIST
   return ES_PostToService( MyPriority, ThisEvent);
 }
 
@@ -178,6 +182,12 @@ ES_Event RunWatertubeService( ES_Event ThisEvent )
 			if( ThisEvent.EventType == CHANGE_WATER_7){
 					setWatertube(7,ThisEvent.EventParam);
 			}
+#ifdef ES_USE_EVENT_POOL
+			// Change the heights of several tubes at once
+			if( ThisEvent.EventType == WATER_HEIGHTS){
+					setWatertubes((WaterHeights_t *)ThisEvent.pPayload);
+			}
+#endif
 			
 			// Reset all the tubes on sleep
 			if( ThisEvent.EventType == ES_SLEEP){
@@ -238,3 +248,36 @@ void setWatertube(uint8_t tubeNumber, uint16_t waterHeight){
 	}
 }
 
+#ifdef ES_USE_EVENT_POOL
+/****************************************************************************
+ Function
+    setWatertubes
+
+ Parameters
+   const WaterHeights_t *pHeights, the payload of a WATER_HEIGHTS event
+
+ Returns
+   Nothing
+
+ Description
+   Adjust the water height of tubes 1 to pHeights->NumTubes. The heights are
+   floats, so they are clipped into range before being truncated
+****************************************************************************/
+static void setWatertubes(const WaterHeights_t *pHeights){
+	uint8_t i;
+	float Height;
+
+	if (pHeights == NULL){
+		return;
+	}
+	for (i=0; (i < pHeights->NumTubes) && (i < NUM_WATER_TUBES); i++){
+		Height = pHeights->Height[i];
+		if (Height < 0){
+			Height = 0;
+		} else if (Height > UINT16_MAX){
+			Height = UINT16_MAX;
+		}
+		setWatertube(i+1,(uint16_t)Height);
+	}
+}
+#endif
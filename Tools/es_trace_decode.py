@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+es_trace_decode.py
+
+Decodes the binary event trace sent to the console by ES_TraceDump (see
+Source/ES_Trace.c) into a readable timeline.
+
+The event and service names are read from Headers/ES_Configure.h, so the
+output tracks the application without editing this file.
+
+Usage
+    es_trace_decode.py capture.bin            decode a saved console capture
+    es_trace_decode.py --port /dev/ttyACM0    send 'd' and decode the reply
+                                              (needs pyserial)
+
+The capture may contain ordinary console text around the dump; everything
+outside the ESTR ... END! frame is ignored. A capture with several dumps
+is decoded dump by dump.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+HEADER = b"ESTR"
+TRAILER = b"END!"
+VERSION = 1
+RECORD = struct.Struct("<HBBBBH")   # Tick, Seq, Kind, Service, EventType, Param
+
+# keep in step with ES_TraceKind_t in Headers/ES_Trace.h
+KINDS = {
+    1: "POST",
+    2: "POST_FAIL",
+    3: "POST_ALL",
+    4: "DISPATCH",
+    5: "TIMEOUT",
+    6: "USER",
+    7: "COALESCE",
+}
+NO_SERVICE = 0xFF
+
+DEFAULT_CONFIG = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                              "..", "Headers", "ES_Configure.h")
+
+
+def strip_comments(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    return re.sub(r"//[^\n]*", "", text)
+
+
+def read_config(path):
+    """Return (event names by value, service names by priority)."""
+    try:
+        with open(path) as f:
+            text = strip_comments(f.read())
+    except OSError:
+        return {}, {}
+
+    events = {}
+    match = re.search(r"typedef\s+enum\s*\{(.*?)\}\s*ES_EventTyp_t", text, re.S)
+    if match:
+        value = -1
+        for entry in match.group(1).split(","):
+            entry = entry.strip()
+            if not entry:
+                continue
+            name, _, init = entry.partition("=")
+            value = int(init.strip(), 0) if init.strip() else value + 1
+            events[value & 0xFF] = name.strip()
+
+    services = {}
+    match = re.search(r"#define\s+SERVICE_LIST\(SERVICE\)(.*?)(?:\n\s*\n|#)",
+                      text.replace("\\\n", " "), re.S)
+    if match:
+        runs = re.findall(r"SERVICE\(\s*\w+\s*,\s*Run(\w+?)(?:Service)?\s*,",
+                          match.group(1))
+        services = dict(enumerate(runs))
+    return events, services
+
+
+def find_dumps(data):
+    """Yield (records, lost) for each complete dump in data."""
+    start = 0
+    while True:
+        start = data.find(HEADER, start)
+        if start < 0:
+            return
+        pos = start + len(HEADER)
+        if len(data) < pos + 6:
+            return
+        version, size, count, lost = struct.unpack_from("<BBHH", data, pos)
+        pos += 6
+        end = pos + count * size
+        if (version != VERSION or size != RECORD.size or
+                data[end:end + len(TRAILER)] != TRAILER):
+            start += 1      # not a real frame, keep looking
+            continue
+        records = [RECORD.unpack_from(data, pos + i * size)
+                   for i in range(count)]
+        yield records, lost
+        start = end + len(TRAILER)
+
+
+def describe(kind, service, event_type, param, events, services):
+    kind_name = KINDS.get(kind, "KIND_%d" % kind)
+    if kind == 5:
+        who = "timer %d" % service
+    elif service == NO_SERVICE:
+        who = "all"
+    else:
+        who = services.get(service, "serv %d" % service)
+    if kind == 6:
+        what = "0x%04X" % param
+    else:
+        what = "%s(%d)" % (events.get(event_type, "EVENT_%d" % event_type),
+                           param)
+    return "%-10s %-14s %s" % (kind_name, who, what)
+
+
+def decode(data, events, services, out=sys.stdout):
+    found = False
+    for dump_num, (records, lost) in enumerate(find_dumps(data)):
+        found = True
+        out.write("--- dump %d: %d records, %d lost before the first ---\n"
+                  % (dump_num, len(records), lost))
+        last_tick = None
+        last_seq = None
+        for tick, seq, kind, service, event_type, param in records:
+            if last_seq is not None and seq != (last_seq + 1) & 0xFF:
+                out.write("    ... %d records missing ...\n"
+                          % ((seq - last_seq - 1) & 0xFF))
+            delta = 0 if last_tick is None else (tick - last_tick) & 0xFFFF
+            out.write("%6u +%-5u %s\n" % (tick, delta,
+                      describe(kind, service, event_type, param,
+                               events, services)))
+            last_tick, last_seq = tick, seq
+    if not found:
+        out.write("no trace dump found\n")
+    return found
+
+
+def capture_from_port(port, baud, timeout):
+    import serial   # pyserial, only needed for live capture
+    with serial.Serial(port, baud, timeout=timeout) as link:
+        link.reset_input_buffer()
+        link.write(b"d")
+        data = b""
+        while True:
+            chunk = link.read(4096)
+            if not chunk:
+                break
+            data += chunk
+            if TRAILER in data[data.find(HEADER):]:
+                break
+    return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="binary console capture")
+    parser.add_argument("--port", help="serial port to request a dump from")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=2.0)
+    parser.add_argument("--config", default=DEFAULT_CONFIG,
+                        help="ES_Configure.h to take the names from")
+    args = parser.parse_args()
+
+    if args.port:
+        data = capture_from_port(args.port, args.baud, args.timeout)
+    elif args.capture:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+
+    events, services = read_config(args.config)
+    return 0 if decode(data, events, services) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())